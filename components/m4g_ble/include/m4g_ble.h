@@ -9,15 +9,44 @@ esp_err_t m4g_ble_init(void);
 // Start advertising (safe to call after init or after disconnect)
 void m4g_ble_start_advertising(void);
 
+// Outcome of handing a report to the BLE stack
+typedef enum
+{
+  M4G_BLE_SEND_OK = 0,
+  M4G_BLE_SEND_NO_BUFFER, // Notification buffers exhausted; retry after the next connection event
+  M4G_BLE_SEND_FAILED,    // This link cannot carry the report (not connected, not subscribed, notify error)
+} m4g_ble_send_result_t;
 // Send a HID keyboard report (8 bytes standard: mods, reserved, 6 keys)
-bool m4g_ble_send_keyboard_report(const uint8_t report[8]);
+m4g_ble_send_result_t m4g_ble_send_keyboard_report(const uint8_t report[8]);
 
-// Send a HID mouse report (3 bytes: buttons, x, y) - optional future
-bool m4g_ble_send_mouse_report(const uint8_t report[3]);
+// NKRO keyboard report (Report ID 3): modifiers byte + one bit per usage 0x00-0x7F.
+// 17 bytes plus the Report ID fits a notification at the default 23-byte ATT MTU.
+#define M4G_BLE_NKRO_MAX_USAGE 0x7F
+#define M4G_BLE_NKRO_REPORT_LEN (1 + (M4G_BLE_NKRO_MAX_USAGE + 1) / 8)
+
+// Send an NKRO keyboard report (report characteristic only; fails without its subscription)
+m4g_ble_send_result_t m4g_ble_send_nkro_report(const uint8_t report[M4G_BLE_NKRO_REPORT_LEN]);
+
+// Whether the host switched the HID service to Boot Protocol (6KRO only)
+bool m4g_ble_is_boot_protocol(void);
+
+// Mouse report (Report ID 2): buttons 1-5, 16-bit X and Y (little-endian,
+// -32767..32767), vertical wheel and horizontal pan (-127..127)
+#define M4G_BLE_MOUSE_REPORT_LEN 7
+
+// Send a HID mouse report (report characteristic only; fails without its subscription)
+m4g_ble_send_result_t m4g_ble_send_mouse_report(const uint8_t report[M4G_BLE_MOUSE_REPORT_LEN]);
 
 // Connection / notification status helpers
 bool m4g_ble_is_connected(void);
 bool m4g_ble_notifications_enabled(void);
+// Whether the host subscribed to the Report Protocol input characteristic. Only it
+// carries Report IDs, so the NKRO keyboard and mouse reports need it; a host that
+// subscribed to the boot keyboard characteristic alone gets 8-byte keyboard reports.
+bool m4g_ble_report_notifications_enabled(void);
+
+// Connection interval negotiated with the host in microseconds (0 while disconnected)
+uint32_t m4g_ble_conn_interval_us(void);
 
 // Process BLE host events (to be run in its own task if required)
 void m4g_ble_host_task(void *param);
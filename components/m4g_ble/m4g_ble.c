@@ -55,7 +55,7 @@ static const char *BLE_TAG = "M4G-BLE";
 // Embedded HID report map (text file with hex bytes). ESP-IDF generates *_start/_end symbols.
 extern const uint8_t _binary_hid_report_map_txt_start[];
 extern const uint8_t _binary_hid_report_map_txt_end[];
-static uint8_t s_hid_report_map[128];
+static uint8_t s_hid_report_map[256];
 static size_t s_hid_report_map_len = 0;
 
 static int m4g_hex_val(char c)
@@ -117,9 +117,14 @@ static uint8_t s_addr_type = 0;
 static uint16_t s_report_chr_handle = 0;
 static uint16_t s_boot_report_chr_handle = 0;
 static bool s_boot_notifications_enabled = false;
+static uint8_t s_protocol_mode = 1; // 0 = Boot Protocol, 1 = Report Protocol (default on every connection)
+static uint32_t s_conn_interval_us = 0; // Negotiated connection interval, 0 while disconnected
 
 bool m4g_ble_is_connected(void) { return s_conn_handle != BLE_HS_CONN_HANDLE_NONE; }
+uint32_t m4g_ble_conn_interval_us(void) { return s_conn_interval_us; }
 bool m4g_ble_notifications_enabled(void) { return s_report_notifications_enabled || s_boot_notifications_enabled; }
+bool m4g_ble_report_notifications_enabled(void) { return s_report_notifications_enabled && s_report_chr_handle != 0; }
+bool m4g_ble_is_boot_protocol(void) { return s_protocol_mode == 0; }
 
 // Forward decls
 static int gap_event_handler(struct ble_gap_event *event, void *arg);
@@ -151,7 +156,6 @@ static int hid_svc_access_cb(uint16_t conn_handle, uint16_t attr_handle, struct
   (void)attr_handle;
   (void)arg;
   int rc;
-  static uint8_t protocol_mode = 1; // Report Protocol
   uint8_t hid_info[4] = {0x11, 0x01, 0x00, 0x00};
   switch (ctxt->op)
   {
@@ -194,7 +198,7 @@ static int hid_svc_access_cb(uint16_t conn_handle, uint16_t attr_handle, struct
     }
     if (ble_uuid_cmp(ctxt->chr->uuid, BLE_UUID16_DECLARE(0x2A4E)) == 0)
     {
-      rc = os_mbuf_append(ctxt->om, &protocol_mode, 1);
+      rc = os_mbuf_append(ctxt->om, &s_protocol_mode, 1);
       return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
     }
     break;
@@ -252,7 +256,8 @@ static int hid_svc_access_cb(uint16_t conn_handle, uint16_t attr_handle, struct
       return 0; // accept
     if (ble_uuid_cmp(ctxt->chr->uuid, BLE_UUID16_DECLARE(0x2A4E)) == 0)
     {
-      rc = ble_hs_mbuf_to_flat(ctxt->om, &protocol_mode, 1, NULL);
+      rc = ble_hs_mbuf_to_flat(ctxt->om, &s_protocol_mode, 1, NULL);
+      LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, I, BLE_TAG, "Protocol mode set to %s", s_protocol_mode == 0 ? "BOOT" : "REPORT");
       return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
     }
     break;
@@ -338,9 +343,22 @@ static void start_advertising(void)
   }
 }
 
+// Connection interval is in units of 1.25 ms
+static void update_conn_interval(uint16_t conn_handle)
+{
+  struct ble_gap_conn_desc desc;
+  if (ble_gap_conn_find(conn_handle, &desc) == 0)
+  {
+    s_conn_interval_us = (uint32_t)desc.conn_itvl * 1250;
+    LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, I, BLE_TAG, "Connection interval %u us", (unsigned)s_conn_interval_us);
+  }
+}
+
 static void handle_connect_success(uint16_t conn_handle)
 {
   s_conn_handle = conn_handle;
+  s_protocol_mode = 1;
+  update_conn_interval(conn_handle);
   m4g_led_set_ble_connected(true);
   LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, I, BLE_TAG, "Connected handle=%d", s_conn_handle);
 }
@@ -366,7 +384,9 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg)
     s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
     s_report_notifications_enabled = false;
     s_boot_notifications_enabled = false;
+    s_protocol_mode = 1;
     s_encrypted = false;
+    s_conn_interval_us = 0;
     m4g_led_set_ble_connected(false);
     start_advertising();
     return 0;
@@ -399,6 +419,10 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg)
     LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, I, BLE_TAG, "repeat pairing: cleared old bond");
     return BLE_GAP_REPEAT_PAIRING_RETRY;
   }
+  case BLE_GAP_EVENT_CONN_UPDATE:
+    if (event->conn_update.status == 0)
+      update_conn_interval(event->conn_update.conn_handle);
+    return 0;
   case BLE_GAP_EVENT_NOTIFY_TX:
     return 0;
   case BLE_GAP_EVENT_SUBSCRIBE:
@@ -517,50 +541,62 @@ esp_err_t m4g_ble_init(void)
   return ESP_OK;
 }
 
-static bool notify_handle(uint16_t chr_handle, const uint8_t *report, size_t len)
+// Running out of mbufs is temporary (the controller frees them at the next
+// connection event); any other error will not go away by retrying
+static m4g_ble_send_result_t notify_handle(uint16_t chr_handle, const uint8_t *report, size_t len)
 {
   struct os_mbuf *om = ble_hs_mbuf_from_flat(report, len);
   if (!om)
-    return false;
+    return M4G_BLE_SEND_NO_BUFFER;
   int rc = ble_gatts_notify_custom(s_conn_handle, chr_handle, om);
   if (rc != 0)
   {
     LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, W, BLE_TAG, "notify handle 0x%04X failed rc=%d", chr_handle, rc);
     os_mbuf_free_chain(om);
-    return false;
+    return rc == BLE_HS_ENOMEM ? M4G_BLE_SEND_NO_BUFFER : M4G_BLE_SEND_FAILED;
   }
-  return true;
+  return M4G_BLE_SEND_OK;
 }
 
-static bool send_report_internal(const uint8_t *report, size_t len)
+// Combined outcome of notifying both characteristics: sent if either took it
+static m4g_ble_send_result_t send_result_merge(m4g_ble_send_result_t a, m4g_ble_send_result_t b)
+{
+  if (a == M4G_BLE_SEND_OK || b == M4G_BLE_SEND_OK)
+    return M4G_BLE_SEND_OK;
+  if (a == M4G_BLE_SEND_NO_BUFFER || b == M4G_BLE_SEND_NO_BUFFER)
+    return M4G_BLE_SEND_NO_BUFFER;
+  return M4G_BLE_SEND_FAILED;
+}
+
+static m4g_ble_send_result_t send_report_internal(const uint8_t *report, size_t len)
 {
   if (!m4g_ble_is_connected())
-    return false;
+    return M4G_BLE_SEND_FAILED;
   if (len > 64)
     len = 64; // safety cap
-  bool sent = false;
+  m4g_ble_send_result_t result = M4G_BLE_SEND_FAILED;
 
   if (s_report_notifications_enabled && s_report_chr_handle != 0)
   {
-    sent |= notify_handle(s_report_chr_handle, report, len);
+    result = send_result_merge(result, notify_handle(s_report_chr_handle, report, len));
   }
 
   if (s_boot_notifications_enabled && s_boot_report_chr_handle != 0)
   {
-    sent |= notify_handle(s_boot_report_chr_handle, report, len);
+    result = send_result_merge(result, notify_handle(s_boot_report_chr_handle, report, len));
   }
 
 #ifdef CONFIG_M4G_ASSERT_BLE_HANDLE
-  if (!sent && (s_report_notifications_enabled || s_boot_notifications_enabled))
+  if (result != M4G_BLE_SEND_OK && (s_report_notifications_enabled || s_boot_notifications_enabled))
   {
     assert(false && "Failed to notify any HID characteristic");
   }
 #endif
 
-  return sent;
+  return result;
 }
 
-bool m4g_ble_send_keyboard_report(const uint8_t report[8])
+m4g_ble_send_result_t m4g_ble_send_keyboard_report(const uint8_t report[8])
 {
   // Prepend Report ID 0x01 for keyboard
   uint8_t report_with_id[9];
@@ -570,27 +606,41 @@ bool m4g_ble_send_keyboard_report(const uint8_t report[8])
   return send_report_internal(report_with_id, 9);
 }
 
-bool m4g_ble_send_mouse_report(const uint8_t report[3])
+m4g_ble_send_result_t m4g_ble_send_nkro_report(const uint8_t report[M4G_BLE_NKRO_REPORT_LEN])
 {
-  if (!m4g_ble_is_connected())
-    return false;
+  // Report protocol only: the boot keyboard characteristic carries the fixed 8-byte layout
+  if (!m4g_ble_is_connected() || !s_report_notifications_enabled || s_report_chr_handle == 0)
+    return M4G_BLE_SEND_FAILED;
+
+  // Prepend Report ID 0x03 for the NKRO keyboard
+  uint8_t report_with_id[1 + M4G_BLE_NKRO_REPORT_LEN];
+  report_with_id[0] = 0x03; // NKRO Keyboard Report ID
+  memcpy(&report_with_id[1], report, M4G_BLE_NKRO_REPORT_LEN);
+
+  return notify_handle(s_report_chr_handle, report_with_id, sizeof(report_with_id));
+}
+
+m4g_ble_send_result_t m4g_ble_send_mouse_report(const uint8_t report[M4G_BLE_MOUSE_REPORT_LEN])
+{
+  // The service has no Boot Mouse Input Report characteristic (0x2A33), so mouse
+  // reports only reach the host through the report characteristic with their Report ID
+  if (!m4g_ble_is_connected() || !s_report_notifications_enabled || s_report_chr_handle == 0)
+    return M4G_BLE_SEND_FAILED;
 
-  // Mouse: Send 3 bytes WITHOUT Report ID to the mouse Report characteristic
-  // Format: [Buttons, X, Y] = 3 bytes (no Report ID)
   if (ENABLE_DEBUG_BLE_LOGGING)
   {
     LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, I, BLE_TAG,
-                 "Sending mouse report with ID: [0x02 0x%02X 0x%02X 0x%02X] (Report ID, buttons, dx=%d, dy=%d)",
-                 report[0], report[1], report[2],
-                 (int8_t)report[1], (int8_t)report[2]);
+                 "Sending mouse report: buttons=0x%02X dx=%d dy=%d wheel=%d pan=%d",
+                 report[0], (int16_t)(report[1] | (report[2] << 8)), (int16_t)(report[3] | (report[4] << 8)),
+                 (int8_t)report[5], (int8_t)report[6]);
   }
 
   // Prepend Report ID 0x02 for mouse
-  uint8_t report_with_id[4];
+  uint8_t report_with_id[1 + M4G_BLE_MOUSE_REPORT_LEN];
   report_with_id[0] = 0x02; // Mouse Report ID
-  memcpy(&report_with_id[1], report, 3);
+  memcpy(&report_with_id[1], report, M4G_BLE_MOUSE_REPORT_LEN);
 
-  return send_report_internal(report_with_id, 4);
+  return notify_handle(s_report_chr_handle, report_with_id, sizeof(report_with_id));
 }
 void m4g_ble_start_advertising(void) { start_advertising(); }
 void m4g_ble_host_task(void *param) { host_task(param); }
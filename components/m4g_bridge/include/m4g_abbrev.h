@@ -0,0 +1,106 @@
+// Abbreviation expander for ordinary keyboards (CONFIG_M4G_ABBREV_EXPANSION)
+//
+// Matches the keys typed on non-CharaChorder keyboards against a trie of
+// abbreviations stored in a flash data partition, built on a PC by
+// tools/chord-dict/build_abbrev_dict.py and read in place through
+// esp_partition_mmap. The matcher advances one trie node per keystroke and never
+// rescans; when a word boundary follows a complete abbreviation the caller erases
+// it with Backspaces and types the expansion.
+//
+// Image layout (little-endian, every section 4-byte aligned):
+//   m4g_abbrev_header_t
+//   m4g_abbrev_node_t nodes[node_count]         (node 0 is the root)
+//   uint32_t edges[edge_count]                  (child node << 8 | usage, sorted by usage per node)
+//   m4g_abbrev_output_t outputs[output_count]
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "m4g_bridge.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define M4G_ABBREV_MAGIC 0x4241344Du // "M4AB"
+#define M4G_ABBREV_VERSION 1
+#define M4G_ABBREV_MAX_DEPTH 32 // Longest abbreviation the matcher tracks
+
+  typedef struct __attribute__((packed))
+  {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t node_count;
+    uint32_t edge_count;
+    uint32_t output_count;
+    uint32_t nodes_offset; // Byte offsets from the start of the image
+    uint32_t edges_offset;
+    uint32_t outputs_offset;
+    uint32_t image_size;
+  } m4g_abbrev_header_t;
+
+  typedef struct __attribute__((packed))
+  {
+    uint32_t first_edge;
+    uint8_t edge_count;
+    uint8_t output_len; // 0: no abbreviation ends at this node
+    uint16_t reserved;
+    uint32_t output_index;
+  } m4g_abbrev_node_t;
+
+  typedef m4g_bridge_keystroke_t m4g_abbrev_output_t; // Typed by the paced output scheduler as is
+
+  // Word being typed, one per bridge instance. path[i] is the trie node reached
+  // after i keys (UINT32_MAX once the word left the trie); words longer than the
+  // path are counted but never match.
+  typedef struct
+  {
+    uint32_t path[M4G_ABBREV_MAX_DEPTH + 1];
+    size_t depth;
+  } m4g_abbrev_matcher_t;
+
+  /**
+   * @brief Map the abbreviation partition (CONFIG_M4G_ABBREV_PARTITION_LABEL)
+   *
+   * @return
+   *      - ESP_OK: Dictionary mapped and ready
+   *      - ESP_ERR_NOT_FOUND: No partition with that label
+   *      - ESP_ERR_INVALID_VERSION: Partition holds no valid dictionary image
+   *      - Other: esp_partition_mmap failure
+   */
+  esp_err_t m4g_abbrev_init(void);
+
+  /**
+   * @brief Whether a dictionary is mapped
+   */
+  bool m4g_abbrev_ready(void);
+
+  /**
+   * @brief Forget the word being typed (e.g. after the cursor may have moved)
+   */
+  void m4g_abbrev_reset(m4g_abbrev_matcher_t *matcher);
+
+  /**
+   * @brief Advance the matcher by one key press
+   *
+   * Letters and digits extend the current word, Backspace steps back one key, a
+   * space, Enter, Tab or punctuation key ends the word, and anything else (or a
+   * press with Ctrl, Alt or GUI held) starts over.
+   *
+   * @param matcher Word state, reset before first use
+   * @param usage HID usage of the pressed (non-modifier) key
+   * @param modifiers Modifier byte held with it
+   * @param erase_len Receives the number of keys to erase when an expansion is returned
+   * @param out_len Receives the number of output keystrokes
+   * @return Expansion (pointing into flash) if this key ended a complete abbreviation, else NULL
+   */
+  const m4g_abbrev_output_t *m4g_abbrev_feed(m4g_abbrev_matcher_t *matcher, uint8_t usage, uint8_t modifiers,
+                                             size_t *erase_len, size_t *out_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,32 +4,101 @@
 #include <stdint.h>
 
 #include "esp_err.h"
+#include "m4g_hid_mouse.h"
+#include "sdkconfig.h"
 
-#define M4G_BRIDGE_MAX_SLOTS 2
+#define M4G_BRIDGE_MAX_SLOTS CONFIG_M4G_BRIDGE_MAX_SLOTS
+// Slot for reports forwarded from the RIGHT half over ESP-NOW; a LEFT build keeps
+// it out of the USB slot pool
+#define M4G_BRIDGE_REMOTE_SLOT (M4G_BRIDGE_MAX_SLOTS - 1)
 #define M4G_INVALID_SLOT 0xFF
+// Mouse report handed to the host: buttons, 16-bit X and Y (little-endian),
+// wheel, pan (the BLE mouse report without its Report ID)
+#define M4G_BRIDGE_MOUSE_REPORT_LEN 7
 
-// Initialize bridge subsystem
+// Input producers. All bridge state is owned by the bridge task; each producer
+// context gets its own lock-free single-producer ring, so every source must only
+// ever be posted from one task.
+typedef enum
+{
+  M4G_BRIDGE_SOURCE_USB = 0, // USB host task (reports, slot resets, CharaChorder status)
+  M4G_BRIDGE_SOURCE_ESPNOW,  // ESP-NOW receive task (reports from the RIGHT half)
+  M4G_BRIDGE_SOURCE_TIMER,   // esp_timer task (bridge deadlines)
+  M4G_BRIDGE_SOURCE_APP,     // Application task (m4g_bridge_type_text)
+  M4G_BRIDGE_SOURCE_COUNT,
+} m4g_bridge_source_t;
+
+// Initialize the default bridge instance (esp_timer clock and timers, BLE HID
+// output) and start the bridge task that drains it
 esp_err_t m4g_bridge_init(void);
 
-// Process a raw USB HID input report. slot identifies which USB HID endpoint produced the report.
+// Queue a raw HID input report from the given producer for the bridge task.
+// slot identifies which HID endpoint produced the report, report points to raw
+// bytes and len is the number of bytes in the original interrupt transfer.
+// Returns false if that producer's ring is full (the report is dropped).
+bool m4g_bridge_submit_report(m4g_bridge_source_t source, uint8_t slot, const uint8_t *report, size_t len,
+                              bool is_charachorder);
+
+// Queue a raw USB HID input report (USB host task only). slot identifies which USB HID endpoint produced the report.
 // report points to raw bytes, len is number of bytes in original USB interrupt transfer.
 // is_charachorder indicates whether the originating device is a CharaChorder half.
 void m4g_bridge_process_usb_report(uint8_t slot, const uint8_t *report, size_t len, bool is_charachorder);
 
-// Notify the bridge that a USB HID slot has been disconnected/reset
+// One report of a batch for m4g_bridge_process_reports
+typedef struct
+{
+  int64_t timestamp_us; // When it was received (esp_timer clock); 0 for now
+  uint8_t slot;
+  bool is_charachorder;
+  uint8_t len;
+  const uint8_t *data;
+} m4g_bridge_report_t;
+
+// Queue reports that arrived together (e.g. an ESP-NOW backlog after interference)
+// as one batch from the given producer. The bridge applies them in order but only
+// sends the keyboard states the host needs to see: a state is skipped when going
+// straight past it presses or releases nothing out of order, so a burst ends in
+// as few notifications as possible. Timestamps must not go backwards. Returns how
+// many reports, from the front, were queued; the rest did not fit in the ring.
+size_t m4g_bridge_process_reports(m4g_bridge_source_t source, const m4g_bridge_report_t *reports, size_t n);
+
+// Notify the bridge that a USB HID slot has been disconnected/reset (USB host task only)
 void m4g_bridge_reset_slot(uint8_t slot);
 
-// Update CharaChorder detection state (from USB layer)
+// Update CharaChorder detection state (USB host task only)
 void m4g_bridge_set_charachorder_status(bool detected, bool both_halves_connected);
 
+// Mouse report layout of the interface behind a USB slot, read from its report
+// descriptor (USB host task only, after the slot's reset). Without one, reports
+// starting with Report ID 0x02 are taken as [0x02, buttons, dx, dy] with 8-bit motion.
+void m4g_bridge_set_mouse_layout(uint8_t slot, const m4g_hid_mouse_layout_t *layout);
+
+// One generated keystroke: usage pressed with a modifier byte
+typedef struct __attribute__((packed))
+{
+  uint8_t modifiers;
+  uint8_t usage;
+} m4g_bridge_keystroke_t;
+
+// Runs in the bridge task once the last report of a queued output has been handed
+// to BLE (delivered = true), or when the output was dropped because the link went away
+typedef void (*m4g_bridge_output_done_cb_t)(void *arg, bool delivered);
+
+// Type text through the paced output scheduler (application task only). Characters
+// map to keys on the US layout; characters without a key are skipped. text must
+// stay valid until done runs; done may be NULL. Returns false if the request could
+// not be queued.
+bool m4g_bridge_type_text(const char *text, m4g_bridge_output_done_cb_t done, void *arg);
+
+// Process all queued events in timestamp order. Called by the bridge task; host
+// builds without a scheduler call it directly after posting events.
+void m4g_bridge_drain_events(void);
+
 // Optional: query last sent keyboard report (for debugging)
 bool m4g_bridge_get_last_keyboard(uint8_t out[8]);
 
 // Optional: query last sent mouse report (for debugging)
-bool m4g_bridge_get_last_mouse(uint8_t out[3]);
-
-// Process key repeat (should be called periodically from main loop)
-void m4g_bridge_process_key_repeat(void);
+bool m4g_bridge_get_last_mouse(uint8_t out[M4G_BRIDGE_MOUSE_REPORT_LEN]);
 
 typedef struct
 {
@@ -37,6 +106,101 @@ typedef struct
   uint32_t mouse_reports_sent;
   uint32_t chord_reports_processed;
   uint32_t chord_reports_delayed;
+  uint32_t events_dropped;       // Events lost to a full producer ring
+  uint32_t max_event_latency_us; // Longest time an event waited for the bridge task
+  uint32_t reports_unchanged;    // Slot reports identical to the previous one, dropped before chord/BLE work
+  uint32_t speculative_hits;     // Speculative first-key presses that turned out to be single keys
+  uint32_t speculative_misses;   // Speculative presses rolled back because a chord followed
+  uint32_t robot_bursts;         // CharaChorder output bursts recognised by inter-report timing
+  uint32_t grace_early_expiries; // Failed chords dropped at the learned window, before the chord timeout
+  uint32_t grace_late_outputs;   // Chord outputs that started after the learned window
+  uint32_t local_chords;         // Chords resolved from the local dictionary (CONFIG_M4G_LOCAL_CHORDS)
+  uint32_t abbrev_expansions;    // Abbreviations expanded on ordinary keyboards (CONFIG_M4G_ABBREV_EXPANSION)
+  uint32_t output_reports_deferred; // Keyboard states that waited for the next connection interval
+  uint32_t output_link_refusals;    // Reports the BLE stack had no buffer for (kept and retried)
+  uint32_t output_reports_dropped;  // Reports and outputs lost to a full queue, a lost link or a link that cannot carry them
+  uint32_t reports_coalesced;       // Keyboard states of a batch the host did not need to see
+  uint32_t mouse_reports_merged;    // USB mouse reports whose motion went out with a later one
 } m4g_bridge_stats_t;
 
 void m4g_bridge_get_stats(m4g_bridge_stats_t *out);
+
+// ---------------------------------------------------------------------------
+// Bridge instances
+//
+// All bridge state lives in a m4g_bridge_ctx_t. The functions above drive the
+// default instance. Further instances (e.g. many simulated bridges on a PC) take
+// their clock, timers and report output from a m4g_bridge_io_t and are driven
+// with the m4g_bridge_ctx_* calls below; each instance is independent, so
+// instances can run on different threads. Settings and the chord/abbreviation
+// dictionaries are shared by all instances.
+// ---------------------------------------------------------------------------
+
+typedef struct m4g_bridge_ctx m4g_bridge_ctx_t;
+
+// One-shot timers an instance arms through m4g_bridge_io_t.set_timer
+typedef enum
+{
+  M4G_BRIDGE_TIMER_CHORD_DEADLINE = 0, // Chord collection/output deadline
+  M4G_BRIDGE_TIMER_KEY_REPEAT,         // Next key repeat
+  M4G_BRIDGE_TIMER_OUTPUT,             // Paced output budget refill
+  M4G_BRIDGE_TIMER_ARROW_MOUSE,        // Arrow-key mouse motion tick
+  M4G_BRIDGE_TIMER_COUNT,
+} m4g_bridge_timer_t;
+
+// Outcome of handing one report to the host
+typedef enum
+{
+  M4G_BRIDGE_SEND_OK = 0,
+  M4G_BRIDGE_SEND_BUSY,     // No buffer free right now: the report is kept and retried
+  M4G_BRIDGE_SEND_REJECTED, // The link cannot carry this report: it is re-encoded or dropped
+} m4g_bridge_send_result_t;
+
+typedef struct
+{
+  // Monotonic clock in microseconds
+  int64_t (*now_us)(void *user);
+  // Arm timer to expire at due_us, replacing any earlier deadline, or stop it if
+  // due_us is 0. On expiry the owner calls m4g_bridge_ctx_timer_expired().
+  void (*set_timer)(void *user, m4g_bridge_timer_t timer, int64_t due_us);
+  // Hand one report to the host
+  m4g_bridge_send_result_t (*send_keyboard)(void *user, const uint8_t report[8]);
+  m4g_bridge_send_result_t (*send_nkro)(void *user, const uint8_t *report, size_t len);
+  m4g_bridge_send_result_t (*send_mouse)(void *user, const uint8_t report[M4G_BRIDGE_MOUSE_REPORT_LEN]);
+  // Host connected with input report notifications enabled
+  bool (*link_ready)(void *user);
+  // Host subscribed to the report characteristic, the only one that takes NKRO and
+  // mouse reports (link_ready also holds with the boot keyboard characteristic alone)
+  bool (*report_notifications)(void *user);
+  // Host selected the boot protocol (8-byte keyboard reports only)
+  bool (*boot_protocol)(void *user);
+  // Current connection interval, 0 if unknown
+  uint32_t (*conn_interval_us)(void *user);
+  void *user;
+  bool persist_grace_model; // Load and save the learned chord output window in NVS
+} m4g_bridge_io_t;
+
+// Default instance driven by the functions above
+m4g_bridge_ctx_t *m4g_bridge_default_ctx(void);
+
+// Allocate and initialize an instance; io is copied. NULL if out of memory or a
+// callback is missing.
+m4g_bridge_ctx_t *m4g_bridge_ctx_create(const m4g_bridge_io_t *io);
+void m4g_bridge_ctx_destroy(m4g_bridge_ctx_t *ctx);
+
+// Instance counterparts of the calls above (same producer rules per source)
+bool m4g_bridge_ctx_submit_report(m4g_bridge_ctx_t *ctx, m4g_bridge_source_t source, uint8_t slot,
+                                  const uint8_t *report, size_t len, bool is_charachorder);
+size_t m4g_bridge_ctx_process_reports(m4g_bridge_ctx_t *ctx, m4g_bridge_source_t source,
+                                      const m4g_bridge_report_t *reports, size_t n);
+void m4g_bridge_ctx_reset_slot(m4g_bridge_ctx_t *ctx, uint8_t slot);
+void m4g_bridge_ctx_set_charachorder_status(m4g_bridge_ctx_t *ctx, bool detected, bool both_halves_connected);
+void m4g_bridge_ctx_set_mouse_layout(m4g_bridge_ctx_t *ctx, uint8_t slot, const m4g_hid_mouse_layout_t *layout);
+bool m4g_bridge_ctx_type_text(m4g_bridge_ctx_t *ctx, const char *text, m4g_bridge_output_done_cb_t done, void *arg);
+void m4g_bridge_ctx_drain_events(m4g_bridge_ctx_t *ctx);
+bool m4g_bridge_ctx_get_last_keyboard(m4g_bridge_ctx_t *ctx, uint8_t out[8]);
+bool m4g_bridge_ctx_get_last_mouse(m4g_bridge_ctx_t *ctx, uint8_t out[M4G_BRIDGE_MOUSE_REPORT_LEN]);
+void m4g_bridge_ctx_get_stats(m4g_bridge_ctx_t *ctx, m4g_bridge_stats_t *out);
+
+// A timer armed through set_timer expired: posts it on the TIMER source ring
+void m4g_bridge_ctx_timer_expired(m4g_bridge_ctx_t *ctx, m4g_bridge_timer_t timer);
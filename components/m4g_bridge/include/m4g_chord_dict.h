@@ -0,0 +1,102 @@
+// Local chord dictionary (CONFIG_M4G_LOCAL_CHORDS)
+//
+// Resolves a released chord to its output keystrokes without waiting for the
+// CharaChorder firmware. The dictionary is a perfect-hashed table in a flash data
+// partition, built on a PC by tools/chord-dict/build_chord_dict.py and read in
+// place through esp_partition_mmap (no RAM copy).
+//
+// Image layout (little-endian, every section 4-byte aligned):
+//   m4g_chord_dict_header_t
+//   uint16_t displacement[bucket_count]
+//   m4g_chord_dict_entry_t slots[slot_count]    (keys[0] == 0 marks an empty slot)
+//   m4g_chord_dict_output_t outputs[output_count]
+//
+// A chord key is its sorted non-modifier usages, zero padded to
+// M4G_CHORD_DICT_MAX_KEYS, followed by its modifier byte. Lookup hashes the key
+// with the header seed to pick a bucket, then rehashes it with seed + displacement
+// + 1 to pick the slot (hash-and-displace, as in CHD), and compares the stored key.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "m4g_bridge.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define M4G_CHORD_DICT_MAGIC 0x4443344Du // "M4CD"
+#define M4G_CHORD_DICT_VERSION 1
+#define M4G_CHORD_DICT_MAX_KEYS 10
+#define M4G_CHORD_DICT_KEY_LEN (M4G_CHORD_DICT_MAX_KEYS + 1)
+
+  typedef struct __attribute__((packed))
+  {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t max_keys; // M4G_CHORD_DICT_MAX_KEYS the image was built for
+    uint32_t entry_count;
+    uint32_t bucket_count;
+    uint32_t slot_count;
+    uint32_t output_count;
+    uint32_t seed;
+    uint32_t buckets_offset; // Byte offsets from the start of the image
+    uint32_t slots_offset;
+    uint32_t outputs_offset;
+    uint32_t image_size;
+  } m4g_chord_dict_header_t;
+
+  typedef struct __attribute__((packed))
+  {
+    uint8_t keys[M4G_CHORD_DICT_MAX_KEYS]; // Sorted usages, zero padded
+    uint8_t modifiers;
+    uint8_t output_len;     // Keystrokes in the output
+    uint32_t output_index;  // First keystroke in outputs[]
+  } m4g_chord_dict_entry_t;
+
+  typedef m4g_bridge_keystroke_t m4g_chord_dict_output_t; // Typed by the paced output scheduler as is
+
+  /**
+   * @brief Map the dictionary partition (CONFIG_M4G_LOCAL_CHORDS_PARTITION_LABEL)
+   *
+   * @return
+   *      - ESP_OK: Dictionary mapped and ready
+   *      - ESP_ERR_NOT_FOUND: No partition with that label
+   *      - ESP_ERR_INVALID_VERSION: Partition holds no valid dictionary image
+   *      - Other: esp_partition_mmap failure
+   */
+  esp_err_t m4g_chord_dict_init(void);
+
+  /**
+   * @brief Whether a dictionary is mapped
+   */
+  bool m4g_chord_dict_ready(void);
+
+  /**
+   * @brief Number of chords in the mapped dictionary (0 if none)
+   */
+  size_t m4g_chord_dict_size(void);
+
+  /**
+   * @brief Look up a chord
+   *
+   * @param keys Sorted non-modifier usages of the chord
+   * @param n_keys Number of usages
+   * @param modifiers Modifier byte held with the chord
+   * @param out_len Receives the number of output keystrokes
+   * @return Output keystrokes (pointing into flash), or NULL if the chord is not in the dictionary
+   */
+  const m4g_chord_dict_output_t *m4g_chord_dict_lookup(const uint8_t *keys, size_t n_keys, uint8_t modifiers,
+                                                       size_t *out_len);
+
+  /**
+   * @brief Hash used by the dictionary (shared with the image builder)
+   */
+  uint32_t m4g_chord_dict_hash(const uint8_t key[M4G_CHORD_DICT_KEY_LEN], uint32_t seed);
+
+#ifdef __cplusplus
+}
+#endif
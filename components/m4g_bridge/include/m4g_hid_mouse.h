@@ -0,0 +1,74 @@
+// Mouse input report layout from a USB HID report descriptor
+//
+// Mice describe their reports in the HID report descriptor: how many buttons,
+// how wide X and Y are (8, 12 and 16 bits are all common), and whether a wheel
+// or horizontal pan follows. The USB host reads the descriptor once per
+// interface, m4g_hid_mouse_parse() finds the fields, and the bridge then reads
+// each report through m4g_hid_mouse_read() instead of assuming the boot layout.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  // A field of the input report; offset is in bits from the first byte after the
+  // Report ID. bits == 0: the report has no such field.
+  typedef struct
+  {
+    uint16_t offset;
+    uint8_t bits;
+  } m4g_hid_field_t;
+
+  typedef struct
+  {
+    uint8_t report_id;       // 0: the interface sends no Report IDs
+    m4g_hid_field_t buttons; // One bit per button, button 1 first
+    m4g_hid_field_t x;
+    m4g_hid_field_t y;
+    m4g_hid_field_t wheel;
+    m4g_hid_field_t pan; // AC Pan (horizontal scroll)
+  } m4g_hid_mouse_layout_t;
+
+  // One decoded report
+  typedef struct
+  {
+    uint8_t buttons; // Buttons 1-8
+    int32_t x;
+    int32_t y;
+    int32_t wheel;
+    int32_t pan;
+  } m4g_hid_mouse_state_t;
+
+  /**
+   * @brief Find the relative X/Y input report of a mouse in a report descriptor
+   *
+   * Takes the first report that carries relative X and Y inside a Mouse or Pointer
+   * collection, along with the buttons, wheel and pan of the same report.
+   *
+   * @param desc HID report descriptor
+   * @param len Length of desc
+   * @param out Receives the layout
+   * @return true if the descriptor describes a mouse report
+   */
+  bool m4g_hid_mouse_parse(const uint8_t *desc, size_t len, m4g_hid_mouse_layout_t *out);
+
+  /**
+   * @brief Decode an input report with a parsed layout
+   *
+   * @param layout Layout from m4g_hid_mouse_parse()
+   * @param report Report as received, including the Report ID if the layout has one
+   * @param len Length of report
+   * @param out Receives the fields; absent ones read 0
+   * @return false if the report is another Report ID or too short for X and Y
+   */
+  bool m4g_hid_mouse_read(const m4g_hid_mouse_layout_t *layout, const uint8_t *report, size_t len,
+                          m4g_hid_mouse_state_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,171 @@
+#include "m4g_abbrev.h"
+#include "m4g_logging.h"
+#include <string.h>
+#include "esp_partition.h"
+#include "sdkconfig.h"
+
+static const char *ABBREV_TAG = "M4G-ABBREV";
+
+#define ABBREV_NO_NODE UINT32_MAX
+#define ABBREV_BREAKING_MODIFIERS 0xDD // Ctrl, Alt and GUI on either side
+
+static const uint8_t *s_image = NULL;
+static esp_partition_mmap_handle_t s_mmap_handle;
+static const m4g_abbrev_header_t *s_header = NULL;
+static const m4g_abbrev_node_t *s_nodes = NULL;
+static const uint32_t *s_edges = NULL;
+static const m4g_abbrev_output_t *s_outputs = NULL;
+
+static bool abbrev_validate(const m4g_abbrev_header_t *hdr, size_t partition_size)
+{
+  if (hdr->magic != M4G_ABBREV_MAGIC || hdr->version != M4G_ABBREV_VERSION)
+    return false;
+  if (hdr->image_size > partition_size || hdr->node_count == 0 || hdr->node_count >= (1u << 24))
+    return false;
+
+  uint64_t nodes_end = (uint64_t)hdr->nodes_offset + (uint64_t)hdr->node_count * sizeof(m4g_abbrev_node_t);
+  uint64_t edges_end = (uint64_t)hdr->edges_offset + (uint64_t)hdr->edge_count * sizeof(uint32_t);
+  uint64_t outputs_end = (uint64_t)hdr->outputs_offset + (uint64_t)hdr->output_count * sizeof(m4g_abbrev_output_t);
+  return hdr->nodes_offset >= sizeof(*hdr) && (hdr->edges_offset & 3) == 0 && nodes_end <= hdr->edges_offset &&
+         edges_end <= hdr->outputs_offset && outputs_end <= hdr->image_size;
+}
+
+esp_err_t m4g_abbrev_init(void)
+{
+  if (s_header)
+    return ESP_OK;
+
+  const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                         CONFIG_M4G_ABBREV_PARTITION_LABEL);
+  if (!part)
+  {
+    LOG_AND_SAVE(true, I, ABBREV_TAG, "No '%s' partition - abbreviation expansion disabled",
+                 CONFIG_M4G_ABBREV_PARTITION_LABEL);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  const void *ptr = NULL;
+  esp_err_t err = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &s_mmap_handle);
+  if (err != ESP_OK)
+  {
+    LOG_AND_SAVE(true, E, ABBREV_TAG, "Mapping '%s' failed: %s", part->label, esp_err_to_name(err));
+    return err;
+  }
+
+  const m4g_abbrev_header_t *hdr = (const m4g_abbrev_header_t *)ptr;
+  if (part->size < sizeof(*hdr) || !abbrev_validate(hdr, part->size))
+  {
+    LOG_AND_SAVE(true, I, ABBREV_TAG, "Partition '%s' holds no abbreviation dictionary", part->label);
+    esp_partition_munmap(s_mmap_handle);
+    return ESP_ERR_INVALID_VERSION;
+  }
+
+  s_image = (const uint8_t *)ptr;
+  s_nodes = (const m4g_abbrev_node_t *)(s_image + hdr->nodes_offset);
+  s_edges = (const uint32_t *)(s_image + hdr->edges_offset);
+  s_outputs = (const m4g_abbrev_output_t *)(s_image + hdr->outputs_offset);
+  s_header = hdr;
+
+  LOG_AND_SAVE(true, I, ABBREV_TAG, "Abbreviation dictionary mapped: %u nodes, %u bytes",
+               (unsigned)hdr->node_count, (unsigned)hdr->image_size);
+  return ESP_OK;
+}
+
+bool m4g_abbrev_ready(void)
+{
+  return s_header != NULL;
+}
+
+void m4g_abbrev_reset(m4g_abbrev_matcher_t *matcher)
+{
+  matcher->depth = 0;
+  matcher->path[0] = 0;
+}
+
+// Child of node along usage: binary search over the node's sorted edges, so the
+// cost is bounded by the alphabet, not the dictionary
+static uint32_t abbrev_child(uint32_t node, uint8_t usage)
+{
+  const m4g_abbrev_node_t *n = &s_nodes[node];
+  size_t lo = 0;
+  size_t hi = n->edge_count;
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
+    uint64_t idx = (uint64_t)n->first_edge + mid;
+    if (idx >= s_header->edge_count)
+      return ABBREV_NO_NODE;
+    uint32_t edge = s_edges[idx];
+    uint8_t edge_usage = (uint8_t)(edge & 0xFF);
+    if (edge_usage == usage)
+    {
+      uint32_t child = edge >> 8;
+      return child < s_header->node_count ? child : ABBREV_NO_NODE;
+    }
+    if (edge_usage < usage)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return ABBREV_NO_NODE;
+}
+
+static inline bool abbrev_is_word_key(uint8_t usage)
+{
+  return usage >= 0x04 && usage <= 0x27; // Letters and digits
+}
+
+static inline bool abbrev_is_boundary_key(uint8_t usage)
+{
+  // Enter, Tab, Space, punctuation (- = [ ] \ # ; ' ` , . /) and keypad Enter
+  return usage == 0x28 || (usage >= 0x2B && usage <= 0x38) || usage == 0x58;
+}
+
+const m4g_abbrev_output_t *m4g_abbrev_feed(m4g_abbrev_matcher_t *matcher, uint8_t usage, uint8_t modifiers,
+                                           size_t *erase_len, size_t *out_len)
+{
+  if (!s_header)
+    return NULL;
+
+  if (modifiers & ABBREV_BREAKING_MODIFIERS)
+  {
+    m4g_abbrev_reset(matcher);
+    return NULL;
+  }
+
+  if (abbrev_is_word_key(usage))
+  {
+    uint32_t node = matcher->depth <= M4G_ABBREV_MAX_DEPTH ? matcher->path[matcher->depth] : ABBREV_NO_NODE;
+    ++matcher->depth;
+    if (matcher->depth <= M4G_ABBREV_MAX_DEPTH)
+      matcher->path[matcher->depth] = node == ABBREV_NO_NODE ? ABBREV_NO_NODE : abbrev_child(node, usage);
+    return NULL;
+  }
+
+  if (usage == 0x2A) // Backspace
+  {
+    if (matcher->depth > 0)
+      --matcher->depth;
+    return NULL;
+  }
+
+  if (!abbrev_is_boundary_key(usage))
+  {
+    m4g_abbrev_reset(matcher);
+    return NULL;
+  }
+
+  size_t depth = matcher->depth;
+  uint32_t node = depth <= M4G_ABBREV_MAX_DEPTH ? matcher->path[depth] : ABBREV_NO_NODE;
+  m4g_abbrev_reset(matcher);
+  if (depth == 0 || node == ABBREV_NO_NODE)
+    return NULL;
+
+  const m4g_abbrev_node_t *n = &s_nodes[node];
+  if (n->output_len == 0 || (uint64_t)n->output_index + n->output_len > s_header->output_count)
+    return NULL;
+
+  *erase_len = depth;
+  *out_len = n->output_len;
+  return &s_outputs[n->output_index];
+}
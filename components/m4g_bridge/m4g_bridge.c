@@ -2,10 +2,19 @@
 #include "m4g_ble.h"
 #include "m4g_logging.h"
 #include "m4g_settings.h"
+#ifdef CONFIG_M4G_LOCAL_CHORDS
+#include "m4g_chord_dict.h"
+#endif
+#ifdef CONFIG_M4G_ABBREV_EXPANSION
+#include "m4g_abbrev.h"
+#endif
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
 #include "sdkconfig.h"
 
 // Ensure boolean types are available for IntelliSense
@@ -23,7 +32,18 @@
 
 static const char *BRIDGE_TAG = "M4G-BRIDGE";
 
-#define M4G_MAX_BUFFERED_KEYS 16
+// Bridge task and input rings
+#define BRIDGE_TASK_PRIORITY 19 // Just below the USB host task so its callbacks return first
+#define BRIDGE_TASK_STACK_SIZE 4096
+#define BRIDGE_EVENT_MAX_REPORT 64 // Matches the USB transfer buffer
+#define BRIDGE_RING_DEPTH_USB 32    // Power of two
+#define BRIDGE_RING_DEPTH_ESPNOW 16 // Power of two
+#define BRIDGE_RING_DEPTH_TIMER 8   // Power of two
+#define BRIDGE_RING_DEPTH_APP 4     // Power of two
+
+// Paced keyboard output
+#define OUTPUT_QUEUE_DEPTH 32 // Keyboard states and generated outputs waiting for the link
+#define OUTPUT_MAX_REPORTS_PER_EVENT (2 * CONFIG_M4G_BLE_REPORTS_PER_EVENT)
 
 // Chord detection timing (runtime configurable)
 // - Chord delay: max time between key presses to be considered simultaneous
@@ -48,52 +68,312 @@ static const char *BRIDGE_TAG = "M4G-BRIDGE";
 #define CONFIG_M4G_MOUSE_MAX_SPEED 40
 #endif
 
-#define USB_MOUSE_HOLD_THRESHOLD_MS 50 // Consider "held" after 50ms
+#ifndef CONFIG_M4G_ARROW_MOUSE_UP_KEY
+#define CONFIG_M4G_ARROW_MOUSE_UP_KEY 0x29 // Escape
+#endif
+
+#ifndef CONFIG_M4G_ARROW_MOUSE_DOWN_KEY
+#define CONFIG_M4G_ARROW_MOUSE_DOWN_KEY 0x2A // Backspace
+#endif
+
+#ifndef CONFIG_M4G_ARROW_MOUSE_LEFT_KEY
+#define CONFIG_M4G_ARROW_MOUSE_LEFT_KEY 0x38 // Forward Slash
+#endif
+
+#ifndef CONFIG_M4G_ARROW_MOUSE_RIGHT_KEY
+#define CONFIG_M4G_ARROW_MOUSE_RIGHT_KEY 0x2E // Equals
+#endif
+
+// Set of pressed HID keyboard usages, one bit per usage (0x00-0xFF)
+#define KEY_BITMAP_WORDS 8
+
+typedef struct
+{
+  uint32_t words[KEY_BITMAP_WORDS];
+} key_bitmap_t;
+
+static inline void key_bitmap_clear(key_bitmap_t *bm) { memset(bm, 0, sizeof(*bm)); }
+
+static inline void key_bitmap_set(key_bitmap_t *bm, uint8_t key) { bm->words[key >> 5] |= 1u << (key & 31); }
+
+static inline void key_bitmap_reset(key_bitmap_t *bm, uint8_t key) { bm->words[key >> 5] &= ~(1u << (key & 31)); }
+
+static inline bool key_bitmap_test(const key_bitmap_t *bm, uint8_t key)
+{
+  return (bm->words[key >> 5] >> (key & 31)) & 1u;
+}
+
+static inline bool key_bitmap_equal(const key_bitmap_t *a, const key_bitmap_t *b)
+{
+  return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+static inline void key_bitmap_or(key_bitmap_t *dst, const key_bitmap_t *src)
+{
+  for (size_t w = 0; w < KEY_BITMAP_WORDS; ++w)
+    dst->words[w] |= src->words[w];
+}
+
+static inline size_t key_bitmap_count(const key_bitmap_t *bm)
+{
+  size_t n = 0;
+  for (size_t w = 0; w < KEY_BITMAP_WORDS; ++w)
+    n += (size_t)__builtin_popcount(bm->words[w]);
+  return n;
+}
+
+// Write up to max usages in ascending order, zero-filling the rest; returns the number written
+static size_t key_bitmap_to_array(const key_bitmap_t *bm, uint8_t *out, size_t max)
+{
+  size_t n = 0;
+  for (size_t w = 0; w < KEY_BITMAP_WORDS && n < max; ++w)
+  {
+    uint32_t bits = bm->words[w];
+    while (bits && n < max)
+    {
+      out[n++] = (uint8_t)((w << 5) | (uint32_t)__builtin_ctz(bits));
+      bits &= bits - 1;
+    }
+  }
+  for (size_t i = n; i < max; ++i)
+    out[i] = 0;
+  return n;
+}
+
+// Lowest usage in the set, or 0 if empty
+static inline uint8_t key_bitmap_first(const key_bitmap_t *bm)
+{
+  uint8_t key = 0;
+  key_bitmap_to_array(bm, &key, 1);
+  return key;
+}
+
+static inline void key_bitmap_single(key_bitmap_t *bm, uint8_t key)
+{
+  key_bitmap_clear(bm);
+  if (key != 0)
+    key_bitmap_set(bm, key);
+}
+
+static const key_bitmap_t s_no_keys = {{0}};
+
+// Keycode classes, one table load per usage on the hot path
+#define KEYCLASS_NOT_KEY 0x01   // 0x00 (none) and HID error codes 0x01-0x03
+#define KEYCLASS_BACKSPACE 0x02 // Filtered while CharaChorder chord output is expected
+#define KEYCLASS_MODIFIER 0x04  // 0xE0-0xE7; belongs in the modifier byte, not the key array
+#define KEYCLASS_MOUSE 0x08     // Arrow-mouse key, direction in bits 4-5
+#define KEYCLASS_PRINTABLE 0x40 // Types one character that a single Backspace erases
+#define KEYCLASS_MOUSE_DIR_SHIFT 4
+#define KEYCLASS_MOUSE_DIR(cls) (((cls) >> KEYCLASS_MOUSE_DIR_SHIFT) & 0x03)
+
+#define HID_USAGE_BACKSPACE 0x2A
+#define HID_MODIFIER_SHIFT_MASK 0x22 // Left and right Shift
+
+// Arrow-mouse directions, also the index into the per-key acceleration tracking
+typedef enum
+{
+  MOUSE_DIR_UP,
+  MOUSE_DIR_DOWN,
+  MOUSE_DIR_LEFT,
+  MOUSE_DIR_RIGHT,
+} mouse_dir_t;
+
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+_Static_assert(CONFIG_M4G_ARROW_MOUSE_UP_KEY != CONFIG_M4G_ARROW_MOUSE_DOWN_KEY &&
+                   CONFIG_M4G_ARROW_MOUSE_UP_KEY != CONFIG_M4G_ARROW_MOUSE_LEFT_KEY &&
+                   CONFIG_M4G_ARROW_MOUSE_UP_KEY != CONFIG_M4G_ARROW_MOUSE_RIGHT_KEY &&
+                   CONFIG_M4G_ARROW_MOUSE_DOWN_KEY != CONFIG_M4G_ARROW_MOUSE_LEFT_KEY &&
+                   CONFIG_M4G_ARROW_MOUSE_DOWN_KEY != CONFIG_M4G_ARROW_MOUSE_RIGHT_KEY &&
+                   CONFIG_M4G_ARROW_MOUSE_LEFT_KEY != CONFIG_M4G_ARROW_MOUSE_RIGHT_KEY,
+               "Arrow-mouse keys must be distinct");
+
+static const uint8_t s_arrow_mouse_keys[4] = {
+    [MOUSE_DIR_UP] = CONFIG_M4G_ARROW_MOUSE_UP_KEY,
+    [MOUSE_DIR_DOWN] = CONFIG_M4G_ARROW_MOUSE_DOWN_KEY,
+    [MOUSE_DIR_LEFT] = CONFIG_M4G_ARROW_MOUSE_LEFT_KEY,
+    [MOUSE_DIR_RIGHT] = CONFIG_M4G_ARROW_MOUSE_RIGHT_KEY,
+};
+
+#define KEYCLASS_ARROW(u)                                                                        \
+  ((u) == CONFIG_M4G_ARROW_MOUSE_UP_KEY      ? (KEYCLASS_MOUSE | (MOUSE_DIR_UP << KEYCLASS_MOUSE_DIR_SHIFT))   \
+   : (u) == CONFIG_M4G_ARROW_MOUSE_DOWN_KEY  ? (KEYCLASS_MOUSE | (MOUSE_DIR_DOWN << KEYCLASS_MOUSE_DIR_SHIFT)) \
+   : (u) == CONFIG_M4G_ARROW_MOUSE_LEFT_KEY  ? (KEYCLASS_MOUSE | (MOUSE_DIR_LEFT << KEYCLASS_MOUSE_DIR_SHIFT)) \
+   : (u) == CONFIG_M4G_ARROW_MOUSE_RIGHT_KEY ? (KEYCLASS_MOUSE | (MOUSE_DIR_RIGHT << KEYCLASS_MOUSE_DIR_SHIFT)) \
+                                             : 0)
+#else
+#define KEYCLASS_ARROW(u) 0
+#endif
+
+#define KEYCLASS_OF(u)                                                \
+  ((uint8_t)(((u) <= 0x03 ? KEYCLASS_NOT_KEY : 0) |                   \
+             ((u) == HID_USAGE_BACKSPACE ? KEYCLASS_BACKSPACE : 0) |  \
+             ((u) >= 0xE0 && (u) <= 0xE7 ? KEYCLASS_MODIFIER : 0) |   \
+             (((u) >= 0x04 && (u) <= 0x27) || (u) == 0x2C ||          \
+                      ((u) >= 0x2D && (u) <= 0x38)                    \
+                  ? KEYCLASS_PRINTABLE                                \
+                  : 0) |                                              \
+             KEYCLASS_ARROW(u)))
+#define KEYCLASS_ROW4(u) KEYCLASS_OF(u), KEYCLASS_OF((u) + 1), KEYCLASS_OF((u) + 2), KEYCLASS_OF((u) + 3)
+#define KEYCLASS_ROW16(u) KEYCLASS_ROW4(u), KEYCLASS_ROW4((u) + 4), KEYCLASS_ROW4((u) + 8), KEYCLASS_ROW4((u) + 12)
+
+static const uint8_t s_keycode_class[256] = {
+    KEYCLASS_ROW16(0x00), KEYCLASS_ROW16(0x10), KEYCLASS_ROW16(0x20), KEYCLASS_ROW16(0x30),
+    KEYCLASS_ROW16(0x40), KEYCLASS_ROW16(0x50), KEYCLASS_ROW16(0x60), KEYCLASS_ROW16(0x70),
+    KEYCLASS_ROW16(0x80), KEYCLASS_ROW16(0x90), KEYCLASS_ROW16(0xA0), KEYCLASS_ROW16(0xB0),
+    KEYCLASS_ROW16(0xC0), KEYCLASS_ROW16(0xD0), KEYCLASS_ROW16(0xE0), KEYCLASS_ROW16(0xF0),
+};
+
+// 6KRO key array; more than six keys reports ErrorRollOver (0x01) in every slot per HID spec
+static void key_bitmap_to_6kro(const key_bitmap_t *bm, uint8_t out[6])
+{
+  if (key_bitmap_count(bm) > 6)
+  {
+    memset(out, 0x01, 6);
+    return;
+  }
+  key_bitmap_to_array(bm, out, 6);
+}
+
+#ifdef CONFIG_M4G_ENABLE_NKRO
+// Whether every usage in the set is covered by the NKRO report bitmap
+static bool key_bitmap_fits_nkro(const key_bitmap_t *bm)
+{
+  for (size_t w = (M4G_BLE_NKRO_MAX_USAGE + 1) / 32; w < KEY_BITMAP_WORDS; ++w)
+  {
+    if (bm->words[w])
+      return false;
+  }
+  return true;
+}
+
+// NKRO report body: modifiers, then usage bitmap bytes (bit n of byte k = usage 8k+n)
+static void key_bitmap_to_nkro(const key_bitmap_t *bm, uint8_t modifiers, uint8_t out[M4G_BLE_NKRO_REPORT_LEN])
+{
+  out[0] = modifiers;
+  for (size_t i = 0; i + 1 < M4G_BLE_NKRO_REPORT_LEN; ++i)
+    out[1 + i] = (uint8_t)(bm->words[i >> 2] >> (8 * (i & 3)));
+}
+#endif
 
 typedef struct
 {
   bool present;
   bool is_charachorder;
   uint8_t modifiers;
-  uint8_t keys[6];
+  key_bitmap_t keys;
+  int64_t last_report_us; // USB timestamp of the previous keyboard report, 0 if none
+  bool has_mouse_layout;  // Set from the interface's report descriptor (m4g_bridge_set_mouse_layout)
+  m4g_hid_mouse_layout_t mouse_layout;
 } bridge_slot_state_t;
 
-static bridge_slot_state_t s_slots[M4G_BRIDGE_MAX_SLOTS];
-static bool s_warned_invalid_slot = false;
-
-static uint8_t s_last_kb_report[8] = {0};
-static uint8_t s_last_mouse_report[3] = {0};
-static bool s_have_kb = false;
-static bool s_have_mouse = false;
-static uint32_t s_kb_sent = 0;
-static uint32_t s_mouse_sent = 0;
+// Press/release delta from diffing a slot report against that slot's previous state
+typedef struct
+{
+  uint8_t usage;    // Key usage, or modifier bit index (0-7) when is_modifier
+  bool is_modifier;
+  bool pressed;
+} key_event_t;
 
-// USB mouse acceleration tracking
-static TickType_t s_usb_mouse_last_move_time = 0;
-static int8_t s_usb_mouse_last_dx = 0;
-static int8_t s_usb_mouse_last_dy = 0;
-static TickType_t s_usb_mouse_accel_start_time = 0;
+#define BRIDGE_MAX_KEY_EVENTS (6 + 6 + 8) // Full 6KRO release + press, plus every modifier bit
 
-#define USB_MOUSE_RELEASE_TIMEOUT_MS 200 // Consider released after 200ms of no movement
-static uint32_t s_chord_processed = 0;
-static uint32_t s_chord_delayed = 0;
-static bool s_charachorder_detected = false;
-static bool s_charachorder_both_halves = false;
+// CharaChorder slots feed the chord FSM together (a chord spans both halves);
+// every other slot bypasses it and is merged into the outgoing state directly
+typedef enum
+{
+  SLOT_GROUP_CHORD = 0,
+  SLOT_GROUP_DIRECT,
+  SLOT_GROUP_COUNT,
+} slot_group_t;
 
+// Held state of one slot group, kept up to date from key events instead of being
+// rebuilt from every slot on each report
+typedef struct
+{
+  uint8_t key_refcount[256]; // Number of slots in the group holding each usage
+  uint8_t modifier_refcount[8];
+  key_bitmap_t keys; // Usages with a non-zero refcount
+  size_t key_count;
+  uint8_t modifiers;
 #ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
-// Track when each arrow key was first pressed for acceleration
-static TickType_t s_arrow_key_press_time[4] = {0}; // [up, down, left, right]
-static uint8_t s_last_arrow_keys[4] = {0};         // Track which keys were pressed last
+  uint8_t arrow_mouse_held; // Bit per mouse_dir_t whose key is held in the group
 #endif
+} held_state_t;
+
+_Static_assert(M4G_BRIDGE_MAX_SLOTS <= UINT8_MAX, "Refcounts must hold every slot");
+_Static_assert(M4G_BRIDGE_MAX_SLOTS <= 32, "charachorder_slots holds one bit per slot");
+
+#define USB_MOUSE_RELEASE_TIMEOUT_MS 200 // Consider released after 200ms of no movement
+
+// Ranges of the BLE mouse report (M4G_BRIDGE_MOUSE_REPORT_LEN)
+#define MOUSE_REPORT_BUTTONS 0x1F     // Buttons 1-5
+#define MOUSE_REPORT_MAX_MOTION 32767 // X and Y
+#define MOUSE_REPORT_MAX_SCROLL 127   // Wheel and pan
+
+_Static_assert(M4G_BRIDGE_MOUSE_REPORT_LEN == M4G_BLE_MOUSE_REPORT_LEN, "Mouse report must match the BLE report map");
+
+// Report layout of USB interfaces that never got one from their descriptor
+static const m4g_hid_mouse_layout_t s_boot_mouse_layout = {
+    .report_id = 0x02,
+    .buttons = {.offset = 0, .bits = 8},
+    .x = {.offset = 8, .bits = 8},
+    .y = {.offset = 16, .bits = 8},
+};
+
+// Pointer acceleration state of one motion source (see mouse_accel_gain)
+typedef struct
+{
+  int64_t last_us; // Time of the previous motion (0: none yet)
+  int32_t rem_x;   // Fraction of a pixel carried to the next report (Q8)
+  int32_t rem_y;
+} mouse_accel_t;
+
+typedef enum
+{
+  BRIDGE_EVENT_REPORT = 0,
+  BRIDGE_EVENT_RESET_SLOT,
+  BRIDGE_EVENT_STATUS,
+  BRIDGE_EVENT_MOUSE_LAYOUT,
+  BRIDGE_EVENT_DEADLINE,
+  BRIDGE_EVENT_KEY_REPEAT,
+  BRIDGE_EVENT_OUTPUT,
+  BRIDGE_EVENT_TYPE_TEXT,
+  BRIDGE_EVENT_ARROW_MOUSE,
+} bridge_event_type_t;
+
+// Timestamped input event, written in place by the producer
+typedef struct
+{
+  int64_t timestamp_us;
+  uint8_t type;
+  uint8_t slot;
+  bool is_charachorder; // REPORT
+  bool detected;        // STATUS
+  bool both_halves;     // STATUS
+  bool batch_more;      // REPORT: further reports of the same batch follow
+  uint8_t len;
+  uint8_t data[BRIDGE_EVENT_MAX_REPORT];
+} bridge_event_t;
+
+// Lock-free single-producer/single-consumer ring. head is only written by the
+// producer and tail only by the bridge task; both run freely and are compared
+// modulo 2^32, so depth must be a power of two.
+typedef struct
+{
+  bridge_event_t *events;
+  uint32_t mask;
+  atomic_uint head;
+  atomic_uint tail;
+  uint32_t dropped;
+} bridge_ring_t;
 
 typedef struct
 {
   uint8_t modifiers;
-  uint8_t keys[6];
-  size_t key_count;
+  key_bitmap_t key_bits; // All pressed usages across the group's slots (mouse keys removed when moving)
+  size_t key_count;      // Number of usages in key_bits (may exceed 6)
   bool any_charachorder;
 #ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
-  int mouse_dx;
+  int mouse_dx; // Direction of the held arrow-mouse keys (-1, 0 or 1 per axis)
   int mouse_dy;
 #endif
 } combined_state_t;
@@ -104,50 +384,360 @@ typedef enum
   CHORD_STATE_COLLECTING,
   CHORD_STATE_EXPECTING_OUTPUT,
   CHORD_STATE_PASSING_OUTPUT,
+  CHORD_STATE_COUNT,
 } chord_state_t;
 
-static chord_state_t s_chord_state = CHORD_STATE_IDLE;
-static uint8_t s_chord_buffer[M4G_MAX_BUFFERED_KEYS];
-static size_t s_chord_buffer_len = 0;
-static uint8_t s_chord_buffer_modifiers = 0;
-static TickType_t s_expect_output_tick = 0;
-static bool s_output_sequence_active = false;
-static bool s_filter_backspaces = false; // Filter backspaces during chord output
-static TickType_t s_last_chord_release_tick = 0;
-static bool s_just_filtered_backspace = false;    // Flag to extend grace period
-static TickType_t s_chord_collect_start_tick = 0; // When chord collection started
-
-// Chord deviation tracking (for quality metrics)
-static TickType_t s_first_key_press_tick = 0; // When first key in chord was pressed
-static TickType_t s_last_key_press_tick = 0;  // When last key in chord was pressed
-static size_t s_chord_key_count_peak = 0;     // Max keys pressed simultaneously
+// Adaptive output grace window: a fixed-size histogram of release-to-first-output
+// latency per chord size. A chord waits for output only as long as the configured
+// percentile of past outputs plus a margin, never longer than the chord timeout.
+#define GRACE_HIST_BIN_MS 8
+#define GRACE_HIST_BINS 64        // Last bin collects everything from 504 ms up
+#define GRACE_HIST_SIZES 4        // Chords of 1, 2, 3 and 4+ keys
+#define GRACE_HIST_MIN_SAMPLES 16 // Fewer samples than this keep the static timeout
+#define GRACE_MODEL_SAVE_EVERY 32 // New samples between NVS writes
+#define GRACE_MODEL_NVS_KEY "grace_model"
+#define GRACE_MODEL_VERSION 1
+
+typedef struct
+{
+  uint16_t version;
+  uint16_t bin_ms;
+  uint16_t counts[GRACE_HIST_SIZES][GRACE_HIST_BINS];
+} grace_model_t;
+
+// Paced keyboard output queue entry (see output_pump)
+typedef enum
+{
+  OUTPUT_ENTRY_REPORT = 0, // A keyboard state
+  OUTPUT_ENTRY_KEYSTROKES, // Generated keystrokes
+  OUTPUT_ENTRY_TEXT,       // Generated text (US layout)
+  OUTPUT_ENTRY_MOUSE,      // A mouse button change (and the motion that came with it)
+} output_entry_kind_t;
+
+// Mouse motion and scrolling not yet sent, any amount
+typedef struct
+{
+  int32_t x;
+  int32_t y;
+  int32_t wheel;
+  int32_t pan;
+} mouse_motion_t;
+
+// One mouse report, within the report's ranges
+typedef struct
+{
+  uint8_t buttons;
+  int16_t dx;
+  int16_t dy;
+  int8_t wheel;
+  int8_t pan;
+} mouse_report_t;
+
+typedef struct
+{
+  uint8_t kind;
+  union
+  {
+    struct
+    {
+      bool nkro;
+      uint8_t modifiers;
+      key_bitmap_t keys;
+    } report;
+    mouse_report_t mouse;
+    struct
+    {
+      const void *src;  // m4g_bridge_keystroke_t[] or NUL-terminated text
+      uint16_t len;     // Keystrokes (OUTPUT_ENTRY_KEYSTROKES only)
+      uint16_t next;    // Next keystroke/character to press
+      uint8_t erase;    // Backspaces still to type before the keystrokes
+      uint8_t last_usage;
+      uint8_t last_modifiers;
+      bool released;    // The previous report of this job released everything
+      m4g_bridge_output_done_cb_t done;
+      void *arg;
+    } job;
+  };
+} output_entry_t;
+
+// Everything one bridge instance knows. Only the thread that drains the instance
+// touches it, apart from the producer side of the rings.
+struct m4g_bridge_ctx
+{
+  m4g_bridge_io_t io;
+  TaskHandle_t task; // Notified when an event is posted (default instance only)
+
+  // Input rings
+  bridge_event_t usb_events[BRIDGE_RING_DEPTH_USB];
+  bridge_event_t espnow_events[BRIDGE_RING_DEPTH_ESPNOW];
+  bridge_event_t timer_events[BRIDGE_RING_DEPTH_TIMER];
+  bridge_event_t app_events[BRIDGE_RING_DEPTH_APP];
+  bridge_ring_t rings[M4G_BRIDGE_SOURCE_COUNT];
+  uint32_t max_event_latency_us;
+
+  // Slots and held state
+  bridge_slot_state_t slots[M4G_BRIDGE_MAX_SLOTS];
+  uint32_t charachorder_slots; // Bit per present CharaChorder slot
+  bool warned_invalid_slot;
+  held_state_t held[SLOT_GROUP_COUNT];
+  uint32_t reports_unchanged;
+
+  // Host-visible state
+  uint8_t last_kb_report[8]; // 6KRO view of the last keyboard state sent
+  uint8_t last_kb_modifiers;
+  key_bitmap_t last_kb_keys;
+  bool last_kb_nkro; // Whether the last keyboard state went out as the NKRO report
+  // What the chord FSM presents to the host, and the ordinary keyboards' visible
+  // state that emit_keyboard_state merges on top of it
+  uint8_t chord_out_modifiers;
+  key_bitmap_t chord_out_keys;
+  uint8_t direct_modifiers;
+  key_bitmap_t direct_keys;
+  uint8_t last_mouse_report[M4G_BRIDGE_MOUSE_REPORT_LEN];
+  bool have_kb;
+  bool have_mouse;
+  uint32_t kb_sent;
+  uint32_t mouse_sent;
+
+  mouse_accel_t usb_mouse_accel;
+
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+  // Track when each arrow key was first pressed for acceleration
+  int64_t arrow_key_press_us[4]; // [up, down, left, right]
+  uint8_t last_arrow_keys[4];    // Track which keys were pressed last
+  mouse_accel_t arrow_mouse_accel;
+  int8_t arrow_mouse_dx; // Direction the host state was last given (see arrow_mouse_set_direction)
+  int8_t arrow_mouse_dy;
+  int64_t arrow_mouse_until_us; // Motion is integrated up to here
+#endif
+
+  // Chord FSM
+  uint32_t chord_processed;
+  uint32_t chord_delayed;
+  bool charachorder_detected;
+  bool charachorder_both_halves;
+  chord_state_t chord_state;
+  key_bitmap_t chord_buffer; // Every usage pressed since collection started
+  size_t chord_buffer_len;
+  uint8_t chord_buffer_modifiers;
+  int64_t expect_output_us;
+  bool output_sequence_active;
+  bool filter_backspaces; // Filter backspaces during chord output
+  int64_t last_chord_release_us;
+  bool just_filtered_backspace;  // Flag to extend grace period
+  int64_t chord_collect_start_us; // When chord collection started
+  size_t last_key_count;         // CharaChorder keys held at the previous report
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+  int64_t key_repeat_armed_us; // Deadline the repeat timer is armed for, 0 when stopped
+#endif
+
+  // Chord deviation tracking (for quality metrics)
+  int64_t chord_first_press_us; // When first key in chord was pressed (0: none yet)
+  int64_t chord_last_press_us;  // When last key in chord was pressed
+  size_t chord_key_count_peak;  // Max keys pressed simultaneously
+
+  // Speculative first-key press (chord mode): the key already sent to the host
+  uint8_t speculative_key;
+  uint32_t speculative_hits;
+  uint32_t speculative_misses;
+
+  // Robot-output burst classifier: CharaChorder output arrives with inter-report gaps
+  // far below human timing, so two reports on one slot closer than the threshold are
+  // device output rather than fingers
+  bool robot_burst;       // Current report continues a machine-speed burst
+  uint8_t robot_burst_run; // Consecutive machine-speed gaps on the last classified slot
+  bool burst_candidate;   // COLLECTING began on the first report inside the output window
+  int64_t burst_candidate_us; // Timestamp of that first report
+  uint32_t robot_bursts;
+  int64_t report_us; // USB timestamp of the report being processed
+  int64_t input_us;  // Input clock: time of the input being handled (see bridge_input_us)
+
+  // Adaptive output grace window
+  grace_model_t grace_model;
+  uint32_t grace_unsaved;   // Samples since the model was last written to NVS
+  bool grace_pending;       // A released chord has not produced output yet
+  int64_t grace_release_us; // When that chord was released
+  uint8_t grace_size;       // Its histogram row
+  uint32_t grace_window_ms; // How long it waits for output
+  uint32_t grace_early_expiries;
+  uint32_t grace_late_outputs;
+
+#ifdef CONFIG_M4G_LOCAL_CHORDS
+  // Chords resolved from the local dictionary. If the CharaChorder knows the chord
+  // too, its output is swallowed until the chord timeout after the release.
+  int64_t local_swallow_until_us;
+  uint32_t local_chords;
+#endif
+
+#ifdef CONFIG_M4G_ABBREV_EXPANSION
+  // Abbreviation expansion on ordinary keyboards. Keys still held when an expansion
+  // was typed are hidden from the host until they are released.
+  m4g_abbrev_matcher_t abbrev;
+  key_bitmap_t abbrev_masked;
+  uint32_t abbrev_expansions;
+#endif
 
 #ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-// Key repeat state
-static uint8_t s_last_key = 0;               // Last non-zero key pressed
-static uint8_t s_last_modifiers = 0;         // Modifiers for last key
-static TickType_t s_last_key_press_time = 0; // When key was first pressed
-static TickType_t s_last_repeat_time = 0;    // When last repeat was sent
-static bool s_repeat_started = false;        // Whether we've started repeating
-static bool s_in_repeat_emit = false;        // Flag to prevent recursion
-static bool s_repeat_active = false;         // Whether repeat logic is currently bypassing chord mode
-static bool s_repeat_cancel_pending = false; // Release observed while repeat emit in progress
-#endif
-
-static void compute_combined_state(combined_state_t *state);
-static void process_combined_state(const combined_state_t *state);
-static bool chord_mode_enabled(void);
-static bool use_chord_for_state(const combined_state_t *state);
-static void emit_keyboard_state(uint8_t modifiers, const uint8_t keys[6], bool allow_mouse, int mx, int my);
-static void chord_buffer_reset(void);
-static void chord_buffer_add(const combined_state_t *state);
+  // Key repeat state
+  uint8_t last_key;               // Last non-zero key pressed
+  uint8_t last_modifiers;         // Modifiers for last key
+  int64_t last_key_press_us;      // When key was first pressed
+  int64_t last_repeat_us;         // Scheduled time of the last repeat sent
+  bool repeat_started;            // Whether we've started repeating
+  bool in_repeat_emit;            // Flag to prevent recursion
+  bool repeat_active;             // Whether repeat logic is currently bypassing chord mode
+  bool repeat_cancel_pending;     // Release observed while repeat emit in progress
+  bool last_key_direct;           // last_key is held on an ordinary keyboard, not sent by the chord FSM
+#endif
+
+  // Paced keyboard output
+  output_entry_t output_queue[OUTPUT_QUEUE_DEPTH];
+  uint32_t output_head;
+  uint32_t output_tail;
+  int64_t output_window_us; // Start of the current budget interval
+  uint32_t output_credits;  // Reports that may go out before the next refill
+  uint32_t output_rate;     // Credits added per interval
+  bool output_refused;      // The stack refused a report in this interval
+  bool wire_nkro;           // Format of the last report the host received
+  bool wire_held;           // Whether it holds any key or modifier
+  uint32_t output_deferred;
+  uint32_t output_refusals;
+  uint32_t output_dropped;
+
+  // USB mouse motion not yet sent, and the buttons the host was last given
+  mouse_motion_t mouse_acc;
+  uint8_t mouse_buttons;
+  int64_t mouse_next_us; // Motion goes out at most once per interval, from here on
+  uint32_t mouse_merged;
+
+  // Keyboard state staged while a report batch is applied (see output_batch_stage)
+  uint32_t batch_sources; // Bit per source whose batch is still open
+  bool batch_pending;
+  bool batch_nkro;
+  uint8_t batch_modifiers;
+  key_bitmap_t batch_keys;
+  uint8_t batch_base_modifiers; // What the host holds before the staged state
+  key_bitmap_t batch_base_keys;
+  uint32_t reports_coalesced;
+};
+
+// Bridge clock: microseconds from the instance's io (esp_timer on the target, the
+// virtual clock on the host). Every timestamp and deadline of the bridge is kept
+// in it, so no decision is rounded to the FreeRTOS tick.
+static inline int64_t bridge_now_us(m4g_bridge_ctx_t *ctx)
+{
+  return ctx->io.now_us(ctx->io.user);
+}
+
+// Input clock: the chord FSM and key repeat run at the time of the report or
+// timer they are handling rather than when the bridge task gets to it, so a
+// batch delivered late is timed like the same reports delivered live
+static inline int64_t bridge_input_us(const m4g_bridge_ctx_t *ctx)
+{
+  return ctx->input_us;
+}
+
+static inline int64_t ms_to_us(uint32_t ms)
+{
+  return (int64_t)ms * 1000;
+}
+
+static inline bool bridge_link_ready(m4g_bridge_ctx_t *ctx)
+{
+  return ctx->io.link_ready(ctx->io.user);
+}
+
+static inline void bridge_set_timer(m4g_bridge_ctx_t *ctx, m4g_bridge_timer_t timer, int64_t due_us)
+{
+  ctx->io.set_timer(ctx->io.user, timer, due_us);
+}
+
+static inline slot_group_t slot_group(bool is_charachorder)
+{
+  return is_charachorder ? SLOT_GROUP_CHORD : SLOT_GROUP_DIRECT;
+}
+
+static inline bool key_held_anywhere(m4g_bridge_ctx_t *ctx, uint8_t usage)
+{
+  return ctx->held[SLOT_GROUP_CHORD].key_refcount[usage] != 0 || ctx->held[SLOT_GROUP_DIRECT].key_refcount[usage] != 0;
+}
+
+// Producer side: slot to fill in place, or NULL if the ring is full
+static bridge_event_t *ring_reserve(bridge_ring_t *ring)
+{
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  if (head - tail > ring->mask)
+  {
+    ++ring->dropped;
+    return NULL;
+  }
+  return &ring->events[head & ring->mask];
+}
+
+// Producer side: make the next count filled slots visible at once and wake the bridge task
+static void ring_publish_many(m4g_bridge_ctx_t *ctx, bridge_ring_t *ring, uint32_t count)
+{
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  atomic_store_explicit(&ring->head, head + count, memory_order_release);
+  if (ctx->task)
+    xTaskNotifyGive(ctx->task);
+}
+
+// Producer side: make the reserved slot visible and wake the bridge task
+static void ring_publish(m4g_bridge_ctx_t *ctx, bridge_ring_t *ring)
+{
+  ring_publish_many(ctx, ring, 1);
+}
+
+// Consumer side: oldest unconsumed event, or NULL if the ring is empty
+static bridge_event_t *ring_peek(bridge_ring_t *ring)
+{
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  if (head == tail)
+    return NULL;
+  return &ring->events[tail & ring->mask];
+}
+
+// Consumer side: release the event returned by ring_peek
+static void ring_consume(bridge_ring_t *ring)
+{
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+static void compute_combined_state(m4g_bridge_ctx_t *ctx, combined_state_t *state, slot_group_t group);
+static void process_combined_state(m4g_bridge_ctx_t *ctx, const combined_state_t *state, const key_event_t *events,
+                                   size_t n_events);
+static bool chord_mode_enabled(m4g_bridge_ctx_t *ctx);
+static bool use_chord_for_state(m4g_bridge_ctx_t *ctx, const combined_state_t *state);
+static void emit_keyboard_state(m4g_bridge_ctx_t *ctx, uint8_t modifiers, const key_bitmap_t *keys, bool allow_mouse,
+                                int mx, int my);
+static void chord_buffer_reset(m4g_bridge_ctx_t *ctx);
+static void chord_buffer_start(m4g_bridge_ctx_t *ctx, const combined_state_t *state);
+static void chord_buffer_add(m4g_bridge_ctx_t *ctx, const combined_state_t *state, const key_event_t *events,
+                             size_t n_events);
+static void chord_deadline_update(m4g_bridge_ctx_t *ctx);
+static void chord_deadline_expired(m4g_bridge_ctx_t *ctx, int64_t now_us);
+static void speculation_begin(m4g_bridge_ctx_t *ctx, const combined_state_t *state);
+static void speculation_rollback(m4g_bridge_ctx_t *ctx);
+static uint32_t chord_output_grace_ms(m4g_bridge_ctx_t *ctx);
+static void grace_model_load(m4g_bridge_ctx_t *ctx);
+static void output_init(m4g_bridge_ctx_t *ctx);
+static void bridge_handle_reset_slot(m4g_bridge_ctx_t *ctx, uint8_t slot);
+static void bridge_task(void *arg);
 #ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-static void emit_repeat_cycle(uint8_t key, uint8_t modifiers);
-static bool is_key_currently_active(uint8_t key);
-static bool start_repeat_from_held_key(TickType_t now, TickType_t collect_duration, uint32_t repeat_delay_ms);
+static void emit_repeat_cycle(m4g_bridge_ctx_t *ctx, uint8_t key, uint8_t modifiers);
+static bool is_key_currently_active(m4g_bridge_ctx_t *ctx, uint8_t key);
+static bool start_repeat_from_held_key(m4g_bridge_ctx_t *ctx, int64_t collect_us, uint32_t repeat_delay_ms);
+static void key_repeat_update(m4g_bridge_ctx_t *ctx);
 #endif
 
-static size_t extract_chara_keys(const uint8_t *kb_payload, size_t len, uint8_t *out6, bool is_charachorder)
+// Collect the key array into out. Modifier usages found in the array are folded into
+// *modifiers so the key set only ever holds non-modifier usages.
+static size_t extract_chara_keys(m4g_bridge_ctx_t *ctx, const uint8_t *kb_payload, size_t len, key_bitmap_t *out,
+                                 uint8_t *modifiers, bool is_charachorder)
 {
   size_t n = 0;
   if (len < 8)
@@ -156,415 +746,776 @@ static size_t extract_chara_keys(const uint8_t *kb_payload, size_t len, uint8_t
   // Check if we should filter backspaces (during chord output phase)
   // Allow a 500ms window after chord release for CharaChorder to send cleanup backspaces
   bool filter_backspace_now = false;
-  if (is_charachorder && s_filter_backspaces)
+  if (is_charachorder && ctx->filter_backspaces)
   {
-    TickType_t elapsed = xTaskGetTickCount() - s_last_chord_release_tick;
-    if (elapsed < pdMS_TO_TICKS(500))
+    int64_t elapsed_us = bridge_input_us(ctx) - ctx->last_chord_release_us;
+    if (elapsed_us < ms_to_us(500))
     {
       filter_backspace_now = true;
     }
     else
     {
       // Timeout expired - stop filtering
-      s_filter_backspaces = false;
+      ctx->filter_backspaces = false;
     }
   }
 
   // Track if we filtered any backspaces (to extend grace period)
-  s_just_filtered_backspace = false;
+  ctx->just_filtered_backspace = false;
 
   for (size_t i = 2; i < len && n < 6; ++i)
   {
     uint8_t key = kb_payload[i];
-    // Filter out HID error codes (0x01-0x03) and zeros
-    // 0x01 = ErrorRollOver (too many keys/buffer overflow)
-    // 0x02 = POSTFail
-    // 0x03 = ErrorUndefined
-    // Also filter out 0x2A (Backspace/Delete) during CharaChorder chord output
+    uint8_t cls = s_keycode_class[key];
+
+    // Skip zeros and HID error codes (ErrorRollOver, POSTFail, ErrorUndefined)
+    if (cls & KEYCLASS_NOT_KEY)
+      continue;
+
+    // Filter out Backspace during CharaChorder chord output
     // CharaChorder sends backspaces to erase individual chord keys,
     // but we pass keys through immediately so there's nothing to erase
-    bool is_backspace = (key == 0x2A);
-    bool should_filter = (is_backspace && filter_backspace_now);
+    if ((cls & KEYCLASS_BACKSPACE) && filter_backspace_now)
+    {
+      ctx->just_filtered_backspace = true;
+      continue;
+    }
 
-    if (should_filter)
+    if (cls & KEYCLASS_MODIFIER)
     {
-      s_just_filtered_backspace = true;
+      *modifiers |= (uint8_t)(1u << (key & 0x07));
+      continue;
     }
 
-    if (key != 0 && key > 0x03 && !should_filter)
-      out6[n++] = key;
+    key_bitmap_set(out, key);
+    ++n;
   }
 
   return n;
 }
 
-static void chord_buffer_reset(void)
+static void chord_buffer_reset(m4g_bridge_ctx_t *ctx)
 {
-  memset(s_chord_buffer, 0, sizeof(s_chord_buffer));
-  s_chord_buffer_len = 0;
-  s_chord_buffer_modifiers = 0;
-  s_output_sequence_active = false;
+  ctx->speculative_key = 0;
+  key_bitmap_clear(&ctx->chord_buffer);
+  ctx->chord_buffer_len = 0;
+  ctx->chord_buffer_modifiers = 0;
+  ctx->output_sequence_active = false;
+  ctx->burst_candidate = false;
 
   // Reset deviation tracking
-  s_first_key_press_tick = 0;
-  s_last_key_press_tick = 0;
-  s_chord_key_count_peak = 0;
+  ctx->chord_first_press_us = 0;
+  ctx->chord_last_press_us = 0;
+  ctx->chord_key_count_peak = 0;
+}
+
+// Begin a new collection from everything currently held
+static void chord_buffer_start(m4g_bridge_ctx_t *ctx, const combined_state_t *state)
+{
+  chord_buffer_reset(ctx);
+  ctx->chord_buffer = state->key_bits;
+  ctx->chord_buffer_len = state->key_count;
+  ctx->chord_buffer_modifiers = state->modifiers;
+  ctx->chord_key_count_peak = state->key_count;
+  if (state->key_count > 0)
+  {
+    ctx->chord_first_press_us = bridge_input_us(ctx);
+    ctx->chord_last_press_us = ctx->chord_first_press_us;
+  }
 }
 
-static void chord_buffer_add(const combined_state_t *state)
+// Extend the collection with the usages pressed by this report
+static void chord_buffer_add(m4g_bridge_ctx_t *ctx, const combined_state_t *state, const key_event_t *events,
+                             size_t n_events)
 {
-  TickType_t now = xTaskGetTickCount();
+  int64_t now_us = bridge_input_us(ctx);
   bool added_new_key = false;
 
-  s_chord_buffer_modifiers |= state->modifiers;
-  for (size_t i = 0; i < state->key_count; ++i)
+  ctx->chord_buffer_modifiers |= state->modifiers;
+  for (size_t i = 0; i < n_events; ++i)
   {
-    uint8_t key = state->keys[i];
-    if (key == 0)
+    uint8_t usage = events[i].usage;
+    if (!events[i].pressed || events[i].is_modifier)
       continue;
-    bool already_present = false;
-    for (size_t j = 0; j < s_chord_buffer_len; ++j)
-    {
-      if (s_chord_buffer[j] == key)
-      {
-        already_present = true;
-        break;
-      }
-    }
-    if (!already_present && s_chord_buffer_len < M4G_MAX_BUFFERED_KEYS)
-    {
-      s_chord_buffer[s_chord_buffer_len++] = key;
-      added_new_key = true;
-    }
+    // Arrow-mouse keys that are moving the pointer are not part of the chord
+    if (!key_bitmap_test(&state->key_bits, usage) || key_bitmap_test(&ctx->chord_buffer, usage))
+      continue;
+    key_bitmap_set(&ctx->chord_buffer, usage);
+    ++ctx->chord_buffer_len;
+    added_new_key = true;
   }
 
   // Track press timing for deviation metrics
   if (added_new_key)
   {
-    if (s_first_key_press_tick == 0)
+    if (ctx->chord_first_press_us == 0)
     {
-      s_first_key_press_tick = now;
+      ctx->chord_first_press_us = now_us;
     }
-    s_last_key_press_tick = now;
+    ctx->chord_last_press_us = now_us;
   }
 
   // Track peak simultaneous key count
-  if (state->key_count > s_chord_key_count_peak)
+  if (state->key_count > ctx->chord_key_count_peak)
   {
-    s_chord_key_count_peak = state->key_count;
+    ctx->chord_key_count_peak = state->key_count;
   }
 }
 
-static bool chord_mode_enabled(void)
+static bool chord_mode_enabled(m4g_bridge_ctx_t *ctx)
 {
 #ifdef CONFIG_M4G_CHARACHORDER_RAW_MODE
   if (CONFIG_M4G_CHARACHORDER_RAW_MODE)
     return false;
 #endif
-  if (!s_charachorder_detected)
+  if (!ctx->charachorder_detected)
     return false;
 #ifdef CONFIG_M4G_CHARACHORDER_REQUIRE_BOTH_HALVES
-  if (CONFIG_M4G_CHARACHORDER_REQUIRE_BOTH_HALVES && !s_charachorder_both_halves)
+  if (CONFIG_M4G_CHARACHORDER_REQUIRE_BOTH_HALVES && !ctx->charachorder_both_halves)
     return false;
 #endif
   return true;
 }
 
-static bool use_chord_for_state(const combined_state_t *state)
+static bool use_chord_for_state(m4g_bridge_ctx_t *ctx, const combined_state_t *state)
 {
   if (!state)
     return false;
   if (!state->any_charachorder)
     return false;
-  return chord_mode_enabled();
+  return chord_mode_enabled(ctx);
 }
 
-// Apply acceleration to USB mouse movement based on continuous direction
-static void apply_usb_mouse_acceleration(int8_t *dx, int8_t *dy)
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+// Hold time after which a single key in chord collection is treated as held:
+// the repeat delay, capped by the chord timeout
+static uint32_t held_key_threshold_ms(void)
 {
-  TickType_t now = xTaskGetTickCount();
-
-  // Determine movement direction (normalize to -1, 0, or 1)
-  int8_t dir_x = (*dx > 0) ? 1 : ((*dx < 0) ? -1 : 0);
-  int8_t dir_y = (*dy > 0) ? 1 : ((*dy < 0) ? -1 : 0);
+  uint32_t repeat_delay_ms = m4g_settings_get_key_repeat_delay_ms();
+  uint32_t chord_timeout_ms = m4g_settings_get_chord_timeout_ms();
+  uint32_t hold_threshold_ms = repeat_delay_ms;
 
-  // Check if movement stopped (timeout for key release detection)
-  TickType_t time_since_last = now - s_usb_mouse_last_move_time;
-  uint32_t idle_ms = time_since_last * portTICK_PERIOD_MS;
+  if (hold_threshold_ms == 0 || (chord_timeout_ms > 0 && chord_timeout_ms < hold_threshold_ms))
+  {
+    if (chord_timeout_ms > 0)
+      hold_threshold_ms = chord_timeout_ms;
+  }
+  return hold_threshold_ms;
+}
+#endif
 
-  if (idle_ms > USB_MOUSE_RELEASE_TIMEOUT_MS || (dir_x == 0 && dir_y == 0))
+// Deadline of the current chord state, if it has one
+static bool chord_state_deadline(m4g_bridge_ctx_t *ctx, int64_t *deadline_us)
+{
+  switch (ctx->chord_state)
   {
-    // No movement for timeout period or explicit stop - reset acceleration
-    if (ENABLE_DEBUG_KEYPRESS_LOGGING && s_usb_mouse_accel_start_time != 0)
+  case CHORD_STATE_COLLECTING:
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+    if (ctx->chord_buffer_len == 1)
     {
-      LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                   "Mouse accel RESET (idle=%lums, timeout=%ums)",
-                   (unsigned long)idle_ms, USB_MOUSE_RELEASE_TIMEOUT_MS);
+      *deadline_us = ctx->chord_collect_start_us + ms_to_us(held_key_threshold_ms());
+      return true;
     }
-    s_usb_mouse_last_dx = dir_x;
-    s_usb_mouse_last_dy = dir_y;
-    s_usb_mouse_last_move_time = now;
-    s_usb_mouse_accel_start_time = 0; // Reset start time
-
-    // Tap = 5px
-    if (dir_x != 0)
-      *dx = dir_x * 5;
-    if (dir_y != 0)
-      *dy = dir_y * 5;
-    return;
+#endif
+    return false;
+  case CHORD_STATE_EXPECTING_OUTPUT:
+    *deadline_us = ctx->expect_output_us + ms_to_us(chord_output_grace_ms(ctx));
+    return true;
+  default:
+    return false;
   }
+}
 
-  // Movement detected - update last move time
-  s_usb_mouse_last_move_time = now;
+// Re-arm (or stop) the deadline timer to match the current chord state.
+// Called after every state change; expires the deadline inline if already due.
+static void chord_deadline_update(m4g_bridge_ctx_t *ctx)
+{
+  bridge_set_timer(ctx, M4G_BRIDGE_TIMER_CHORD_DEADLINE, 0);
+
+  int64_t deadline_us;
+  if (!chord_state_deadline(ctx, &deadline_us))
+    return;
 
-  // If this is the first movement after idle, start acceleration timer
-  if (s_usb_mouse_accel_start_time == 0)
+  int64_t now_us = bridge_input_us(ctx);
+  if (deadline_us <= now_us)
   {
-    s_usb_mouse_accel_start_time = now;
+    chord_deadline_expired(ctx, now_us);
+    if (!chord_state_deadline(ctx, &deadline_us))
+      return;
+    if (deadline_us <= now_us)
+      deadline_us = now_us + 1;
   }
+  bridge_set_timer(ctx, M4G_BRIDGE_TIMER_CHORD_DEADLINE, deadline_us);
+}
 
-  // Calculate time since movement started
-  TickType_t accel_duration = now - s_usb_mouse_accel_start_time;
-  uint32_t accel_ms = accel_duration * portTICK_PERIOD_MS;
+// Runs wherever the instance's timers fire (the esp_timer task for the default
+// instance): only posts the expiry, the bridge task acts on it
+void m4g_bridge_ctx_timer_expired(m4g_bridge_ctx_t *ctx, m4g_bridge_timer_t timer)
+{
+  static const uint8_t timer_events[M4G_BRIDGE_TIMER_COUNT] = {
+      [M4G_BRIDGE_TIMER_CHORD_DEADLINE] = BRIDGE_EVENT_DEADLINE,
+      [M4G_BRIDGE_TIMER_KEY_REPEAT] = BRIDGE_EVENT_KEY_REPEAT,
+      [M4G_BRIDGE_TIMER_OUTPUT] = BRIDGE_EVENT_OUTPUT,
+      [M4G_BRIDGE_TIMER_ARROW_MOUSE] = BRIDGE_EVENT_ARROW_MOUSE,
+  };
+  if (!ctx || (unsigned)timer >= M4G_BRIDGE_TIMER_COUNT)
+    return;
 
-  int speed;
-  if (accel_ms < USB_MOUSE_HOLD_THRESHOLD_MS)
-  {
-    // Still in tap mode (< 50ms)
-    speed = 5;
-  }
-  else if (accel_ms < 1000)
-  {
-    // Held: ramp from 10px to 40px over 1 second
-    // Linear interpolation: 10 + (30 * progress)
-    uint32_t held_ms = accel_ms - USB_MOUSE_HOLD_THRESHOLD_MS;
-    speed = 10 + (30 * held_ms / 1000);
-  }
-  else
-  {
-    // After 1 second, stay at max
-    speed = 40;
-  }
+  bridge_ring_t *ring = &ctx->rings[M4G_BRIDGE_SOURCE_TIMER];
+  bridge_event_t *ev = ring_reserve(ring);
+  if (!ev)
+    return;
+  ev->timestamp_us = bridge_now_us(ctx);
+  ev->type = timer_events[timer];
+  ring_publish(ctx, ring);
+}
 
-  if (ENABLE_DEBUG_KEYPRESS_LOGGING && accel_ms > USB_MOUSE_HOLD_THRESHOLD_MS)
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+// Arm the repeat timer at the tracked key's next initial-delay or repeat-rate
+// deadline, or stop it once no key is tracked
+static void key_repeat_update(m4g_bridge_ctx_t *ctx)
+{
+  int64_t due_us = 0;
+  if (ctx->last_key != 0 && !m4g_settings_is_host_typematic_enabled())
   {
-    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                 "Mouse accel: speed=%dpx (held_ms=%lu)",
-                 speed, (unsigned long)(accel_ms - USB_MOUSE_HOLD_THRESHOLD_MS));
+    if (ctx->repeat_started)
+      due_us = ctx->last_repeat_us + (int64_t)m4g_settings_get_key_repeat_rate_ms() * 1000;
+    else
+      due_us = ctx->last_key_press_us + (int64_t)m4g_settings_get_key_repeat_delay_ms() * 1000;
   }
 
-  // Apply speed
-  if (dir_x != 0)
-    *dx = dir_x * speed;
-  if (dir_y != 0)
-    *dy = dir_y * speed;
+  // A deadline still in the future is still armed; a passed one has fired
+  int64_t now_us = bridge_input_us(ctx);
+  if (due_us == ctx->key_repeat_armed_us && (due_us == 0 || due_us > now_us))
+    return;
+
+  ctx->key_repeat_armed_us = due_us;
+  bridge_set_timer(ctx, M4G_BRIDGE_TIMER_KEY_REPEAT, due_us == 0 || due_us > now_us ? due_us : now_us + 1);
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Pointer acceleration
+//
+// One engine for USB mice and the arrow-key mouse. The speed of the motion
+// (counts per ms, Q8) picks a gain (Q8, 256 = 1:1) from the curve selected in
+// settings, interpolated between its points, and the scaled motion carries its
+// fraction of a pixel per axis into the next report. USB mice measure their speed
+// from each report's motion and the time since the previous one; arrow keys have
+// no speed, so their hold time stands in for it.
+// ---------------------------------------------------------------------------
+
+#define MOUSE_ACCEL_POINTS 16       // Curve points at 0, 1, ... 15 counts per ms
+#define MOUSE_ACCEL_MIN_DT_US 125   // 8 kHz polling, the fastest a USB mouse reports
+#define MOUSE_ACCEL_MAX_DT_US 16000 // First report after a pause: slow, but not a crawl
+
+static const uint16_t s_mouse_accel_curves[M4G_MOUSE_ACCEL_CURVE_COUNT][MOUSE_ACCEL_POINTS] = {
+    [M4G_MOUSE_ACCEL_FLAT] = {256, 256, 256, 256, 256, 256, 256, 256, 256, 256, 256, 256, 256, 256, 256, 256},
+    [M4G_MOUSE_ACCEL_LOW] = {256, 256, 288, 320, 352, 384, 416, 448, 480, 512, 512, 512, 512, 512, 512, 512},
+    [M4G_MOUSE_ACCEL_MEDIUM] = {192, 256, 320, 384, 448, 512, 560, 608, 640, 672, 704, 736, 768, 768, 768, 768},
+    [M4G_MOUSE_ACCEL_HIGH] = {192, 256, 384, 512, 640, 768, 864, 960, 1040, 1104, 1152, 1200, 1240, 1264, 1280, 1280},
+};
+
+static const uint16_t *mouse_accel_curve(void)
+{
+  m4g_mouse_accel_curve_t curve = m4g_settings_get_mouse_accel_curve();
+  return s_mouse_accel_curves[curve < M4G_MOUSE_ACCEL_CURVE_COUNT ? curve : M4G_MOUSE_ACCEL_FLAT];
+}
 
-  // Update direction tracking
-  s_usb_mouse_last_dx = dir_x;
-  s_usb_mouse_last_dy = dir_y;
+// Gain (Q8) at a speed (counts per ms, Q8), flat past the last point
+static uint32_t mouse_accel_gain(const uint16_t *curve, uint32_t speed_q8)
+{
+  uint32_t i = speed_q8 >> 8;
+  if (i >= MOUSE_ACCEL_POINTS - 1)
+    return curve[MOUSE_ACCEL_POINTS - 1];
+  uint32_t frac = speed_q8 & 0xFF;
+  return (curve[i] * (256 - frac) + curve[i + 1] * frac) >> 8;
 }
 
-#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
-// Calculate accelerated mouse speed based on how long key has been held
-static int calculate_mouse_speed(uint8_t keycode, size_t arrow_index)
+// Whole pixels of a Q8 motion plus the carried fraction; the new fraction stays in *rem
+static int32_t mouse_accel_carry(int32_t *rem, int32_t motion_q8)
 {
-  TickType_t now = xTaskGetTickCount();
-  int base_speed = CONFIG_M4G_MOUSE_BASE_SPEED;
+  int32_t total = *rem + motion_q8;
+  int32_t px = total / 256; // Toward zero, so the fraction keeps the motion's sign
+  *rem = total - px * 256;
+  return px;
+}
+
+// Scale a USB mouse report's motion by the curve at the speed it was moving
+static void apply_usb_mouse_acceleration(m4g_bridge_ctx_t *ctx, int64_t timestamp_us, int32_t *dx, int32_t *dy)
+{
+  mouse_accel_t *accel = &ctx->usb_mouse_accel;
+  if (*dx == 0 && *dy == 0)
+    return;
 
-  // Check if this is a new key press or continuation
-  if (s_last_arrow_keys[arrow_index] != keycode)
+  int64_t dt_us = accel->last_us ? timestamp_us - accel->last_us : MOUSE_ACCEL_MAX_DT_US;
+  if (dt_us > (int64_t)USB_MOUSE_RELEASE_TIMEOUT_MS * 1000)
   {
-    // New key press - reset timer and use base speed
-    s_last_arrow_keys[arrow_index] = keycode;
-    s_arrow_key_press_time[arrow_index] = now;
-    return base_speed;
+    // A new movement: a fraction left from the last one would only nudge its first pixel
+    accel->rem_x = 0;
+    accel->rem_y = 0;
   }
+  if (dt_us < MOUSE_ACCEL_MIN_DT_US)
+    dt_us = MOUSE_ACCEL_MIN_DT_US;
+  else if (dt_us > MOUSE_ACCEL_MAX_DT_US)
+    dt_us = MOUSE_ACCEL_MAX_DT_US;
+  accel->last_us = timestamp_us;
+
+  // Length of the motion without a square root (max + 3/8 min, within 7%)
+  uint32_t ax = (uint32_t)abs(*dx);
+  uint32_t ay = (uint32_t)abs(*dy);
+  uint32_t len = ax > ay ? ax + (3 * ay >> 3) : ay + (3 * ax >> 3);
+  uint32_t speed_q8 = (uint32_t)(((int64_t)len << 8) * 1000 / dt_us);
+  int32_t gain = (int32_t)mouse_accel_gain(mouse_accel_curve(), speed_q8);
+
+  *dx = mouse_accel_carry(&accel->rem_x, *dx * gain);
+  *dy = mouse_accel_carry(&accel->rem_y, *dy * gain);
+}
 
-#ifdef CONFIG_M4G_MOUSE_ENABLE_ACCELERATION
-  // Key is being held - calculate acceleration
-  TickType_t held_duration = now - s_arrow_key_press_time[arrow_index];
-  uint32_t held_ms = held_duration * portTICK_PERIOD_MS;
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+// Hold time that takes the arrow-key mouse to the top of the curve: where the
+// Kconfig ramp (base speed, plus the increment every interval) reaches max speed
+#define ARROW_MOUSE_RAMP_MS                                                                                       \
+  (CONFIG_M4G_MOUSE_MAX_SPEED > CONFIG_M4G_MOUSE_BASE_SPEED                                                       \
+       ? (CONFIG_M4G_MOUSE_MAX_SPEED - CONFIG_M4G_MOUSE_BASE_SPEED) * CONFIG_M4G_MOUSE_ACCEL_INTERVAL_MS /        \
+             CONFIG_M4G_MOUSE_ACCEL_INCREMENT                                                                     \
+       : 1)
+
+// Arrow-key speeds (the Kconfig base and max speed) are pixels per this period
+#define ARROW_MOUSE_SPEED_PERIOD_US 16000
+
+// Start the hold time of a newly pressed arrow-mouse key
+static void arrow_mouse_note_press(m4g_bridge_ctx_t *ctx, uint8_t keycode, size_t arrow_index)
+{
+  if (ctx->last_arrow_keys[arrow_index] != keycode)
+  {
+    ctx->last_arrow_keys[arrow_index] = keycode;
+    ctx->arrow_key_press_us[arrow_index] = bridge_now_us(ctx);
+  }
+}
+
+// Arrow-key speed for one held direction (pixels per ARROW_MOUSE_SPEED_PERIOD_US,
+// Q8): the base speed scaled by the curve's gain at the hold time, relative to its
+// gain at rest
+static int32_t calculate_mouse_speed(m4g_bridge_ctx_t *ctx, size_t arrow_index)
+{
+  int32_t base_q8 = CONFIG_M4G_MOUSE_BASE_SPEED << 8;
 
-  // Calculate speed: base + (increments based on time held)
-  uint32_t accel_steps = held_ms / CONFIG_M4G_MOUSE_ACCEL_INTERVAL_MS;
-  int speed = base_speed + (accel_steps * CONFIG_M4G_MOUSE_ACCEL_INCREMENT);
+#ifdef CONFIG_M4G_MOUSE_ENABLE_ACCELERATION
+  // Key is being held - the hold time maps onto the curve's speed range
+  uint32_t held_ms = (uint32_t)((bridge_now_us(ctx) - ctx->arrow_key_press_us[arrow_index]) / 1000);
+  uint32_t speed_q8 = held_ms >= ARROW_MOUSE_RAMP_MS
+                          ? (MOUSE_ACCEL_POINTS - 1) << 8
+                          : (uint32_t)(((uint64_t)held_ms << 8) * (MOUSE_ACCEL_POINTS - 1) / ARROW_MOUSE_RAMP_MS);
+  const uint16_t *curve = mouse_accel_curve();
+  int32_t speed = (int32_t)((int64_t)base_q8 * mouse_accel_gain(curve, speed_q8) / curve[0]);
 
   // Cap at maximum speed
-  if (speed > CONFIG_M4G_MOUSE_MAX_SPEED)
+  if (speed > CONFIG_M4G_MOUSE_MAX_SPEED << 8)
   {
-    speed = CONFIG_M4G_MOUSE_MAX_SPEED;
+    speed = CONFIG_M4G_MOUSE_MAX_SPEED << 8;
   }
 
   return speed;
 #else
-  return base_speed;
+  (void)ctx;
+  (void)arrow_index;
+  return base_q8;
 #endif
 }
 
 // Reset arrow key tracking when key is released
-static void reset_arrow_key_if_released(uint8_t keycode, size_t arrow_index, bool is_pressed)
+static void reset_arrow_key_if_released(m4g_bridge_ctx_t *ctx, uint8_t keycode, size_t arrow_index, bool is_pressed)
 {
-  if (!is_pressed && s_last_arrow_keys[arrow_index] == keycode)
+  if (!is_pressed && ctx->last_arrow_keys[arrow_index] == keycode)
   {
-    s_last_arrow_keys[arrow_index] = 0;
-    s_arrow_key_press_time[arrow_index] = 0;
+    ctx->last_arrow_keys[arrow_index] = 0;
+    ctx->arrow_key_press_us[arrow_index] = 0;
   }
 }
 #endif
 
-static void compute_combined_state(combined_state_t *state)
+// Diff a slot's new modifiers and keys against its previous state. Releases are
+// listed before presses so a key moving between slots never drops to zero.
+static size_t diff_slot_keys(const bridge_slot_state_t *prev, uint8_t modifiers, const key_bitmap_t *keys,
+                             key_event_t events[BRIDGE_MAX_KEY_EVENTS])
 {
-  memset(state, 0, sizeof(*state));
-
-  uint8_t combined_keys[6] = {0};
-  size_t combined_count = 0;
+  size_t n = 0;
 
-  for (uint8_t slot = 0; slot < M4G_BRIDGE_MAX_SLOTS; ++slot)
+  for (int pass = 0; pass < 2; ++pass)
   {
-    if (!s_slots[slot].present)
-      continue;
-
-    if (s_slots[slot].is_charachorder)
-      state->any_charachorder = true;
+    bool pressed = (pass == 1);
+    uint8_t mod_bits = (uint8_t)((prev->modifiers ^ modifiers) & (pressed ? modifiers : prev->modifiers));
+    for (uint8_t bit = 0; bit < 8 && n < BRIDGE_MAX_KEY_EVENTS; ++bit)
+    {
+      if (mod_bits & (1u << bit))
+        events[n++] = (key_event_t){.usage = bit, .is_modifier = true, .pressed = pressed};
+    }
 
-    state->modifiers |= s_slots[slot].modifiers;
-    for (size_t i = 0; i < 6; ++i)
+    for (size_t w = 0; w < KEY_BITMAP_WORDS; ++w)
     {
-      uint8_t key = s_slots[slot].keys[i];
-      if (key == 0)
-        continue;
-      bool already_present = false;
-      for (size_t j = 0; j < combined_count; ++j)
+      uint32_t bits = (prev->keys.words[w] ^ keys->words[w]) & (pressed ? keys->words[w] : prev->keys.words[w]);
+      while (bits && n < BRIDGE_MAX_KEY_EVENTS)
       {
-        if (combined_keys[j] == key)
-        {
-          already_present = true;
-          break;
-        }
+        uint8_t usage = (uint8_t)((w << 5) | (uint32_t)__builtin_ctz(bits));
+        events[n++] = (key_event_t){.usage = usage, .is_modifier = false, .pressed = pressed};
+        bits &= bits - 1;
       }
-      if (!already_present && combined_count < 6)
+    }
+  }
+
+  return n;
+}
+
+// Fold key events into the group's cross-slot refcounts and held sets
+static void apply_key_events(m4g_bridge_ctx_t *ctx, slot_group_t group, const key_event_t *events, size_t n_events)
+{
+  held_state_t *held = &ctx->held[group];
+  for (size_t i = 0; i < n_events; ++i)
+  {
+    const key_event_t *ev = &events[i];
+    uint8_t *count = ev->is_modifier ? &held->modifier_refcount[ev->usage] : &held->key_refcount[ev->usage];
+
+    if (ev->pressed)
+    {
+      if ((*count)++ != 0)
+        continue;
+      if (ev->is_modifier)
+      {
+        held->modifiers |= (uint8_t)(1u << ev->usage);
+      }
+      else
+      {
+        key_bitmap_set(&held->keys, ev->usage);
+        ++held->key_count;
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+        uint8_t cls = s_keycode_class[ev->usage];
+        if (cls & KEYCLASS_MOUSE)
+          held->arrow_mouse_held |= (uint8_t)(1u << KEYCLASS_MOUSE_DIR(cls));
+#endif
+      }
+    }
+    else
+    {
+      if (*count == 0 || --(*count) != 0)
+        continue;
+      if (ev->is_modifier)
+      {
+        held->modifiers &= (uint8_t)~(1u << ev->usage);
+      }
+      else
       {
-        combined_keys[combined_count++] = key;
+        key_bitmap_reset(&held->keys, ev->usage);
+        --held->key_count;
+#ifdef CONFIG_M4G_ABBREV_EXPANSION
+        if (group == SLOT_GROUP_DIRECT)
+          key_bitmap_reset(&ctx->abbrev_masked, ev->usage);
+#endif
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+        uint8_t cls = s_keycode_class[ev->usage];
+        if (cls & KEYCLASS_MOUSE)
+          held->arrow_mouse_held &= (uint8_t)~(1u << KEYCLASS_MOUSE_DIR(cls));
+#endif
       }
     }
   }
+}
+
+static void compute_combined_state(m4g_bridge_ctx_t *ctx, combined_state_t *state, slot_group_t group)
+{
+  const held_state_t *held = &ctx->held[group];
+  memset(state, 0, sizeof(*state));
+  state->modifiers = held->modifiers;
+  state->key_bits = held->keys;
+  state->key_count = held->key_count;
+#ifdef CONFIG_M4G_ABBREV_EXPANSION
+  for (size_t w = 0; group == SLOT_GROUP_DIRECT && w < KEY_BITMAP_WORDS; ++w)
+  {
+    uint32_t hidden = state->key_bits.words[w] & ctx->abbrev_masked.words[w];
+    state->key_bits.words[w] &= ~hidden;
+    state->key_count -= (size_t)__builtin_popcount(hidden);
+  }
+#endif
+
+  state->any_charachorder = ctx->charachorder_slots != 0;
 
-  // First pass: calculate mouse movement and identify mouse keys
+  // Calculate mouse movement from arrow-mouse keys
 #ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+  static const int8_t dir_dx[4] = {[MOUSE_DIR_LEFT] = -1, [MOUSE_DIR_RIGHT] = 1};
+  static const int8_t dir_dy[4] = {[MOUSE_DIR_UP] = -1, [MOUSE_DIR_DOWN] = 1};
   int mx = 0;
   int my = 0;
-  bool is_mouse_key[6] = {false};
-  bool arrow_pressed[4] = {false}; // [up, down, left, right]
 
-  for (size_t i = 0; i < combined_count; ++i)
+  for (size_t dir = 0; dir < 4; ++dir)
   {
-    switch (combined_keys[i])
+    uint8_t key = s_arrow_mouse_keys[dir];
+    if (held->arrow_mouse_held & (1u << dir))
     {
-    case 0x29: // Escape - Mouse Up
-      my -= calculate_mouse_speed(0x29, 0);
-      is_mouse_key[i] = true;
-      arrow_pressed[0] = true;
-      break;
-    case 0x2A: // Backspace - Mouse Down
-      my += calculate_mouse_speed(0x2A, 1);
-      is_mouse_key[i] = true;
-      arrow_pressed[1] = true;
-      break;
-    case 0x38: // Forward Slash - Mouse Left
-      mx -= calculate_mouse_speed(0x38, 2);
-      is_mouse_key[i] = true;
-      arrow_pressed[2] = true;
-      break;
-    case 0x2E: // Period - Mouse Right
-      mx += calculate_mouse_speed(0x2E, 3);
-      is_mouse_key[i] = true;
-      arrow_pressed[3] = true;
-      break;
-    default:
-      break;
+      arrow_mouse_note_press(ctx, key, dir);
+      mx += dir_dx[dir];
+      my += dir_dy[dir];
+    }
+    else if (!key_held_anywhere(ctx, key))
+    {
+      // Reset tracking for arrow keys that were released
+      reset_arrow_key_if_released(ctx, key, dir, false);
     }
   }
   state->mouse_dx = mx;
   state->mouse_dy = my;
 
-  // Reset tracking for any arrow keys that were released
-  reset_arrow_key_if_released(0x29, 0, arrow_pressed[0]);
-  reset_arrow_key_if_released(0x2A, 1, arrow_pressed[1]);
-  reset_arrow_key_if_released(0x38, 2, arrow_pressed[2]);
-  reset_arrow_key_if_released(0x2E, 3, arrow_pressed[3]);
-
-  // Second pass: filter out mouse keys from keyboard report if mouse movement detected
+  // Filter out mouse keys from keyboard report if mouse movement detected
   if (mx != 0 || my != 0)
   {
-    size_t filtered_count = 0;
-    for (size_t i = 0; i < combined_count; ++i)
+    size_t combined_count = state->key_count;
+    size_t filtered_count = combined_count;
+    for (size_t dir = 0; dir < 4; ++dir)
     {
-      if (!is_mouse_key[i])
+      uint8_t key = s_arrow_mouse_keys[dir];
+      if (key_bitmap_test(&state->key_bits, key))
       {
-        state->keys[filtered_count++] = combined_keys[i];
+        key_bitmap_reset(&state->key_bits, key);
+        --filtered_count;
       }
     }
-    // Zero out remaining slots
-    for (size_t i = filtered_count; i < 6; ++i)
-    {
-      state->keys[i] = 0;
-    }
     state->key_count = filtered_count;
 
     if (ENABLE_DEBUG_KEYPRESS_LOGGING && filtered_count != combined_count)
     {
       LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                   "Filtered mouse keys: %u -> %u keys, mouse dx=%d dy=%d",
+                   "Filtered mouse keys: %u -> %u keys, mouse direction %d,%d",
                    (unsigned)combined_count, (unsigned)filtered_count, mx, my);
     }
   }
-  else
+#endif
+}
+
+// Bring an instance to its power-on state: no slots, no held keys, idle chord FSM
+// and output queue, all timers stopped
+static void bridge_ctx_init(m4g_bridge_ctx_t *ctx, const m4g_bridge_io_t *io)
+{
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->io = *io;
+  ctx->rings[M4G_BRIDGE_SOURCE_USB].events = ctx->usb_events;
+  ctx->rings[M4G_BRIDGE_SOURCE_USB].mask = BRIDGE_RING_DEPTH_USB - 1;
+  ctx->rings[M4G_BRIDGE_SOURCE_ESPNOW].events = ctx->espnow_events;
+  ctx->rings[M4G_BRIDGE_SOURCE_ESPNOW].mask = BRIDGE_RING_DEPTH_ESPNOW - 1;
+  ctx->rings[M4G_BRIDGE_SOURCE_TIMER].events = ctx->timer_events;
+  ctx->rings[M4G_BRIDGE_SOURCE_TIMER].mask = BRIDGE_RING_DEPTH_TIMER - 1;
+  ctx->rings[M4G_BRIDGE_SOURCE_APP].events = ctx->app_events;
+  ctx->rings[M4G_BRIDGE_SOURCE_APP].mask = BRIDGE_RING_DEPTH_APP - 1;
+
+  for (int timer = 0; timer < M4G_BRIDGE_TIMER_COUNT; ++timer)
+    bridge_set_timer(ctx, (m4g_bridge_timer_t)timer, 0);
+  output_init(ctx);
+
+  chord_buffer_reset(ctx);
+  ctx->chord_state = CHORD_STATE_IDLE;
+  ctx->input_us = bridge_now_us(ctx);
+  ctx->expect_output_us = ctx->input_us;
+  grace_model_load(ctx);
+#ifdef CONFIG_M4G_LOCAL_CHORDS
+  // Optional: without a dictionary every chord goes through the CharaChorder
+  m4g_chord_dict_init();
+#endif
+#ifdef CONFIG_M4G_ABBREV_EXPANSION
+  // Optional: without a dictionary ordinary keyboards stay pure passthrough
+  m4g_abbrev_init();
+  m4g_abbrev_reset(&ctx->abbrev);
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Default instance: esp_timer clock and timers, BLE HID output, drained by the
+// bridge task. The m4g_bridge_* calls without a context all go here.
+
+static int64_t default_now_us(void *user)
+{
+  (void)user;
+  return esp_timer_get_time();
+}
+
+static esp_timer_handle_t s_default_timers[M4G_BRIDGE_TIMER_COUNT];
+
+static void default_set_timer(void *user, m4g_bridge_timer_t timer, int64_t due_us)
+{
+  (void)user;
+  if (!s_default_timers[timer])
+    return;
+  esp_timer_stop(s_default_timers[timer]);
+  if (due_us == 0)
+    return;
+  int64_t remaining_us = due_us - esp_timer_get_time();
+  esp_timer_start_once(s_default_timers[timer], remaining_us > 0 ? (uint64_t)remaining_us : 1);
+}
+
+static m4g_bridge_send_result_t default_send_result(m4g_ble_send_result_t result)
+{
+  switch (result)
   {
-    // No mouse movement - keep all keys in keyboard report
-    memcpy(state->keys, combined_keys, sizeof(state->keys));
-    state->key_count = combined_count;
+  case M4G_BLE_SEND_OK:
+    return M4G_BRIDGE_SEND_OK;
+  case M4G_BLE_SEND_NO_BUFFER:
+    return M4G_BRIDGE_SEND_BUSY;
+  default:
+    return M4G_BRIDGE_SEND_REJECTED;
   }
-#else
-  // No arrow-to-mouse conversion - just copy all keys
-  memcpy(state->keys, combined_keys, sizeof(state->keys));
-  state->key_count = combined_count;
-#endif
+}
+
+static m4g_bridge_send_result_t default_send_keyboard(void *user, const uint8_t report[8])
+{
+  (void)user;
+  return default_send_result(m4g_ble_send_keyboard_report(report));
+}
+
+static m4g_bridge_send_result_t default_send_nkro(void *user, const uint8_t *report, size_t len)
+{
+  (void)user;
+  (void)len;
+  return default_send_result(m4g_ble_send_nkro_report(report));
+}
+
+static m4g_bridge_send_result_t default_send_mouse(void *user, const uint8_t report[M4G_BRIDGE_MOUSE_REPORT_LEN])
+{
+  (void)user;
+  return default_send_result(m4g_ble_send_mouse_report(report));
+}
+
+static bool default_link_ready(void *user)
+{
+  (void)user;
+  return m4g_ble_is_connected() && m4g_ble_notifications_enabled();
+}
+
+static bool default_report_notifications(void *user)
+{
+  (void)user;
+  return m4g_ble_report_notifications_enabled();
+}
+
+static bool default_boot_protocol(void *user)
+{
+  (void)user;
+  return m4g_ble_is_boot_protocol();
+}
+
+static uint32_t default_conn_interval_us(void *user)
+{
+  (void)user;
+  return m4g_ble_conn_interval_us();
+}
+
+static const m4g_bridge_io_t s_default_io = {
+    .now_us = default_now_us,
+    .set_timer = default_set_timer,
+    .send_keyboard = default_send_keyboard,
+    .send_nkro = default_send_nkro,
+    .send_mouse = default_send_mouse,
+    .link_ready = default_link_ready,
+    .report_notifications = default_report_notifications,
+    .boot_protocol = default_boot_protocol,
+    .conn_interval_us = default_conn_interval_us,
+    .user = NULL,
+    .persist_grace_model = true,
+};
+
+// Rings are usable before m4g_bridge_init (events posted early are dropped there)
+static m4g_bridge_ctx_t s_default_ctx = {
+    .rings = {
+        [M4G_BRIDGE_SOURCE_USB] = {.events = s_default_ctx.usb_events, .mask = BRIDGE_RING_DEPTH_USB - 1},
+        [M4G_BRIDGE_SOURCE_ESPNOW] = {.events = s_default_ctx.espnow_events, .mask = BRIDGE_RING_DEPTH_ESPNOW - 1},
+        [M4G_BRIDGE_SOURCE_TIMER] = {.events = s_default_ctx.timer_events, .mask = BRIDGE_RING_DEPTH_TIMER - 1},
+        [M4G_BRIDGE_SOURCE_APP] = {.events = s_default_ctx.app_events, .mask = BRIDGE_RING_DEPTH_APP - 1},
+    },
+};
+static TaskHandle_t s_bridge_task = NULL;
+
+// Runs in the esp_timer task
+static void default_timer_cb(void *arg)
+{
+  m4g_bridge_ctx_timer_expired(&s_default_ctx, (m4g_bridge_timer_t)(uintptr_t)arg);
 }
 
 esp_err_t m4g_bridge_init(void)
 {
-  // Currently stateless; placeholder for future mapping tables/macros
-  chord_buffer_reset();
-  s_chord_state = CHORD_STATE_IDLE;
-  s_expect_output_tick = xTaskGetTickCount();
-  s_charachorder_detected = false;
-  s_charachorder_both_halves = false;
-  s_warned_invalid_slot = false;
-  s_chord_processed = 0;
-  s_chord_delayed = 0;
-#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-  s_last_key = 0;
-  s_last_modifiers = 0;
-  s_last_key_press_time = 0;
-  s_last_repeat_time = 0;
-  s_repeat_started = false;
-  s_in_repeat_emit = false;
-  s_repeat_active = false;
-  s_repeat_cancel_pending = false;
-#endif
+  static const char *const timer_names[M4G_BRIDGE_TIMER_COUNT] = {
+      [M4G_BRIDGE_TIMER_CHORD_DEADLINE] = "chord_deadline",
+      [M4G_BRIDGE_TIMER_KEY_REPEAT] = "key_repeat",
+      [M4G_BRIDGE_TIMER_OUTPUT] = "output_pacing",
+      [M4G_BRIDGE_TIMER_ARROW_MOUSE] = "arrow_mouse",
+  };
+  for (int timer = 0; timer < M4G_BRIDGE_TIMER_COUNT; ++timer)
+  {
+    if (s_default_timers[timer])
+      continue;
+    const esp_timer_create_args_t timer_args = {
+        .callback = default_timer_cb,
+        .arg = (void *)(uintptr_t)timer,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = timer_names[timer],
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_default_timers[timer]);
+    if (err != ESP_OK)
+    {
+      LOG_AND_SAVE(true, E, BRIDGE_TAG, "Timer %s create failed: %s", timer_names[timer], esp_err_to_name(err));
+      return err;
+    }
+  }
+
+  bridge_ctx_init(&s_default_ctx, &s_default_io);
+
+  if (!s_bridge_task)
+  {
+    if (xTaskCreate(bridge_task, "m4g_bridge", BRIDGE_TASK_STACK_SIZE, &s_default_ctx, BRIDGE_TASK_PRIORITY,
+                    &s_bridge_task) != pdPASS)
+    {
+      LOG_AND_SAVE(true, E, BRIDGE_TAG, "Bridge task create failed");
+      s_bridge_task = NULL;
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  s_default_ctx.task = s_bridge_task;
   return ESP_OK;
 }
 
-void m4g_bridge_set_charachorder_status(bool detected, bool both_halves_connected)
+m4g_bridge_ctx_t *m4g_bridge_default_ctx(void)
+{
+  return &s_default_ctx;
+}
+
+m4g_bridge_ctx_t *m4g_bridge_ctx_create(const m4g_bridge_io_t *io)
+{
+  if (!io || !io->now_us || !io->set_timer || !io->send_keyboard || !io->send_nkro || !io->send_mouse ||
+      !io->link_ready || !io->report_notifications || !io->boot_protocol || !io->conn_interval_us)
+    return NULL;
+
+  m4g_bridge_ctx_t *ctx = calloc(1, sizeof(*ctx));
+  if (!ctx)
+    return NULL;
+  bridge_ctx_init(ctx, io);
+  return ctx;
+}
+
+void m4g_bridge_ctx_destroy(m4g_bridge_ctx_t *ctx)
 {
-  bool previous_detected = s_charachorder_detected;
-  s_charachorder_detected = detected;
-  s_charachorder_both_halves = both_halves_connected;
+  if (!ctx || ctx == &s_default_ctx)
+    return;
+  for (int timer = 0; timer < M4G_BRIDGE_TIMER_COUNT; ++timer)
+    bridge_set_timer(ctx, (m4g_bridge_timer_t)timer, 0);
+  free(ctx);
+}
+
+static void bridge_handle_status(m4g_bridge_ctx_t *ctx, bool detected, bool both_halves_connected)
+{
+  bool previous_detected = ctx->charachorder_detected;
+  ctx->charachorder_detected = detected;
+  ctx->charachorder_both_halves = both_halves_connected;
 
   if (!detected)
   {
-    chord_buffer_reset();
-    s_chord_state = CHORD_STATE_IDLE;
+    chord_buffer_reset(ctx);
+    ctx->chord_state = CHORD_STATE_IDLE;
+    chord_deadline_update(ctx);
   }
 
   if (ENABLE_DEBUG_USB_LOGGING && (previous_detected != detected))
@@ -579,581 +1530,1823 @@ void m4g_bridge_set_charachorder_status(bool detected, bool both_halves_connecte
   }
 }
 
-static void emit_keyboard_state(uint8_t modifiers, const uint8_t keys[6], bool allow_mouse, int mx, int my)
+// Send a keyboard state as either the NKRO report (ID 3) or the 6KRO report (ID 1)
+static m4g_bridge_send_result_t send_keyboard_report_format(m4g_bridge_ctx_t *ctx, bool nkro, uint8_t modifiers,
+                                                            const key_bitmap_t *keys)
 {
-  uint8_t kb_report[8] = {0};
-  kb_report[0] = modifiers;
-  kb_report[1] = 0;
-  memcpy(&kb_report[2], keys, 6);
-
-  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+#ifdef CONFIG_M4G_ENABLE_NKRO
+  if (nkro)
   {
-    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                 "Emit report: mod=0x%02X keys=[0x%02X 0x%02X 0x%02X 0x%02X 0x%02X 0x%02X] allow_mouse=%d mx=%d my=%d",
-                 kb_report[0], kb_report[2], kb_report[3], kb_report[4],
-                 kb_report[5], kb_report[6], kb_report[7], allow_mouse, mx, my);
+    uint8_t nkro_report[M4G_BLE_NKRO_REPORT_LEN];
+    key_bitmap_to_nkro(keys, modifiers, nkro_report);
+    return ctx->io.send_nkro(ctx->io.user, nkro_report, M4G_BLE_NKRO_REPORT_LEN);
   }
-
-#ifdef CONFIG_M4G_ENABLE_DUPLICATE_SUPPRESSION
-  bool kb_changed = (!s_have_kb) || (memcmp(s_last_kb_report, kb_report, sizeof(kb_report)) != 0);
 #else
-  bool kb_changed = true;
+  (void)nkro;
 #endif
+  uint8_t kb_report[8] = {modifiers, 0};
+  key_bitmap_to_6kro(keys, &kb_report[2]);
+  return ctx->io.send_keyboard(ctx->io.user, kb_report);
+}
 
-  if (kb_changed)
+// ---------------------------------------------------------------------------
+// Paced keyboard output
+//
+// NimBLE only has a few notification buffers and the controller drains them once
+// per connection event, so a burst of reports (chord output, expansions, typed
+// text) used to overflow them and lose keys. Keyboard reports now spend credits
+// that refill by CONFIG_M4G_BLE_REPORTS_PER_EVENT per connection interval (up to
+// two intervals' worth, so a short burst still goes out at once); anything over
+// waits in a FIFO that a timer drains as credits come back. The rate grows by one
+// while the credits run out without the stack refusing anything, and halves when
+// it refuses a report (which is kept and retried), so it settles at what the link
+// sustains.
+//
+// Generated output is queued as a job and turned into reports only as the link
+// takes them. Consecutive keys with the same modifiers roll over (press b while
+// a is released in the same report), so N keystrokes cost about N + 1 reports.
+//
+// USB mouse reports (125-1000 Hz) share the same budget. Their motion is summed
+// and goes out once per interval, carrying whatever one report cannot hold into
+// the next; a button change is queued in order with the keyboard reports, after
+// the motion that preceded it, so clicks are never merged or reordered.
+// ---------------------------------------------------------------------------
+
+// US layout: ASCII character -> keystroke (usage 0: no key types it)
+#define KS(m, u) {(m), (u)}
+#define KS_SHIFT 0x02
+static const m4g_bridge_keystroke_t s_ascii_keystrokes[128] = {
+    ['\b'] = KS(0, 0x2A), ['\t'] = KS(0, 0x2B), ['\n'] = KS(0, 0x28), [' '] = KS(0, 0x2C),
+    ['!'] = KS(KS_SHIFT, 0x1E), ['"'] = KS(KS_SHIFT, 0x34), ['#'] = KS(KS_SHIFT, 0x20), ['$'] = KS(KS_SHIFT, 0x21),
+    ['%'] = KS(KS_SHIFT, 0x22), ['&'] = KS(KS_SHIFT, 0x24), ['\''] = KS(0, 0x34), ['('] = KS(KS_SHIFT, 0x26),
+    [')'] = KS(KS_SHIFT, 0x27), ['*'] = KS(KS_SHIFT, 0x25), ['+'] = KS(KS_SHIFT, 0x2E), [','] = KS(0, 0x36),
+    ['-'] = KS(0, 0x2D), ['.'] = KS(0, 0x37), ['/'] = KS(0, 0x38), ['0'] = KS(0, 0x27),
+    ['1'] = KS(0, 0x1E), ['2'] = KS(0, 0x1F), ['3'] = KS(0, 0x20), ['4'] = KS(0, 0x21),
+    ['5'] = KS(0, 0x22), ['6'] = KS(0, 0x23), ['7'] = KS(0, 0x24), ['8'] = KS(0, 0x25),
+    ['9'] = KS(0, 0x26), [':'] = KS(KS_SHIFT, 0x33), [';'] = KS(0, 0x33), ['<'] = KS(KS_SHIFT, 0x36),
+    ['='] = KS(0, 0x2E), ['>'] = KS(KS_SHIFT, 0x37), ['?'] = KS(KS_SHIFT, 0x38), ['@'] = KS(KS_SHIFT, 0x1F),
+    ['['] = KS(0, 0x2F), ['\\'] = KS(0, 0x31), [']'] = KS(0, 0x30), ['^'] = KS(KS_SHIFT, 0x23),
+    ['_'] = KS(KS_SHIFT, 0x2D), ['`'] = KS(0, 0x35), ['{'] = KS(KS_SHIFT, 0x2F), ['|'] = KS(KS_SHIFT, 0x31),
+    ['}'] = KS(KS_SHIFT, 0x30), ['~'] = KS(KS_SHIFT, 0x35),
+};
+
+static bool ascii_to_keystroke(char c, m4g_bridge_keystroke_t *out)
+{
+  if (c >= 'a' && c <= 'z')
+    *out = (m4g_bridge_keystroke_t)KS(0, (uint8_t)(0x04 + c - 'a'));
+  else if (c >= 'A' && c <= 'Z')
+    *out = (m4g_bridge_keystroke_t)KS(KS_SHIFT, (uint8_t)(0x04 + c - 'A'));
+  else if ((unsigned char)c < 128)
+    *out = s_ascii_keystrokes[(unsigned char)c];
+  else
+    return false;
+  return out->usage != 0;
+}
+
+static inline bool output_idle(m4g_bridge_ctx_t *ctx)
+{
+  return ctx->output_head == ctx->output_tail;
+}
+
+static uint32_t output_interval_us(m4g_bridge_ctx_t *ctx)
+{
+  uint32_t interval_us = ctx->io.conn_interval_us(ctx->io.user);
+  return interval_us ? interval_us : (uint32_t)CONFIG_M4G_BLE_CONN_INTERVAL_MIN_MS * 1000;
+}
+
+// Spend one credit, first adding those earned by the intervals that have passed
+// (and adapting the rate to how the last one went)
+static bool output_take_credit(m4g_bridge_ctx_t *ctx)
+{
+  int64_t now_us = bridge_now_us(ctx);
+  int64_t interval_us = output_interval_us(ctx);
+  if (now_us - ctx->output_window_us >= interval_us)
   {
-    if (m4g_ble_send_keyboard_report(kb_report))
-    {
-      memcpy(s_last_kb_report, kb_report, sizeof(kb_report));
-      s_have_kb = true;
-      ++s_kb_sent;
-    }
-    else
-    {
-      LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, E, BRIDGE_TAG, "Keyboard report failed (conn=%d notify=%d)",
-                   m4g_ble_is_connected(), m4g_ble_notifications_enabled());
-    }
+    int64_t intervals = (now_us - ctx->output_window_us) / interval_us;
+    if (ctx->output_credits == 0 && !ctx->output_refused && ctx->output_rate < OUTPUT_MAX_REPORTS_PER_EVENT)
+      ++ctx->output_rate;
+    int64_t credits = (int64_t)ctx->output_credits + intervals * ctx->output_rate;
+    ctx->output_credits = (uint32_t)(credits < 2 * (int64_t)ctx->output_rate ? credits : 2 * (int64_t)ctx->output_rate);
+    ctx->output_window_us += intervals * interval_us;
+    ctx->output_refused = false;
   }
-  else if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  if (ctx->output_credits == 0)
+    return false;
+  --ctx->output_credits;
+  return true;
+}
+
+// The stack had no buffer for a report: stop for this interval and send less per interval
+static void output_backoff(m4g_bridge_ctx_t *ctx)
+{
+  ctx->output_credits = 0;
+  ctx->output_refused = true;
+  ctx->output_rate = ctx->output_rate > 1 ? ctx->output_rate / 2 : 1;
+  ++ctx->output_refusals;
+}
+
+// Hand one keyboard state to BLE, first releasing the other report format if the
+// host still holds keys there. NKRO states queued before the host dropped the
+// report characteristic, and NKRO reports the link refuses, go out as 6KRO.
+static m4g_bridge_send_result_t output_transmit(m4g_bridge_ctx_t *ctx, bool nkro, uint8_t modifiers,
+                                                const key_bitmap_t *keys)
+{
+  m4g_bridge_send_result_t result;
+  if (nkro && !ctx->io.report_notifications(ctx->io.user))
+    nkro = false;
+  if (ctx->wire_held && nkro != ctx->wire_nkro)
   {
-    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, D, BRIDGE_TAG, "Duplicate keyboard report suppressed");
+    result = send_keyboard_report_format(ctx, ctx->wire_nkro, 0, &s_no_keys);
+    if (result == M4G_BRIDGE_SEND_BUSY)
+      return result;
+    // A format the link no longer carries holds nothing on the host either
+    ctx->wire_held = false;
   }
-
-#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
-  if (allow_mouse)
+  result = send_keyboard_report_format(ctx, nkro, modifiers, keys);
+  if (result == M4G_BRIDGE_SEND_REJECTED && nkro)
   {
-    if (mx > 127)
-      mx = 127;
-    else if (mx < -127)
-      mx = -127;
-    if (my > 127)
-      my = 127;
-    else if (my < -127)
-      my = -127;
-
-    if (mx || my)
-    {
-      if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-      {
-        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                     "Mouse movement: dx=%d dy=%d", mx, my);
-      }
-
-      uint8_t mouse[3] = {0};
-      mouse[1] = (uint8_t)mx;
-      mouse[2] = (uint8_t)my;
-#ifdef CONFIG_M4G_ENABLE_DUPLICATE_SUPPRESSION
-      bool mouse_changed = (!s_have_mouse) || (memcmp(s_last_mouse_report, mouse, sizeof(mouse)) != 0);
-#else
-      bool mouse_changed = true;
-#endif
-      if (mouse_changed)
-      {
-        if (m4g_ble_send_mouse_report(mouse))
-        {
-          memcpy(s_last_mouse_report, mouse, sizeof(mouse));
-          s_have_mouse = true;
-          ++s_mouse_sent;
-        }
-        else
-        {
-          LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, W, BRIDGE_TAG, "Mouse report failed (conn=%d notify=%d)",
-                       m4g_ble_is_connected(), m4g_ble_notifications_enabled());
-        }
-      }
-      else if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-      {
-        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, D, BRIDGE_TAG, "Duplicate mouse report suppressed");
-      }
-    }
+    nkro = false;
+    result = send_keyboard_report_format(ctx, nkro, modifiers, keys);
   }
+  if (result != M4G_BRIDGE_SEND_OK)
+    return result;
+  ctx->wire_nkro = nkro;
+  ctx->wire_held = modifiers != 0 || memcmp(keys, &s_no_keys, sizeof(*keys)) != 0;
+  ++ctx->kb_sent;
+  return M4G_BRIDGE_SEND_OK;
+}
+
+// NKRO needs report protocol and the report characteristic; anything else gets the
+// 6KRO report, which the boot keyboard characteristic carries as well
+static inline bool output_report_nkro(m4g_bridge_ctx_t *ctx, const key_bitmap_t *keys)
+{
+#ifdef CONFIG_M4G_ENABLE_NKRO
+  return !ctx->io.boot_protocol(ctx->io.user) && ctx->io.report_notifications(ctx->io.user) &&
+         key_bitmap_fits_nkro(keys);
 #else
-  (void)allow_mouse;
-  (void)mx;
-  (void)my;
+  (void)ctx;
+  (void)keys;
+  return false;
 #endif
+}
 
-#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-  // Track key for repeat functionality (skip if this is a repeat emission)
-  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+// Next report of a generated job into *report, advancing the copy in *job.
+// Returns false once the job has nothing left to send.
+static bool output_job_next(output_entry_t *job, uint8_t *modifiers, key_bitmap_t *keys)
+{
+  m4g_bridge_keystroke_t ks = {0, 0};
+  bool have_key = false;
+  if (job->job.erase)
   {
-    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                 "emit_keyboard_state tracking: s_in_repeat_emit=%d keys[0]=0x%02X",
-                 s_in_repeat_emit, keys[0]);
+    ks = (m4g_bridge_keystroke_t)KS(0, HID_USAGE_BACKSPACE);
+    have_key = true;
   }
-
-  if (!s_in_repeat_emit)
+  else if (job->kind == OUTPUT_ENTRY_KEYSTROKES)
   {
-    TickType_t now = xTaskGetTickCount();
-
-    // Count how many keys are pressed
-    int key_count = 0;
-    uint8_t current_key = 0;
-    for (int i = 0; i < 6; i++)
-    {
-      if (keys[i] != 0)
-      {
-        if (current_key == 0)
-          current_key = keys[i]; // Remember first key
-        key_count++;
-      }
-    }
-
-    // If multiple keys are pressed, disable key repeat
-    // (this is likely a chord or intentional multi-key combination)
-    if (key_count > 1)
-    {
-      s_last_key = 0; // Disable repeat
-      s_repeat_started = false;
-      s_repeat_active = false;
-      s_repeat_cancel_pending = false;
-      if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-      {
-        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                     "Multi-key detected - disabling repeat");
-      }
-    }
-    // Check if key changed or released
-    else if (current_key != s_last_key || modifiers != s_last_modifiers)
+    while (!have_key && job->job.next < job->job.len)
     {
-      if (current_key == 0)
-      {
-        // Zero state update should simply clear repeat tracking
-        s_last_key = 0;
-        s_last_modifiers = 0;
-        s_repeat_started = false;
-        s_repeat_active = false;
-        s_last_key_press_time = now;
-        s_repeat_cancel_pending = true;
-
-        if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-        {
-          LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                       "Repeat tracking cleared on key release");
-        }
-        return;
-      }
-
-      if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-      {
-        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                     "Key state change: last=0x%02X current=0x%02X repeat_started=%d",
-                     s_last_key, current_key, s_repeat_started);
-      }
-      // Key changed - reset repeat state before updating tracking
-      s_repeat_started = false;
-      s_repeat_active = false;
-
-      s_last_key = current_key;
-      s_last_modifiers = modifiers;
-      s_last_key_press_time = now;
-      s_repeat_cancel_pending = false;
+      ks = ((const m4g_bridge_keystroke_t *)job->job.src)[job->job.next];
+      have_key = ks.usage != 0;
+      if (!have_key)
+        ++job->job.next;
     }
-    // Same key still held - keep original press time
   }
   else
   {
-    if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+    const char *text = (const char *)job->job.src;
+    while (!have_key && text[job->job.next] != '\0')
     {
-      LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                   "Skipping key tracking (in repeat emit)");
+      have_key = ascii_to_keystroke(text[job->job.next], &ks);
+      if (!have_key)
+        ++job->job.next;
     }
   }
-#endif
-}
 
-static void process_combined_state(const combined_state_t *state)
-{
-  if (!state)
-    return;
+  // Roll over to the next key unless it repeats the last one or needs other modifiers
+  if (!job->job.released && (!have_key || ks.usage == job->job.last_usage || ks.modifiers != job->job.last_modifiers))
+  {
+    *modifiers = 0;
+    key_bitmap_clear(keys);
+    job->job.released = true;
+    return true;
+  }
+  if (!have_key)
+    return false;
 
-  TickType_t now = xTaskGetTickCount();
-  bool has_keys = (state->key_count > 0) || (state->modifiers != 0);
-#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
-  bool has_activity = has_keys || (state->mouse_dx != 0) || (state->mouse_dy != 0);
-#else
-  bool has_activity = has_keys;
-#endif
+  *modifiers = ks.modifiers;
+  key_bitmap_single(keys, ks.usage);
+  job->job.last_usage = ks.usage;
+  job->job.last_modifiers = ks.modifiers;
+  job->job.released = false;
+  if (job->job.erase)
+    --job->job.erase;
+  else
+    ++job->job.next;
+  return true;
+}
 
-  bool use_chord = use_chord_for_state(state);
+static void output_job_finish(output_entry_t *entry, bool delivered)
+{
+  if ((entry->kind == OUTPUT_ENTRY_KEYSTROKES || entry->kind == OUTPUT_ENTRY_TEXT) && entry->job.done)
+    entry->job.done(entry->job.arg, delivered);
+}
 
-#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-  if (s_repeat_active && has_keys)
+// Drop everything queued (the link went away)
+static void output_flush(m4g_bridge_ctx_t *ctx)
+{
+  while (!output_idle(ctx))
   {
-    use_chord = false;
+    output_entry_t *entry = &ctx->output_queue[ctx->output_tail % OUTPUT_QUEUE_DEPTH];
+    ++ctx->output_tail;
+    ++ctx->output_dropped;
+    output_job_finish(entry, false);
   }
+  memset(&ctx->mouse_acc, 0, sizeof(ctx->mouse_acc));
+}
 
-  if (s_repeat_active && !has_keys)
-  {
-    // Immediate release when repeat was active but no keys remain
-    uint8_t empty_keys[6] = {0};
-    s_repeat_cancel_pending = true;
-    emit_keyboard_state(s_last_modifiers, empty_keys, true, 0, 0);
+static inline bool mouse_motion_pending(const mouse_motion_t *motion)
+{
+  return motion->x != 0 || motion->y != 0 || motion->wheel != 0 || motion->pan != 0;
+}
 
-    chord_buffer_reset();
-    s_chord_state = CHORD_STATE_IDLE;
-    s_expect_output_tick = now;
-    s_last_key = 0;
-    s_last_modifiers = 0;
-    s_repeat_started = false;
-    s_repeat_active = false;
+static inline bool output_mouse_pending(m4g_bridge_ctx_t *ctx)
+{
+  return mouse_motion_pending(&ctx->mouse_acc);
+}
+
+static void output_arm_timer(m4g_bridge_ctx_t *ctx)
+{
+  if (output_idle(ctx) && !output_mouse_pending(ctx))
+  {
+    bridge_set_timer(ctx, M4G_BRIDGE_TIMER_OUTPUT, 0);
+    return;
+  }
+  int64_t due_us = ctx->output_window_us + output_interval_us(ctx);
+  int64_t now_us = bridge_now_us(ctx);
+  bridge_set_timer(ctx, M4G_BRIDGE_TIMER_OUTPUT, due_us > now_us ? due_us : now_us + 1);
+}
+
+static m4g_bridge_send_result_t output_transmit_mouse(m4g_bridge_ctx_t *ctx, const mouse_report_t *report)
+{
+  uint8_t mouse[M4G_BRIDGE_MOUSE_REPORT_LEN] = {
+      report->buttons,
+      (uint8_t)report->dx,
+      (uint8_t)((uint16_t)report->dx >> 8),
+      (uint8_t)report->dy,
+      (uint8_t)((uint16_t)report->dy >> 8),
+      (uint8_t)report->wheel,
+      (uint8_t)report->pan,
+  };
+  m4g_bridge_send_result_t result = ctx->io.send_mouse(ctx->io.user, mouse);
+  if (result != M4G_BRIDGE_SEND_OK)
+    return result;
+  memcpy(ctx->last_mouse_report, mouse, sizeof(mouse));
+  ctx->have_mouse = true;
+  ++ctx->mouse_sent;
+  return M4G_BRIDGE_SEND_OK;
+}
+
+static int32_t mouse_clamp(int32_t value, int32_t limit)
+{
+  return value > limit ? limit : (value < -limit ? -limit : value);
+}
+
+// Up to one report's worth of the accumulated motion, taken off the accumulator.
+// Both axes shrink by the same factor, so a long move keeps its direction.
+static void mouse_take(mouse_motion_t *acc, mouse_report_t *out)
+{
+  int32_t ax = abs(acc->x);
+  int32_t ay = abs(acc->y);
+  int32_t longest = ax > ay ? ax : ay;
+  int32_t x = acc->x;
+  int32_t y = acc->y;
+  if (longest > MOUSE_REPORT_MAX_MOTION)
+  {
+    x = (int32_t)((int64_t)x * MOUSE_REPORT_MAX_MOTION / longest);
+    y = (int32_t)((int64_t)y * MOUSE_REPORT_MAX_MOTION / longest);
+  }
+  int32_t wheel = mouse_clamp(acc->wheel, MOUSE_REPORT_MAX_SCROLL);
+  int32_t pan = mouse_clamp(acc->pan, MOUSE_REPORT_MAX_SCROLL);
+  acc->x -= x;
+  acc->y -= y;
+  acc->wheel -= wheel;
+  acc->pan -= pan;
+  out->dx = (int16_t)x;
+  out->dy = (int16_t)y;
+  out->wheel = (int8_t)wheel;
+  out->pan = (int8_t)pan;
+}
+
+// Send the accumulated motion once per interval, and again while it still
+// saturates a report and the budget allows
+static void output_mouse_flush(m4g_bridge_ctx_t *ctx)
+{
+  if (!output_mouse_pending(ctx) || bridge_now_us(ctx) < ctx->mouse_next_us)
+    return;
+
+  while (output_mouse_pending(ctx) && output_take_credit(ctx))
+  {
+    mouse_motion_t rest = ctx->mouse_acc;
+    mouse_report_t report = {.buttons = ctx->mouse_buttons};
+    mouse_take(&rest, &report);
+    m4g_bridge_send_result_t result = output_transmit_mouse(ctx, &report);
+    if (result == M4G_BRIDGE_SEND_BUSY)
+    {
+      ++ctx->output_credits;
+      output_backoff(ctx);
+      break;
+    }
+    if (result == M4G_BRIDGE_SEND_REJECTED)
+    {
+      // Retrying would only fail again: let the motion go
+      ++ctx->output_credits;
+      ++ctx->output_dropped;
+      memset(&ctx->mouse_acc, 0, sizeof(ctx->mouse_acc));
+      break;
+    }
+    ctx->mouse_acc = rest;
+    ctx->mouse_next_us = ctx->output_window_us + output_interval_us(ctx);
+  }
+}
+
+// Send queued reports while the interval's budget lasts
+static void output_pump(m4g_bridge_ctx_t *ctx)
+{
+  if (!bridge_link_ready(ctx))
+  {
+    output_flush(ctx);
+    output_arm_timer(ctx);
+    return;
+  }
+
+  while (!output_idle(ctx) && output_take_credit(ctx))
+  {
+    output_entry_t *entry = &ctx->output_queue[ctx->output_tail % OUTPUT_QUEUE_DEPTH];
+    m4g_bridge_send_result_t result;
+    if (entry->kind == OUTPUT_ENTRY_REPORT)
+    {
+      result = output_transmit(ctx, entry->report.nkro, entry->report.modifiers, &entry->report.keys);
+      if (result != M4G_BRIDGE_SEND_BUSY)
+        ++ctx->output_tail;
+    }
+    else if (entry->kind == OUTPUT_ENTRY_MOUSE)
+    {
+      result = output_transmit_mouse(ctx, &entry->mouse);
+      if (result != M4G_BRIDGE_SEND_BUSY)
+        ++ctx->output_tail;
+    }
+    else
+    {
+      output_entry_t next = *entry;
+      uint8_t modifiers;
+      key_bitmap_t keys;
+      if (!output_job_next(&next, &modifiers, &keys))
+      {
+        ++ctx->output_credits; // Nothing was sent
+        ++ctx->output_tail;
+        output_job_finish(entry, true);
+        continue;
+      }
+      result = output_transmit(ctx, output_report_nkro(ctx, &keys), modifiers, &keys);
+      if (result != M4G_BRIDGE_SEND_BUSY)
+        *entry = next;
+    }
+    if (result == M4G_BRIDGE_SEND_BUSY)
+    {
+      ++ctx->output_credits;
+      output_backoff(ctx);
+      break;
+    }
+    if (result == M4G_BRIDGE_SEND_REJECTED)
+    {
+      // The link will never take it: skip it instead of blocking everything behind
+      ++ctx->output_credits;
+      ++ctx->output_dropped;
+    }
+  }
+
+  // A job whose last report just went out completes now, not one interval later
+  while (!output_idle(ctx))
+  {
+    output_entry_t *entry = &ctx->output_queue[ctx->output_tail % OUTPUT_QUEUE_DEPTH];
+    output_entry_t next = *entry;
+    uint8_t modifiers;
+    key_bitmap_t keys;
+    if (entry->kind == OUTPUT_ENTRY_REPORT || entry->kind == OUTPUT_ENTRY_MOUSE ||
+        output_job_next(&next, &modifiers, &keys))
+      break;
+    ++ctx->output_tail;
+    output_job_finish(entry, true);
+  }
+
+  // Motion is newer than anything queued, so it goes last
+  if (output_idle(ctx))
+    output_mouse_flush(ctx);
+  output_arm_timer(ctx);
+}
+
+static output_entry_t *output_reserve(m4g_bridge_ctx_t *ctx)
+{
+  if (ctx->output_head - ctx->output_tail >= OUTPUT_QUEUE_DEPTH)
+  {
+    ++ctx->output_dropped;
+    return NULL;
+  }
+  return &ctx->output_queue[ctx->output_head % OUTPUT_QUEUE_DEPTH];
+}
+
+// Send a keyboard state now if the budget allows and nothing is queued ahead of
+// it, otherwise queue it. Returns false only if the state could not be sent or kept.
+static bool output_submit_report(m4g_bridge_ctx_t *ctx, bool nkro, uint8_t modifiers, const key_bitmap_t *keys)
+{
+  if (!bridge_link_ready(ctx))
+  {
+    output_flush(ctx);
+    return false;
+  }
+
+  if (output_idle(ctx) && output_take_credit(ctx))
+  {
+    m4g_bridge_send_result_t result = output_transmit(ctx, nkro, modifiers, keys);
+    if (result == M4G_BRIDGE_SEND_OK)
+      return true;
+    ++ctx->output_credits;
+    if (result == M4G_BRIDGE_SEND_REJECTED)
+    {
+      ++ctx->output_dropped;
+      return false;
+    }
+    output_backoff(ctx);
+  }
+
+  output_entry_t *entry = output_reserve(ctx);
+  if (!entry)
+    return false;
+  entry->kind = OUTPUT_ENTRY_REPORT;
+  entry->report.nkro = nkro;
+  entry->report.modifiers = modifiers;
+  entry->report.keys = *keys;
+  ++ctx->output_head;
+  ++ctx->output_deferred;
+  output_arm_timer(ctx);
+  return true;
+}
+
+// Whether the host may go from base straight to next without ever seeing mid. No
+// key or modifier may change in both steps (that would lose a press or a release),
+// and nothing may be pressed or change modifiers after a key press, because the
+// host applies the changes within one report in no particular order.
+static bool batch_can_skip(uint8_t base_modifiers, const key_bitmap_t *base, uint8_t mid_modifiers,
+                           const key_bitmap_t *mid, uint8_t next_modifiers, const key_bitmap_t *next)
+{
+  if ((base_modifiers ^ mid_modifiers) & (mid_modifiers ^ next_modifiers))
+    return false;
+
+  bool first_presses_key = false;
+  bool second_presses_key = false;
+  for (size_t i = 0; i < KEY_BITMAP_WORDS; ++i)
+  {
+    uint32_t first = base->words[i] ^ mid->words[i];
+    uint32_t second = mid->words[i] ^ next->words[i];
+    if (first & second)
+      return false;
+    first_presses_key |= (first & mid->words[i]) != 0;
+    second_presses_key |= (second & next->words[i]) != 0;
+  }
+  return !first_presses_key || (!second_presses_key && next_modifiers == mid_modifiers);
+}
+
+// Hand the staged keyboard state to the output scheduler
+static void output_batch_flush(m4g_bridge_ctx_t *ctx)
+{
+  if (!ctx->batch_pending)
+    return;
+  ctx->batch_pending = false;
+  if (!output_submit_report(ctx, ctx->batch_nkro, ctx->batch_modifiers, &ctx->batch_keys))
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, E, BRIDGE_TAG, "Keyboard report failed (link=%d)",
+                 bridge_link_ready(ctx));
+  }
+}
+
+// While a batch is applied, keep the newest keyboard state instead of sending it,
+// and only send the one before it when the host could not skip it
+static void output_batch_stage(m4g_bridge_ctx_t *ctx, bool nkro, uint8_t modifiers, const key_bitmap_t *keys)
+{
+  if (ctx->batch_pending)
+  {
+    if (nkro == ctx->batch_nkro && batch_can_skip(ctx->batch_base_modifiers, &ctx->batch_base_keys,
+                                                  ctx->batch_modifiers, &ctx->batch_keys, modifiers, keys))
+    {
+      ++ctx->reports_coalesced;
+    }
+    else
+    {
+      ctx->batch_base_modifiers = ctx->batch_modifiers;
+      ctx->batch_base_keys = ctx->batch_keys;
+      output_batch_flush(ctx);
+    }
+  }
+  else
+  {
+    ctx->batch_base_modifiers = ctx->have_kb ? ctx->last_kb_modifiers : 0;
+    ctx->batch_base_keys = ctx->have_kb ? ctx->last_kb_keys : s_no_keys;
+  }
+  ctx->batch_pending = true;
+  ctx->batch_nkro = nkro;
+  ctx->batch_modifiers = modifiers;
+  ctx->batch_keys = *keys;
+}
+
+// Queue a mouse button change behind everything already queued
+static bool output_queue_mouse(m4g_bridge_ctx_t *ctx, const mouse_report_t *report)
+{
+  output_entry_t *entry = output_reserve(ctx);
+  if (!entry)
+    return false;
+  entry->kind = OUTPUT_ENTRY_MOUSE;
+  entry->mouse = *report;
+  ++ctx->output_head;
+  return true;
+}
+
+// Take one USB mouse report: motion joins the accumulator, a button change is
+// queued right away together with the motion that came before it
+static void output_submit_mouse(m4g_bridge_ctx_t *ctx, uint8_t buttons, const mouse_motion_t *motion)
+{
+  if (!bridge_link_ready(ctx))
+  {
+    output_flush(ctx);
+    ctx->mouse_buttons = buttons;
+    return;
+  }
+
+  // A host subscribed to the boot keyboard characteristic alone cannot receive
+  // mouse reports; queueing them would only hold up the keyboard output behind
+  if (!ctx->io.report_notifications(ctx->io.user))
+  {
+    if (buttons != ctx->mouse_buttons || mouse_motion_pending(motion) || output_mouse_pending(ctx))
+      ++ctx->output_dropped;
+    memset(&ctx->mouse_acc, 0, sizeof(ctx->mouse_acc));
+    ctx->mouse_buttons = buttons;
+    return;
+  }
+
+  mouse_motion_t add = *motion;
+  if (buttons != ctx->mouse_buttons)
+  {
+    while (output_mouse_pending(ctx))
+    {
+      mouse_motion_t rest = ctx->mouse_acc;
+      mouse_report_t pending = {.buttons = ctx->mouse_buttons};
+      mouse_take(&rest, &pending);
+      if (!output_queue_mouse(ctx, &pending))
+        break;
+      ctx->mouse_acc = rest;
+    }
+    mouse_motion_t rest = add;
+    mouse_report_t first = {.buttons = buttons};
+    mouse_take(&rest, &first);
+    if (!output_mouse_pending(ctx) && output_queue_mouse(ctx, &first))
+    {
+      ctx->mouse_buttons = buttons;
+      add = rest;
+    }
+  }
+  else if (output_mouse_pending(ctx))
+  {
+    ++ctx->mouse_merged;
+  }
+  // Whatever did not fit in the queued report follows as ordinary motion
+  ctx->mouse_acc.x += add.x;
+  ctx->mouse_acc.y += add.y;
+  ctx->mouse_acc.wheel += add.wheel;
+  ctx->mouse_acc.pan += add.pan;
+  output_pump(ctx);
+}
+
+// Queue generated output behind everything already queued. The host ends up with
+// every key released; that becomes the state later reports are compared against.
+static bool output_submit_job(m4g_bridge_ctx_t *ctx, output_entry_kind_t kind, const void *src, size_t len,
+                              uint8_t erase, m4g_bridge_output_done_cb_t done, void *arg)
+{
+  output_batch_flush(ctx);
+  output_entry_t *entry = (bridge_link_ready(ctx)) ? output_reserve(ctx) : NULL;
+  if (!entry)
+  {
+    if (done)
+      done(arg, false);
+    return false;
+  }
+  entry->kind = (uint8_t)kind;
+  entry->job.src = src;
+  entry->job.len = (uint16_t)(len > UINT16_MAX ? UINT16_MAX : len);
+  entry->job.next = 0;
+  entry->job.erase = erase;
+  entry->job.last_usage = 0;
+  entry->job.last_modifiers = 0;
+  entry->job.released = true;
+  entry->job.done = done;
+  entry->job.arg = arg;
+  ++ctx->output_head;
+
+  ctx->last_kb_modifiers = 0;
+  key_bitmap_clear(&ctx->last_kb_keys);
+  memset(ctx->last_kb_report, 0, sizeof(ctx->last_kb_report));
+  ctx->have_kb = true;
+
+  output_pump(ctx);
+  return true;
+}
+
+#if defined(CONFIG_M4G_LOCAL_CHORDS) || defined(CONFIG_M4G_ABBREV_EXPANSION)
+// Type keystrokes (e.g. straight from a flash dictionary) after erase Backspaces
+static bool output_type_keystrokes(m4g_bridge_ctx_t *ctx, const m4g_bridge_keystroke_t *keystrokes, size_t n_keystrokes,
+                                   uint8_t erase)
+{
+  return output_submit_job(ctx, OUTPUT_ENTRY_KEYSTROKES, keystrokes, n_keystrokes, erase, NULL, NULL);
+}
+#endif
+
+static void output_init(m4g_bridge_ctx_t *ctx)
+{
+  ctx->output_head = 0;
+  ctx->output_tail = 0;
+  ctx->output_window_us = bridge_now_us(ctx);
+  ctx->output_credits = 2 * CONFIG_M4G_BLE_REPORTS_PER_EVENT;
+  ctx->output_rate = CONFIG_M4G_BLE_REPORTS_PER_EVENT;
+  ctx->output_refused = false;
+  ctx->wire_held = false;
+  ctx->output_deferred = 0;
+  ctx->output_refusals = 0;
+  ctx->output_dropped = 0;
+}
+
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+// ---------------------------------------------------------------------------
+// Arrow-key mouse
+//
+// Keyboards report nothing while a key is held (SET_IDLE 0), so pointer motion
+// cannot follow their reports. While the host state holds a mouse key, a tick at
+// the connection interval integrates each direction's speed over the time since
+// the previous tick and hands the motion to the paced output, like a USB mouse's.
+// A press moves one speed period's worth at once, so a tap is a fixed nudge.
+// ---------------------------------------------------------------------------
+
+static void arrow_mouse_move(m4g_bridge_ctx_t *ctx, int64_t elapsed_us)
+{
+  static const int8_t dir_dx[4] = {[MOUSE_DIR_LEFT] = -1, [MOUSE_DIR_RIGHT] = 1};
+  static const int8_t dir_dy[4] = {[MOUSE_DIR_UP] = -1, [MOUSE_DIR_DOWN] = 1};
+  int64_t mx_q8 = 0;
+  int64_t my_q8 = 0;
+
+  for (size_t dir = 0; dir < 4; ++dir)
+  {
+    if (ctx->last_arrow_keys[dir] == 0 ||
+        (dir_dx[dir] != 0 && dir_dx[dir] != ctx->arrow_mouse_dx) ||
+        (dir_dy[dir] != 0 && dir_dy[dir] != ctx->arrow_mouse_dy))
+      continue;
+    int64_t motion_q8 = (int64_t)calculate_mouse_speed(ctx, dir) * elapsed_us / ARROW_MOUSE_SPEED_PERIOD_US;
+    mx_q8 += dir_dx[dir] * motion_q8;
+    my_q8 += dir_dy[dir] * motion_q8;
+  }
+
+  int32_t dx = mx_q8 != 0 ? mouse_accel_carry(&ctx->arrow_mouse_accel.rem_x, (int32_t)mx_q8) : 0;
+  int32_t dy = my_q8 != 0 ? mouse_accel_carry(&ctx->arrow_mouse_accel.rem_y, (int32_t)my_q8) : 0;
+  if (dx == 0 && dy == 0)
+    return;
+
+  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                 "Mouse movement: dx=%" PRId32 " dy=%" PRId32 " over %" PRId64 "us", dx, dy, elapsed_us);
+  }
+  mouse_motion_t motion = {.x = dx, .y = dy};
+  output_submit_mouse(ctx, ctx->mouse_buttons, &motion);
+}
+
+// Arm the tick at the next connection event boundary, or stop it once no mouse key is held
+static void arrow_mouse_arm(m4g_bridge_ctx_t *ctx)
+{
+  if (ctx->arrow_mouse_dx == 0 && ctx->arrow_mouse_dy == 0)
+  {
+    bridge_set_timer(ctx, M4G_BRIDGE_TIMER_ARROW_MOUSE, 0);
+    return;
+  }
+  int64_t interval_us = output_interval_us(ctx);
+  int64_t now_us = bridge_now_us(ctx);
+  int64_t due_us = ctx->output_window_us;
+  if (now_us >= due_us)
+    due_us += ((now_us - due_us) / interval_us + 1) * interval_us;
+  bridge_set_timer(ctx, M4G_BRIDGE_TIMER_ARROW_MOUSE, due_us);
+}
+
+static void arrow_mouse_tick(m4g_bridge_ctx_t *ctx)
+{
+  if (ctx->arrow_mouse_dx == 0 && ctx->arrow_mouse_dy == 0)
+    return;
+  int64_t now_us = bridge_now_us(ctx);
+  if (now_us > ctx->arrow_mouse_until_us)
+  {
+    arrow_mouse_move(ctx, now_us - ctx->arrow_mouse_until_us);
+    ctx->arrow_mouse_until_us = now_us;
+  }
+  arrow_mouse_arm(ctx);
+}
+
+// Follow the mouse keys the host state holds: the motion so far goes the old
+// way, a first press moves at once, and the tick stops with the last release
+static void arrow_mouse_set_direction(m4g_bridge_ctx_t *ctx, int mx, int my)
+{
+  int8_t dx = (int8_t)((mx > 0) - (mx < 0));
+  int8_t dy = (int8_t)((my > 0) - (my < 0));
+  if (dx == ctx->arrow_mouse_dx && dy == ctx->arrow_mouse_dy)
+    return;
+
+  bool was_moving = ctx->arrow_mouse_dx != 0 || ctx->arrow_mouse_dy != 0;
+  arrow_mouse_tick(ctx);
+  ctx->arrow_mouse_dx = dx;
+  ctx->arrow_mouse_dy = dy;
+  if (!was_moving && (dx != 0 || dy != 0))
+  {
+    arrow_mouse_move(ctx, ARROW_MOUSE_SPEED_PERIOD_US);
+    ctx->arrow_mouse_until_us = bridge_now_us(ctx) + ARROW_MOUSE_SPEED_PERIOD_US;
+  }
+  arrow_mouse_arm(ctx);
+}
+#endif
+
+// Send exactly this keyboard state (and arrow-mouse motion) to the host
+static void emit_host_state(m4g_bridge_ctx_t *ctx, uint8_t modifiers, const key_bitmap_t *keys, bool allow_mouse,
+                            int mx, int my)
+{
+  uint8_t kb_report[8] = {0};
+  kb_report[0] = modifiers;
+  kb_report[1] = 0;
+  key_bitmap_to_6kro(keys, &kb_report[2]);
+
+  // NKRO whenever the host is in report protocol and every key fits its bitmap;
+  // boot protocol hosts only understand the 8-byte layout
+  bool use_nkro = output_report_nkro(ctx, keys);
+
+  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                 "Emit report: mod=0x%02X keys=[0x%02X 0x%02X 0x%02X 0x%02X 0x%02X 0x%02X] count=%u nkro=%d allow_mouse=%d mx=%d my=%d",
+                 kb_report[0], kb_report[2], kb_report[3], kb_report[4],
+                 kb_report[5], kb_report[6], kb_report[7], (unsigned)key_bitmap_count(keys), use_nkro,
+                 allow_mouse, mx, my);
+  }
+
+#ifdef CONFIG_M4G_ENABLE_DUPLICATE_SUPPRESSION
+  bool kb_changed = (!ctx->have_kb) || (use_nkro != ctx->last_kb_nkro) || (modifiers != ctx->last_kb_modifiers) ||
+                    (memcmp(&ctx->last_kb_keys, keys, sizeof(*keys)) != 0);
+#else
+  bool kb_changed = true;
+#endif
+
+  if (kb_changed)
+  {
+    // Switching report formats releases the old one first (output_transmit), so
+    // the host never sees a key stuck in the report that stopped updating
+    bool queued = true;
+    if (ctx->batch_sources)
+      output_batch_stage(ctx, use_nkro, modifiers, keys);
+    else
+      queued = output_submit_report(ctx, use_nkro, modifiers, keys);
+    if (queued)
+    {
+      memcpy(ctx->last_kb_report, kb_report, sizeof(kb_report));
+      ctx->last_kb_modifiers = modifiers;
+      ctx->last_kb_keys = *keys;
+      ctx->last_kb_nkro = use_nkro;
+      ctx->have_kb = true;
+    }
+    else
+    {
+      LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, E, BRIDGE_TAG, "Keyboard report failed (link=%d)",
+                   bridge_link_ready(ctx));
+    }
+  }
+  else if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, D, BRIDGE_TAG, "Duplicate keyboard report suppressed");
+  }
+
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+  if (allow_mouse)
+    arrow_mouse_set_direction(ctx, mx, my);
+#else
+  (void)allow_mouse;
+  (void)mx;
+  (void)my;
+#endif
+
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+  // Track key for repeat functionality (skip if this is a repeat emission)
+  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                 "emit_host_state tracking: in_repeat_emit=%d keys[0]=0x%02X",
+                 ctx->in_repeat_emit, key_bitmap_first(keys));
+  }
+
+  if (!ctx->in_repeat_emit)
+  {
+    int64_t now_us = bridge_input_us(ctx);
+
+    // Count how many keys are pressed
+    size_t key_count = key_bitmap_count(keys);
+    uint8_t current_key = key_bitmap_first(keys);
+
+    // If multiple keys are pressed, disable key repeat
+    // (this is likely a chord or intentional multi-key combination)
+    if (key_count > 1)
+    {
+      ctx->last_key = 0; // Disable repeat
+      ctx->repeat_started = false;
+      ctx->repeat_active = false;
+      ctx->repeat_cancel_pending = false;
+      if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+      {
+        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                     "Multi-key detected - disabling repeat");
+      }
+    }
+    // Check if key changed or released
+    else if (current_key != ctx->last_key || modifiers != ctx->last_modifiers)
+    {
+      if (current_key == 0)
+      {
+        // Zero state update should simply clear repeat tracking
+        ctx->last_key = 0;
+        ctx->last_modifiers = 0;
+        ctx->repeat_started = false;
+        ctx->repeat_active = false;
+        ctx->last_key_press_us = now_us;
+        ctx->repeat_cancel_pending = true;
+
+        if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+        {
+          LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                       "Repeat tracking cleared on key release");
+        }
+        return;
+      }
+
+      if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+      {
+        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                     "Key state change: last=0x%02X current=0x%02X repeat_started=%d",
+                     ctx->last_key, current_key, ctx->repeat_started);
+      }
+      // Key changed - reset repeat state before updating tracking
+      ctx->repeat_started = false;
+      ctx->repeat_active = false;
+
+      ctx->last_key = current_key;
+      ctx->last_modifiers = modifiers;
+      ctx->last_key_press_us = now_us;
+      ctx->repeat_cancel_pending = false;
+      ctx->last_key_direct = !key_bitmap_test(&ctx->chord_out_keys, current_key);
+    }
+    // Same key still held - keep original press time
+  }
+  else
+  {
+    if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+    {
+      LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                   "Skipping key tracking (in repeat emit)");
+    }
+  }
+#endif
+}
+
+// Present the chord FSM's keyboard state, with the ordinary keyboards' keys merged in
+static void emit_keyboard_state(m4g_bridge_ctx_t *ctx, uint8_t modifiers, const key_bitmap_t *keys, bool allow_mouse,
+                                int mx, int my)
+{
+  ctx->chord_out_modifiers = modifiers;
+  ctx->chord_out_keys = *keys;
+
+  key_bitmap_t merged = *keys;
+  key_bitmap_or(&merged, &ctx->direct_keys);
+  emit_host_state(ctx, (uint8_t)(modifiers | ctx->direct_modifiers), &merged, allow_mouse, mx, my);
+}
+
+// Emit without touching key repeat tracking (the key is not being held for repeat)
+static void emit_keyboard_state_untracked(m4g_bridge_ctx_t *ctx, uint8_t modifiers, const key_bitmap_t *keys)
+{
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+  bool prev_repeat_emit = ctx->in_repeat_emit;
+  ctx->in_repeat_emit = true;
+#endif
+  emit_keyboard_state(ctx, modifiers, keys, false, 0, 0);
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+  ctx->in_repeat_emit = prev_repeat_emit;
+#endif
+}
+
+#ifdef CONFIG_M4G_ABBREV_EXPANSION
+// The same without the merge: the host sees exactly this state
+static void emit_host_state_untracked(m4g_bridge_ctx_t *ctx, uint8_t modifiers, const key_bitmap_t *keys)
+{
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+  bool prev_repeat_emit = ctx->in_repeat_emit;
+  ctx->in_repeat_emit = true;
+#endif
+  emit_host_state(ctx, modifiers, keys, false, 0, 0);
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+  ctx->in_repeat_emit = prev_repeat_emit;
+#endif
+}
+#endif
+
+// Send the first key of a collection straight away instead of on release. Only
+// plain or shifted printable keys qualify, so one Backspace can always undo it.
+static void speculation_begin(m4g_bridge_ctx_t *ctx, const combined_state_t *state)
+{
+  if (ctx->speculative_key != 0 || ctx->chord_buffer_len != 1 || state->key_count != 1)
+    return;
+  if ((state->modifiers & ~HID_MODIFIER_SHIFT_MASK) != 0 || !m4g_settings_is_speculative_press_enabled())
+    return;
+
+  uint8_t key = key_bitmap_first(&state->key_bits);
+  uint8_t cls = s_keycode_class[key];
+  if (!(cls & KEYCLASS_PRINTABLE) || (cls & KEYCLASS_MOUSE))
+    return;
+
+  key_bitmap_t keys;
+  key_bitmap_single(&keys, key);
+  emit_keyboard_state_untracked(ctx, state->modifiers, &keys);
+  ctx->speculative_key = key;
+
+  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG, "Speculative press 0x%02X", key);
+  }
+}
+
+// The speculative key became part of a chord: release it and erase the character it typed
+static void speculation_rollback(m4g_bridge_ctx_t *ctx)
+{
+  key_bitmap_t backspace;
+  key_bitmap_single(&backspace, HID_USAGE_BACKSPACE);
+
+  emit_keyboard_state_untracked(ctx, 0, &s_no_keys);
+  emit_keyboard_state_untracked(ctx, 0, &backspace);
+  emit_keyboard_state_untracked(ctx, 0, &s_no_keys);
+
+  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG, "Speculative press 0x%02X rolled back",
+                 ctx->speculative_key);
+  }
+  ctx->speculative_key = 0;
+  ++ctx->speculative_misses;
+}
+
+// Classify a keyboard report by its gap to the previous report on the same slot
+static void robot_burst_classify(m4g_bridge_ctx_t *ctx, bridge_slot_state_t *slot_state, bool is_charachorder,
+                                 int64_t timestamp_us)
+{
+  int64_t gap_us = timestamp_us - slot_state->last_report_us;
+  bool machine_speed = is_charachorder && slot_state->last_report_us != 0 &&
+                       gap_us < CONFIG_M4G_CHARACHORDER_ROBOT_BURST_US;
+  slot_state->last_report_us = timestamp_us;
+
+  ctx->robot_burst = machine_speed;
+  if (!machine_speed)
+  {
+    ctx->robot_burst_run = 0;
+    return;
+  }
+  if (ctx->robot_burst_run == 0)
+  {
+    ++ctx->robot_bursts;
+    if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+    {
+      LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG, "Robot burst detected (gap=%lldus)",
+                   (long long)gap_us);
+    }
+  }
+  if (ctx->robot_burst_run < UINT8_MAX)
+    ++ctx->robot_burst_run;
+}
+
+static void grace_model_load(m4g_bridge_ctx_t *ctx)
+{
+  memset(&ctx->grace_model, 0, sizeof(ctx->grace_model));
+  ctx->grace_unsaved = 0;
+
+  grace_model_t stored;
+  esp_err_t err = ctx->io.persist_grace_model
+                      ? m4g_settings_load_blob(GRACE_MODEL_NVS_KEY, &stored, sizeof(stored))
+                      : ESP_ERR_NOT_SUPPORTED;
+  if (err == ESP_OK && stored.version == GRACE_MODEL_VERSION && stored.bin_ms == GRACE_HIST_BIN_MS)
+  {
+    ctx->grace_model = stored;
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG, "Loaded chord output latency model");
+  }
+  ctx->grace_model.version = GRACE_MODEL_VERSION;
+  ctx->grace_model.bin_ms = GRACE_HIST_BIN_MS;
+}
+
+static void grace_model_save(m4g_bridge_ctx_t *ctx)
+{
+  if (!ctx->io.persist_grace_model)
+  {
+    ctx->grace_unsaved = 0;
+    return;
+  }
+  if (m4g_settings_save_blob(GRACE_MODEL_NVS_KEY, &ctx->grace_model, sizeof(ctx->grace_model)) == ESP_OK)
+    ctx->grace_unsaved = 0;
+}
+
+static void grace_model_add(m4g_bridge_ctx_t *ctx, uint8_t row, int64_t latency_us)
+{
+  uint32_t bin = latency_us <= 0 ? 0 : (uint32_t)(latency_us / 1000 / GRACE_HIST_BIN_MS);
+  if (bin >= GRACE_HIST_BINS)
+    bin = GRACE_HIST_BINS - 1;
+
+  uint16_t *counts = ctx->grace_model.counts[row];
+  if (counts[bin] == UINT16_MAX)
+  {
+    // Age the row so recent behaviour keeps its weight
+    for (size_t i = 0; i < GRACE_HIST_BINS; ++i)
+      counts[i] >>= 1;
+  }
+  ++counts[bin];
+  ++ctx->grace_unsaved;
+}
+
+// Output window for a chord of the given histogram row
+static uint32_t grace_model_window_ms(m4g_bridge_ctx_t *ctx, uint8_t row)
+{
+  uint32_t static_ms = M4G_CHORD_OUTPUT_GRACE_MS;
+  if (!m4g_settings_is_adaptive_grace_enabled())
+    return static_ms;
+
+  const uint16_t *counts = ctx->grace_model.counts[row];
+  uint32_t total = 0;
+  for (size_t i = 0; i < GRACE_HIST_BINS; ++i)
+    total += counts[i];
+  if (total < GRACE_HIST_MIN_SAMPLES)
+    return static_ms;
+
+  uint32_t target = (total * m4g_settings_get_chord_grace_percentile() + 99) / 100;
+  uint32_t seen = 0;
+  size_t bin = 0;
+  for (; bin < GRACE_HIST_BINS - 1; ++bin)
+  {
+    seen += counts[bin];
+    if (seen >= target)
+      break;
+  }
+  if (bin == GRACE_HIST_BINS - 1)
+    return static_ms;
+
+  uint32_t window_ms = (uint32_t)(bin + 1) * GRACE_HIST_BIN_MS + m4g_settings_get_chord_grace_margin_ms();
+  return window_ms < static_ms ? window_ms : static_ms;
+}
+
+// A chord was released: start waiting for its output
+static void grace_wait_begin(m4g_bridge_ctx_t *ctx, size_t chord_size)
+{
+  ctx->grace_size = (uint8_t)((chord_size >= GRACE_HIST_SIZES ? GRACE_HIST_SIZES : (chord_size ? chord_size : 1)) - 1);
+  ctx->grace_release_us = ctx->report_us;
+  ctx->grace_window_ms = grace_model_window_ms(ctx, ctx->grace_size);
+  ctx->grace_pending = true;
+}
+
+// The released chord's output started at first_us
+static void grace_wait_output(m4g_bridge_ctx_t *ctx, int64_t first_us)
+{
+  if (!ctx->grace_pending)
+    return;
+  ctx->grace_pending = false;
+  if (first_us - ctx->grace_release_us >= (int64_t)ctx->grace_window_ms * 1000)
+    ++ctx->grace_late_outputs;
+  grace_model_add(ctx, ctx->grace_size, first_us - ctx->grace_release_us);
+}
+
+// Window the EXPECTING_OUTPUT state currently waits for
+static uint32_t chord_output_grace_ms(m4g_bridge_ctx_t *ctx)
+{
+  return ctx->grace_pending ? ctx->grace_window_ms : M4G_CHORD_OUTPUT_GRACE_MS;
+}
+
+// A collection starting after the learned window expired may still be slow chord
+// output; let a machine-speed follow-up claim it until the static timeout passes
+static void grace_mark_late_candidate(m4g_bridge_ctx_t *ctx)
+{
+  if (!ctx->grace_pending)
+    return;
+  if (ctx->report_us - ctx->grace_release_us < (int64_t)M4G_CHORD_OUTPUT_GRACE_MS * 1000)
+  {
+    ctx->burst_candidate = true;
+    ctx->burst_candidate_us = ctx->report_us;
+  }
+  else
+  {
+    ctx->grace_pending = false;
+  }
+}
+
+// Device output for a chord the local dictionary already typed
+static bool chord_output_swallowed(m4g_bridge_ctx_t *ctx)
+{
+#ifdef CONFIG_M4G_LOCAL_CHORDS
+  return ctx->report_us < ctx->local_swallow_until_us;
+#else
+  (void)ctx;
+  return false;
+#endif
+}
+
+#ifdef CONFIG_M4G_LOCAL_CHORDS
+// Resolve the released chord from the local dictionary and type its output now
+static bool local_chord_resolve(m4g_bridge_ctx_t *ctx)
+{
+  if (!m4g_chord_dict_ready() || ctx->chord_buffer_len < 2 || ctx->chord_buffer_len > M4G_CHORD_DICT_MAX_KEYS)
+    return false;
+
+  uint8_t keys[M4G_CHORD_DICT_MAX_KEYS];
+  key_bitmap_to_array(&ctx->chord_buffer, keys, ctx->chord_buffer_len);
+  size_t n_out = 0;
+  const m4g_chord_dict_output_t *out =
+      m4g_chord_dict_lookup(keys, ctx->chord_buffer_len, ctx->chord_buffer_modifiers, &n_out);
+  if (!out)
+    return false;
+
+  output_type_keystrokes(ctx, out, n_out, 0);
+
+  ctx->local_swallow_until_us = ctx->report_us + (int64_t)M4G_CHORD_OUTPUT_GRACE_MS * 1000;
+  ++ctx->local_chords;
+  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG, "Chord resolved locally (%u keys -> %u keystrokes)",
+                 (unsigned)ctx->chord_buffer_len, (unsigned)n_out);
+  }
+  return true;
+}
+#endif
+
+#ifdef CONFIG_M4G_ABBREV_EXPANSION
+// Feed an ordinary keyboard's presses to the abbreviation matcher. When a word
+// boundary completes an abbreviation, erase it and type the expansion before the
+// boundary key itself goes out. Returns true if anything was expanded.
+static bool abbrev_process_events(m4g_bridge_ctx_t *ctx, const key_event_t *events, size_t n_events, uint8_t modifiers)
+{
+  bool expanded = false;
+  for (size_t i = 0; i < n_events; ++i)
+  {
+    const key_event_t *ev = &events[i];
+    if (ev->is_modifier || !ev->pressed)
+      continue;
+
+    size_t erase_len = 0;
+    size_t n_out = 0;
+    const m4g_abbrev_output_t *out = m4g_abbrev_feed(&ctx->abbrev, ev->usage, modifiers, &erase_len, &n_out);
+    if (!out)
+      continue;
+
+    emit_host_state_untracked(ctx, 0, &s_no_keys);
+    output_type_keystrokes(ctx, out, n_out, (uint8_t)erase_len);
+
+    // The host has seen everything released; keys of the abbreviation that are
+    // still down must not come back when the real state is sent
+    ctx->abbrev_masked = ctx->held[SLOT_GROUP_DIRECT].keys;
+    key_bitmap_reset(&ctx->abbrev_masked, ev->usage);
+    ++ctx->abbrev_expansions;
+    expanded = true;
 
     if (ENABLE_DEBUG_KEYPRESS_LOGGING)
     {
-      LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                   "Repeat release detected in combine - buffer cleared");
+      LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG, "Abbreviation expanded (%u keys -> %u keystrokes)",
+                   (unsigned)erase_len, (unsigned)n_out);
     }
+  }
+  return expanded;
+}
+#endif
 
-    return;
+// Ordinary keyboards bypass chord detection: their state replaces the direct part of
+// the merge and goes out at once, whatever the chord FSM is waiting for
+static void direct_process_state(m4g_bridge_ctx_t *ctx, const combined_state_t *state)
+{
+  ctx->direct_modifiers = state->modifiers;
+  ctx->direct_keys = state->key_bits;
+  emit_keyboard_state(ctx, ctx->chord_out_modifiers, &ctx->chord_out_keys, true,
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+                      state->mouse_dx, state->mouse_dy
+#else
+                      0, 0
+#endif
+  );
+}
+
+// The collection that began inside the output window was the first report of a
+// burst: send the press that was held back and let the output flow through
+static void robot_burst_take_over(m4g_bridge_ctx_t *ctx)
+{
+  grace_wait_output(ctx, ctx->burst_candidate_us);
+
+  if (ctx->speculative_key != 0 && ctx->chord_buffer_len == 1 &&
+      key_bitmap_test(&ctx->chord_buffer, ctx->speculative_key))
+  {
+    // Press already went out speculatively
+    ++ctx->speculative_hits;
+  }
+  else if (!chord_output_swallowed(ctx))
+  {
+    emit_keyboard_state_untracked(ctx, ctx->chord_buffer_modifiers, &ctx->chord_buffer);
+  }
+
+  chord_buffer_reset(ctx);
+  ctx->chord_state = CHORD_STATE_PASSING_OUTPUT;
+  ctx->output_sequence_active = true;
+  ++ctx->chord_processed;
+}
+
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+// Repeat the chord FSM has to respect; a key repeating on an ordinary keyboard is not its business
+static inline bool chord_repeat_active(m4g_bridge_ctx_t *ctx)
+{
+  return ctx->repeat_active && !ctx->last_key_direct;
+}
+#endif
+
+// Chord FSM: a state x event table of actions. A report is a press while anything
+// in the chord group is active and a release once nothing is; the deadline timer
+// posts the third event. The actions that depend on a feature take a feature mask
+// and are instantiated once per variant, so a variant carries no checks for the
+// features it leaves out:
+//  - raw:   chord mode is off for the report, the state is passed straight through
+//  - chord: the FSM with no repeating key to release or hold back and no arrow-mouse motion
+//  - full:  the FSM with both (only built with CONFIG_M4G_ENABLE_KEY_REPEAT or
+//           CONFIG_M4G_ENABLE_ARROW_MOUSE)
+// process_combined_state() picks the variant per report from state that settles
+// it, so every report gets the output the full variant would give it.
+typedef enum
+{
+  CHORD_EVENT_PRESS = 0, // Keys or arrow-mouse motion active in the chord group
+  CHORD_EVENT_RELEASE,   // Nothing active any more
+  CHORD_EVENT_DEADLINE,  // The state's deadline (chord_state_deadline) passed
+  CHORD_EVENT_COUNT,
+} chord_event_t;
+
+#define CHORD_FSM_REPEAT 0x01u // Release, or hold back the release of, a key being repeated
+#define CHORD_FSM_MOUSE 0x02u  // Arrow-mouse motion counts as activity and goes out with the keys
+
+#if defined(CONFIG_M4G_ENABLE_KEY_REPEAT) && defined(CONFIG_M4G_ENABLE_ARROW_MOUSE)
+#define CHORD_FSM_FULL_FEATURES (CHORD_FSM_REPEAT | CHORD_FSM_MOUSE)
+#elif defined(CONFIG_M4G_ENABLE_KEY_REPEAT)
+#define CHORD_FSM_FULL_FEATURES CHORD_FSM_REPEAT
+#elif defined(CONFIG_M4G_ENABLE_ARROW_MOUSE)
+#define CHORD_FSM_FULL_FEATURES CHORD_FSM_MOUSE
+#else
+#define CHORD_FSM_FULL_FEATURES 0u
+#endif
+
+// Expanded into each variant with its feature mask as a constant
+#define CHORD_FSM_INLINE static inline __attribute__((always_inline))
+
+typedef struct
+{
+  const combined_state_t *state; // NULL for CHORD_EVENT_DEADLINE
+  const key_event_t *events;
+  size_t n_events;
+  int64_t now_us;
+  bool has_keys;
+  bool use_chord;
+} chord_input_t;
+
+typedef void (*chord_action_t)(m4g_bridge_ctx_t *ctx, const chord_input_t *in);
+
+static bool chord_deadline_due(m4g_bridge_ctx_t *ctx, int64_t now_us)
+{
+  int64_t deadline_us;
+  return chord_state_deadline(ctx, &deadline_us) && now_us >= deadline_us;
+}
+
+CHORD_FSM_INLINE bool chord_has_activity(const chord_input_t *in, unsigned features)
+{
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+  if ((features & CHORD_FSM_MOUSE) && (in->state->mouse_dx != 0 || in->state->mouse_dy != 0))
+    return true;
+#endif
+  (void)features;
+  return in->has_keys;
+}
+
+CHORD_FSM_INLINE void chord_emit_state(m4g_bridge_ctx_t *ctx, const combined_state_t *state, unsigned features)
+{
+  int mx = 0;
+  int my = 0;
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+  if (features & CHORD_FSM_MOUSE)
+  {
+    mx = state->mouse_dx;
+    my = state->mouse_dy;
   }
 #endif
+  (void)features;
+  emit_keyboard_state(ctx, state->modifiers, &state->key_bits, true, mx, my);
+}
 
-  if (ENABLE_DEBUG_KEYPRESS_LOGGING && has_keys)
+// Chord mode is off for this report: drop any collection and pass the state through
+CHORD_FSM_INLINE void chord_pass_through(m4g_bridge_ctx_t *ctx, const chord_input_t *in, unsigned features)
+{
+  chord_buffer_reset(ctx);
+  ctx->chord_state = CHORD_STATE_IDLE;
+  ctx->output_sequence_active = false;
+  ctx->expect_output_us = in->now_us;
+  chord_emit_state(ctx, in->state, features);
+}
+
+// Bookkeeping every variant does before its transition
+static void chord_report_begin(m4g_bridge_ctx_t *ctx, const chord_input_t *in, bool use_chord)
+{
+  const combined_state_t *state = in->state;
+  if (ENABLE_DEBUG_KEYPRESS_LOGGING && in->has_keys)
   {
     LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                 "process_combined_state: use_chord=%d charachorder=%d keys=%d",
-                 use_chord, state->any_charachorder, state->key_count);
+                 "process_combined_state: use_chord=%d charachorder=%d keys=%u",
+                 use_chord, state->any_charachorder, (unsigned)state->key_count);
   }
 
   // Track multi-key sequences for backspace filtering (works in both chord and RAW mode)
-  static size_t s_last_key_count = 0;
   if (state->any_charachorder)
   {
-    if (state->key_count == 0 && s_last_key_count >= 2)
+    if (state->key_count == 0 && ctx->last_key_count >= 2)
     {
       // Multi-key chord just released - enable backspace filtering
-      s_filter_backspaces = true;
-      s_last_chord_release_tick = now;
+      ctx->filter_backspaces = true;
+      ctx->last_chord_release_us = in->now_us;
       if (ENABLE_DEBUG_KEYPRESS_LOGGING)
       {
         LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
                      "Multi-key release detected - enabling backspace filter for 500ms");
       }
     }
-    s_last_key_count = state->key_count;
+    ctx->last_key_count = state->key_count;
   }
+}
+
+// Start collecting a chord from this report's keys
+static void chord_collect_begin(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  chord_buffer_start(ctx, in->state);
+  ctx->chord_state = CHORD_STATE_COLLECTING;
+  ctx->chord_collect_start_us = in->now_us;
+}
 
-  if (!use_chord)
+static void chord_log_quality(m4g_bridge_ctx_t *ctx)
+{
+  // Calculate press deviation (time from first to last key press)
+  int64_t press_deviation_us = 0;
+  if (ctx->chord_last_press_us > ctx->chord_first_press_us)
   {
-    chord_buffer_reset();
-    s_chord_state = CHORD_STATE_IDLE;
-    s_output_sequence_active = false;
-    s_expect_output_tick = now;
-    emit_keyboard_state(state->modifiers, state->keys, true,
-#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
-                        state->mouse_dx, state->mouse_dy
-#else
-                        0, 0
-#endif
-    );
-    return;
+    press_deviation_us = ctx->chord_last_press_us - ctx->chord_first_press_us;
   }
 
-  switch (s_chord_state)
+  // Determine chord quality based on CharaChorder thresholds
+  // Perfect: <= 10ms per key, Good: <= 25ms per key, Acceptable: <= per-key thresholds
+  const char *quality = "ACCEPTABLE";
+  int64_t per_key_press_threshold_us = ms_to_us(m4g_settings_get_chord_press_deviation_max_ms());
+  int64_t perfect_threshold_us = ms_to_us(10 * (ctx->chord_buffer_len - 1)); // 10ms per additional key
+  int64_t good_threshold_us = ms_to_us(25 * (ctx->chord_buffer_len - 1));    // 25ms per additional key
+
+  if (press_deviation_us <= perfect_threshold_us)
   {
-  case CHORD_STATE_IDLE:
-    if (has_activity)
-    {
-      chord_buffer_reset();
-      chord_buffer_add(state);
-      s_chord_state = CHORD_STATE_COLLECTING;
-      s_chord_collect_start_tick = now;
+    quality = "PERFECT";
+  }
+  else if (press_deviation_us <= good_threshold_us)
+  {
+    quality = "GOOD";
+  }
+  else if (press_deviation_us > per_key_press_threshold_us)
+  {
+    quality = "POOR";
+  }
+
+  LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+               "Chord quality: %s (press_deviation=%" PRId64 ".%03" PRId64 "ms, peak_keys=%u)",
+               quality, press_deviation_us / 1000, press_deviation_us % 1000,
+               (unsigned)ctx->chord_key_count_peak);
+}
 
 #ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-      // Stop any active key repeat when entering chord collection
-      s_last_key = 0;
-      s_repeat_started = false;
-      s_repeat_active = false;
+// COLLECTING x DEADLINE: a single key held past the hold threshold is a held key
+static void chord_on_held_deadline(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  start_repeat_from_held_key(ctx, in->now_us - ctx->chord_collect_start_us, m4g_settings_get_key_repeat_delay_ms());
+}
+#define CHORD_FSM_HELD_DEADLINE chord_on_held_deadline
+#else
+#define CHORD_FSM_HELD_DEADLINE NULL
 #endif
 
-      if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-      {
-        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                     "Chord collecting started (keys=%u)", (unsigned)state->key_count);
-      }
-    }
+// EXPECTING_OUTPUT x DEADLINE: the CharaChorder produced nothing, so this wasn't a chord
+static void chord_on_output_deadline(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  (void)in;
+  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                 "Deadline - discarding %u buffered key(s) (failed chord attempt)",
+                 (unsigned)ctx->chord_buffer_len);
+  }
+  if (ctx->grace_pending && ctx->grace_window_ms < M4G_CHORD_OUTPUT_GRACE_MS)
+    ++ctx->grace_early_expiries;
+  chord_buffer_reset(ctx);
+  ctx->chord_state = CHORD_STATE_IDLE;
+  ctx->output_sequence_active = false;
+}
+
+static void chord_on_idle_press(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  chord_collect_begin(ctx, in);
+  grace_mark_late_candidate(ctx);
+  speculation_begin(ctx, in->state);
+
 #ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-    else if (s_repeat_active)
-    {
-      // Key released while repeat was active - emit release and reset state
-      uint8_t empty_keys[6] = {0};
-      emit_keyboard_state(s_last_modifiers, empty_keys, true, 0, 0);
+  // Stop any active key repeat when entering chord collection
+  ctx->last_key = 0;
+  ctx->repeat_started = false;
+  ctx->repeat_active = false;
+#endif
 
-      chord_buffer_reset();
-      s_last_key = 0;
-      s_last_modifiers = 0;
-      s_repeat_started = false;
-      s_repeat_active = false;
+  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                 "Chord collecting started (keys=%u)", (unsigned)in->state->key_count);
+  }
+}
 
-      if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-      {
-        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                     "Repeat ended - key release forwarded to host");
-      }
-    }
-    else if (s_last_key != 0)
+CHORD_FSM_INLINE void chord_idle_release(m4g_bridge_ctx_t *ctx, const chord_input_t *in, unsigned features)
+{
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+  if ((features & CHORD_FSM_REPEAT) && ctx->last_key != 0 && !ctx->last_key_direct &&
+      !m4g_settings_is_host_typematic_enabled())
+  {
+    // Key is being tracked for repeat - don't emit release yet
+    // The repeat system will handle it when key actually releases
+    if (ENABLE_DEBUG_KEYPRESS_LOGGING)
     {
-      // Key is being tracked for repeat - don't emit release yet
-      // The repeat system will handle it when key actually releases
-      if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-      {
-        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                     "Suppressing IDLE release - key repeat active for 0x%02X", s_last_key);
-      }
+      LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                   "Suppressing IDLE release - key repeat active for 0x%02X", ctx->last_key);
     }
+    return;
+  }
 #endif
-    else
-    {
-      // No activity in IDLE state - this is a key release, pass it through
-      emit_keyboard_state(state->modifiers, state->keys, true,
-#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
-                          state->mouse_dx, state->mouse_dy
-#else
-                          0, 0
-#endif
-      );
-    }
-    break;
+  // No activity in IDLE state - this is a key release, pass it through
+  chord_emit_state(ctx, in->state, features);
+}
 
-  case CHORD_STATE_COLLECTING:
-    if (has_activity)
-    {
-      chord_buffer_add(state);
+static void chord_on_collect_press(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  chord_buffer_add(ctx, in->state, in->events, in->n_events);
+  if (ctx->speculative_key != 0 && ctx->chord_buffer_len >= 2)
+    speculation_rollback(ctx);
+  else
+    speculation_begin(ctx, in->state);
 
 #ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-      if (s_chord_buffer_len == 1)
-      {
-        TickType_t collect_duration = now - s_chord_collect_start_tick;
-        uint32_t repeat_delay_ms = m4g_settings_get_key_repeat_delay_ms();
-        uint32_t chord_timeout_ms = m4g_settings_get_chord_timeout_ms();
-        uint32_t hold_threshold_ms = repeat_delay_ms;
-
-        if (hold_threshold_ms == 0 || (chord_timeout_ms > 0 && chord_timeout_ms < hold_threshold_ms))
-        {
-          if (chord_timeout_ms > 0)
-            hold_threshold_ms = chord_timeout_ms;
-        }
+  // A single key held past the hold threshold, reported before the deadline timer fired
+  if (chord_deadline_due(ctx, in->now_us))
+  {
+    chord_on_held_deadline(ctx, in);
+    return;
+  }
+#endif
 
-        TickType_t hold_threshold_ticks = pdMS_TO_TICKS(hold_threshold_ms);
+  // If we now have multiple keys, we're definitely in a chord
+  if (ctx->chord_buffer_len >= 2)
+  {
+    if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+    {
+      LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                   "Multi-key chord detected (%u keys)", (unsigned)ctx->chord_buffer_len);
+    }
+  }
+}
 
-        if (hold_threshold_ms == 0 || collect_duration >= hold_threshold_ticks)
-        {
-          if (start_repeat_from_held_key(now, collect_duration, repeat_delay_ms))
-          {
-            s_repeat_active = true;
-            return;
-          }
-        }
-      }
-#endif
+static void chord_on_collect_release(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  int64_t collect_us = in->now_us - ctx->chord_collect_start_us;
 
-      // If we now have multiple keys, we're definitely in a chord
-      if (s_chord_buffer_len >= 2)
-      {
-        if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-        {
-          LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                       "Multi-key chord detected (%u keys)", (unsigned)s_chord_buffer_len);
-        }
-      }
+  // If single key released quickly (< chord timeout), emit immediately
+  // This handles normal typing - no need to wait for CharaChorder
+  if (ctx->chord_buffer_len == 1 && collect_us < ms_to_us(m4g_settings_get_chord_timeout_ms()))
+  {
+    // Quick single keypress - send immediately (press then release)
+    uint8_t key = key_bitmap_first(&ctx->chord_buffer);
+    if (ctx->speculative_key == key)
+    {
+      // Press already went out speculatively
+      ++ctx->speculative_hits;
     }
     else
     {
-      // Physical keys released
-      TickType_t collect_duration = now - s_chord_collect_start_tick;
+      key_bitmap_t keys;
+      key_bitmap_single(&keys, key);
+      emit_keyboard_state_untracked(ctx, ctx->chord_buffer_modifiers, &keys);
+    }
+    emit_keyboard_state(ctx, 0, &s_no_keys, true, 0, 0); // Send key release
+
+    if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+    {
+      LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                   "Quick single key (0x%02X) - sent immediately", key);
+    }
+
+    chord_buffer_reset(ctx);
+    ctx->chord_state = CHORD_STATE_IDLE;
 
-      // If single key released quickly (< chord timeout), emit immediately
-      // This handles normal typing - no need to wait for CharaChorder
-      if (s_chord_buffer_len == 1 && collect_duration < pdMS_TO_TICKS(m4g_settings_get_chord_timeout_ms()))
-      {
-        // Quick single keypress - send immediately (press then release)
-        uint8_t keys[6] = {s_chord_buffer[0], 0, 0, 0, 0, 0};
 #ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-        bool prev_repeat_emit = s_in_repeat_emit;
-        s_in_repeat_emit = true;
+    ctx->last_key = 0;
+    ctx->last_modifiers = 0;
+    ctx->repeat_started = false;
+    ctx->repeat_active = false;
+    ctx->repeat_cancel_pending = false;
 #endif
-        emit_keyboard_state(s_chord_buffer_modifiers, keys, true, 0, 0);
-#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-        s_in_repeat_emit = prev_repeat_emit;
+    return;
+  }
+
+  // Either multi-key OR single key held long enough - wait for CharaChorder output
+  if (ctx->speculative_key != 0)
+    speculation_rollback(ctx);
+#ifdef CONFIG_M4G_LOCAL_CHORDS
+  bool resolved_locally = local_chord_resolve(ctx);
+#else
+  bool resolved_locally = false;
 #endif
-        uint8_t empty[6] = {0};
-        emit_keyboard_state(0, empty, true, 0, 0); // Send key release
+  ctx->expect_output_us = in->now_us;
+  ctx->output_sequence_active = false;
+  ctx->chord_state = CHORD_STATE_EXPECTING_OUTPUT;
+  ctx->filter_backspaces = true; // Start filtering backspaces during chord output
+  ctx->last_chord_release_us = in->now_us;
+  if (!resolved_locally)
+    grace_wait_begin(ctx, ctx->chord_buffer_len);
 
-        if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-        {
-          LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                       "Quick single key (0x%02X) - sent immediately", keys[0]);
-        }
+  if (ENABLE_DEBUG_KEYPRESS_LOGGING)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                 "Chord released (%u keys, %ums held) awaiting CharaChorder output",
+                 (unsigned)ctx->chord_buffer_len,
+                 (unsigned)(collect_us / 1000));
 
-        chord_buffer_reset();
-        s_chord_state = CHORD_STATE_IDLE;
+    // Log chord quality metrics if deviation tracking is enabled
+    if (m4g_settings_is_deviation_tracking_enabled() && ctx->chord_buffer_len >= 2)
+      chord_log_quality(ctx);
+  }
+}
 
-#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-        s_last_key = 0;
-        s_last_modifiers = 0;
-        s_repeat_started = false;
-        s_repeat_active = false;
-        s_repeat_cancel_pending = false;
-#endif
-      }
-      else
-      {
-        // Either multi-key OR single key held long enough - wait for CharaChorder output
-        s_expect_output_tick = now;
-        s_output_sequence_active = false;
-        s_chord_state = CHORD_STATE_EXPECTING_OUTPUT;
-        s_filter_backspaces = true; // Start filtering backspaces during chord output
-        s_last_chord_release_tick = now;
-#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-        if (s_chord_buffer_len == 1)
-        {
-          // Repeat is handled by m4g_bridge_process_key_repeat once buffer is cleared
-        }
-#endif
+// A report in EXPECTING_OUTPUT: a filtered Backspace extends the window, and a
+// report arriving past the deadline expires it before anything else (the timer
+// normally gets there first). Returns true if the chord was discarded.
+static bool chord_expect_expired(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  // CharaChorder sends backspaces before the actual word output
+  if (ctx->just_filtered_backspace)
+  {
+    grace_wait_output(ctx, ctx->report_us);
+    ctx->expect_output_us = in->now_us;
+    ctx->just_filtered_backspace = false;
+  }
 
-        if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-        {
-          LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                       "Chord released (%u keys, %ums held) awaiting CharaChorder output",
-                       (unsigned)s_chord_buffer_len,
-                       (unsigned)pdTICKS_TO_MS(collect_duration));
-
-          // Log chord quality metrics if deviation tracking is enabled
-          if (m4g_settings_is_deviation_tracking_enabled() && s_chord_buffer_len >= 2)
-          {
-            // Calculate press deviation (time from first to last key press)
-            uint32_t press_deviation_ms = 0;
-            if (s_last_key_press_tick > s_first_key_press_tick)
-            {
-              press_deviation_ms = pdTICKS_TO_MS(s_last_key_press_tick - s_first_key_press_tick);
-            }
-
-            // Determine chord quality based on CharaChorder thresholds
-            // Perfect: <= 10ms per key, Good: <= 25ms per key, Acceptable: <= per-key thresholds
-            const char *quality = "ACCEPTABLE";
-            uint32_t per_key_press_threshold = m4g_settings_get_chord_press_deviation_max_ms();
-            uint32_t perfect_threshold = 10 * (s_chord_buffer_len - 1); // 10ms per additional key
-            uint32_t good_threshold = 25 * (s_chord_buffer_len - 1);    // 25ms per additional key
-
-            if (press_deviation_ms <= perfect_threshold)
-            {
-              quality = "PERFECT";
-            }
-            else if (press_deviation_ms <= good_threshold)
-            {
-              quality = "GOOD";
-            }
-            else if (press_deviation_ms > per_key_press_threshold)
-            {
-              quality = "POOR";
-            }
-
-            LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                         "Chord quality: %s (press_deviation=%lums, peak_keys=%u)",
-                         quality, (unsigned long)press_deviation_ms, (unsigned)s_chord_key_count_peak);
-          }
-        }
-      }
-    }
-    break;
+  if (!chord_deadline_due(ctx, in->now_us))
+    return false;
+  chord_on_output_deadline(ctx, in);
+  return true;
+}
 
-  case CHORD_STATE_EXPECTING_OUTPUT:
-    // If we just filtered a backspace, extend the grace period
-    // CharaChorder sends backspaces before the actual word output
-    if (s_just_filtered_backspace)
+CHORD_FSM_INLINE void chord_expect_press(m4g_bridge_ctx_t *ctx, const chord_input_t *in, unsigned features)
+{
+  if (chord_expect_expired(ctx, in))
+  {
+    // Start fresh from IDLE with this report
+    chord_collect_begin(ctx, in);
+    grace_mark_late_candidate(ctx);
+    speculation_begin(ctx, in->state);
+  }
+  else if (!ctx->robot_burst)
+  {
+    // Finger-speed activity: the chord produced nothing and the user is typing
+    // again. Collect it like a fresh press; a machine-speed next report on the
+    // slot still turns it into output.
+    if (ENABLE_DEBUG_KEYPRESS_LOGGING)
     {
-      s_expect_output_tick = now;
-      s_just_filtered_backspace = false;
+      LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                   "Human-speed press in output window - discarding %u buffered key(s)",
+                   (unsigned)ctx->chord_buffer_len);
     }
+    chord_collect_begin(ctx, in);
+    ctx->burst_candidate = true;
+    ctx->burst_candidate_us = ctx->report_us;
+    speculation_begin(ctx, in->state);
+  }
+  else
+  {
+    // CharaChorder sent output - this was a real chord, pass it through
+    grace_wait_output(ctx, ctx->report_us);
+    ctx->chord_state = CHORD_STATE_PASSING_OUTPUT;
+    ctx->output_sequence_active = true;
+    ++ctx->chord_processed;
+    chord_buffer_reset(ctx); // Clear buffer since CharaChorder handled it
+    if (!chord_output_swallowed(ctx))
+      chord_emit_state(ctx, in->state, features);
+  }
+}
 
-    // Check if timeout expired FIRST (before processing new activity)
-    TickType_t delta = now - s_expect_output_tick;
-    if (delta > pdMS_TO_TICKS(M4G_CHORD_OUTPUT_GRACE_MS))
-    {
-      // Timeout - CharaChorder didn't output anything, so this wasn't a chord
-      // For multi-key combinations or held single keys, just discard the buffer
-      // (user attempted a chord but it didn't match anything)
-      if (ENABLE_DEBUG_KEYPRESS_LOGGING)
-      {
-        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                     "Timeout - discarding %u buffered key(s) (failed chord attempt)",
-                     (unsigned)s_chord_buffer_len);
-      }
+static void chord_on_expect_release(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  chord_expect_expired(ctx, in);
+}
 
-      chord_buffer_reset();
-      s_chord_state = CHORD_STATE_IDLE;
-      s_output_sequence_active = false;
+CHORD_FSM_INLINE void chord_pass_press(m4g_bridge_ctx_t *ctx, const chord_input_t *in, unsigned features)
+{
+  if (!chord_output_swallowed(ctx))
+    chord_emit_state(ctx, in->state, features);
+}
 
-      // Now process new activity if present (start fresh from IDLE state)
-      if (has_activity)
-      {
-        chord_buffer_add(state);
-        s_chord_state = CHORD_STATE_COLLECTING;
-        s_chord_collect_start_tick = now;
-#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-        if (s_chord_buffer_len == 1)
-        {
-          // Repeat will be handled by repeat task after new activity processed
-        }
+CHORD_FSM_INLINE void chord_pass_release(m4g_bridge_ctx_t *ctx, const chord_input_t *in, unsigned features)
+{
+  if (!chord_output_swallowed(ctx))
+    chord_emit_state(ctx, in->state, features);
+  ctx->expect_output_us = in->now_us;
+  ctx->chord_state = CHORD_STATE_EXPECTING_OUTPUT;
+}
+
+CHORD_FSM_INLINE void chord_fsm_step(m4g_bridge_ctx_t *ctx, const chord_input_t *in, unsigned features,
+                                     const chord_action_t table[CHORD_STATE_COUNT][CHORD_EVENT_COUNT])
+{
+  if (ctx->chord_state == CHORD_STATE_COLLECTING && ctx->burst_candidate)
+  {
+    if (ctx->robot_burst)
+      robot_burst_take_over(ctx);
+    else
+      ctx->burst_candidate = false; // Finger-speed follow-up: an ordinary collection
+  }
+
+  chord_event_t event = chord_has_activity(in, features) ? CHORD_EVENT_PRESS : CHORD_EVENT_RELEASE;
+  table[ctx->chord_state][event](ctx, in);
+}
+
+// Instantiate the feature-dependent actions of a variant and its transition table
+#define CHORD_FSM_VARIANT(name, features)                                                                         \
+  static void chord_##name##_idle_release(m4g_bridge_ctx_t *ctx, const chord_input_t *in)                         \
+  {                                                                                                               \
+    chord_idle_release(ctx, in, features);                                                                        \
+  }                                                                                                               \
+  static void chord_##name##_expect_press(m4g_bridge_ctx_t *ctx, const chord_input_t *in)                         \
+  {                                                                                                               \
+    chord_expect_press(ctx, in, features);                                                                        \
+  }                                                                                                               \
+  static void chord_##name##_pass_press(m4g_bridge_ctx_t *ctx, const chord_input_t *in)                           \
+  {                                                                                                               \
+    chord_pass_press(ctx, in, features);                                                                          \
+  }                                                                                                               \
+  static void chord_##name##_pass_release(m4g_bridge_ctx_t *ctx, const chord_input_t *in)                         \
+  {                                                                                                               \
+    chord_pass_release(ctx, in, features);                                                                        \
+  }                                                                                                               \
+  static const chord_action_t s_chord_fsm_##name[CHORD_STATE_COUNT][CHORD_EVENT_COUNT] = {                        \
+      [CHORD_STATE_IDLE] = {chord_on_idle_press, chord_##name##_idle_release, NULL},                              \
+      [CHORD_STATE_COLLECTING] = {chord_on_collect_press, chord_on_collect_release, CHORD_FSM_HELD_DEADLINE},     \
+      [CHORD_STATE_EXPECTING_OUTPUT] = {chord_##name##_expect_press, chord_on_expect_release,                     \
+                                        chord_on_output_deadline},                                                \
+      [CHORD_STATE_PASSING_OUTPUT] = {chord_##name##_pass_press, chord_##name##_pass_release, NULL},              \
+  };
+
+CHORD_FSM_VARIANT(chord, 0u)
+#if CHORD_FSM_FULL_FEATURES
+CHORD_FSM_VARIANT(full, CHORD_FSM_FULL_FEATURES)
 #endif
-      }
+
+static void chord_fsm_raw(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  chord_report_begin(ctx, in, false);
+  chord_pass_through(ctx, in, 0u);
+}
+
+static void chord_fsm_chord(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  chord_report_begin(ctx, in, true);
+  chord_fsm_step(ctx, in, 0u, s_chord_fsm_chord);
+}
+
+#if CHORD_FSM_FULL_FEATURES
+static void chord_fsm_full(m4g_bridge_ctx_t *ctx, const chord_input_t *in)
+{
+  bool use_chord = in->use_chord;
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+  if (chord_repeat_active(ctx))
+  {
+    if (in->has_keys)
+    {
+      use_chord = false;
     }
-    else if (has_activity)
+    else
     {
-      // Within grace window and have activity
-      if (delta <= pdMS_TO_TICKS(M4G_CHORD_OUTPUT_GRACE_MS))
+      // Immediate release when repeat was active but no keys remain
+      ctx->repeat_cancel_pending = true;
+      emit_keyboard_state(ctx, ctx->last_modifiers, &s_no_keys, true, 0, 0);
+
+      chord_buffer_reset(ctx);
+      ctx->chord_state = CHORD_STATE_IDLE;
+      ctx->expect_output_us = in->now_us;
+      ctx->last_key = 0;
+      ctx->last_modifiers = 0;
+      ctx->repeat_started = false;
+      ctx->repeat_active = false;
+
+      if (ENABLE_DEBUG_KEYPRESS_LOGGING)
       {
-        // CharaChorder sent output - this was a real chord, pass it through
-        s_chord_state = CHORD_STATE_PASSING_OUTPUT;
-        s_output_sequence_active = true;
-        ++s_chord_processed;
-        chord_buffer_reset(); // Clear buffer since CharaChorder handled it
-        emit_keyboard_state(state->modifiers, state->keys, true,
-#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
-                            state->mouse_dx, state->mouse_dy
-#else
-                            0, 0
-#endif
-        );
+        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
+                     "Repeat release detected in combine - buffer cleared");
       }
+      return;
     }
-    break;
+  }
+#endif
+
+  chord_report_begin(ctx, in, use_chord);
+  if (use_chord)
+    chord_fsm_step(ctx, in, CHORD_FSM_FULL_FEATURES, s_chord_fsm_full);
+  else
+    chord_pass_through(ctx, in, CHORD_FSM_FULL_FEATURES);
+}
+#endif
+
+// Deadline actions are the same in every variant
+static void chord_deadline_expired(m4g_bridge_ctx_t *ctx, int64_t now_us)
+{
+  chord_input_t in = {.now_us = now_us};
+  chord_action_t action = s_chord_fsm_chord[ctx->chord_state][CHORD_EVENT_DEADLINE];
+  if (action)
+    action(ctx, &in);
+}
+
+static void process_combined_state(m4g_bridge_ctx_t *ctx, const combined_state_t *state, const key_event_t *events,
+                                   size_t n_events)
+{
+  if (!state)
+    return;
+
+  chord_input_t in = {
+      .state = state,
+      .events = events,
+      .n_events = n_events,
+      .now_us = bridge_input_us(ctx),
+      .has_keys = (state->key_count > 0) || (state->modifiers != 0),
+      .use_chord = use_chord_for_state(ctx, state),
+  };
 
-  case CHORD_STATE_PASSING_OUTPUT:
-    emit_keyboard_state(state->modifiers, state->keys, true,
 #ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
-                        state->mouse_dx, state->mouse_dy
-#else
-                        0, 0
+  if (state->mouse_dx != 0 || state->mouse_dy != 0)
+  {
+    chord_fsm_full(ctx, &in);
+    return;
+  }
 #endif
-    );
-    if (!has_activity)
-    {
-      s_expect_output_tick = now;
-      s_chord_state = CHORD_STATE_EXPECTING_OUTPUT;
-    }
-    break;
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+  // A key repeating for the FSM, or a release in IDLE that may have to wait for one
+  if (chord_repeat_active(ctx) || (in.use_chord && !in.has_keys && ctx->chord_state == CHORD_STATE_IDLE &&
+                                   ctx->last_key != 0 && !ctx->last_key_direct))
+  {
+    chord_fsm_full(ctx, &in);
+    return;
   }
+#endif
+
+  if (in.use_chord)
+    chord_fsm_chord(ctx, &in);
+  else
+    chord_fsm_raw(ctx, &in);
 }
 
 #ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-static void emit_repeat_cycle(uint8_t key, uint8_t modifiers)
+static void emit_repeat_cycle(m4g_bridge_ctx_t *ctx, uint8_t key, uint8_t modifiers)
 {
   if (key == 0)
     return;
 
-  uint8_t release_keys[6] = {0};
-  uint8_t press_keys[6] = {key, 0, 0, 0, 0, 0};
+  key_bitmap_t press_keys;
+  key_bitmap_single(&press_keys, key);
 
-  s_in_repeat_emit = true;
-  emit_keyboard_state(modifiers, release_keys, false, 0, 0);
-  s_in_repeat_emit = false;
+  ctx->in_repeat_emit = true;
+  emit_host_state(ctx, modifiers, &s_no_keys, false, 0, 0);
+  ctx->in_repeat_emit = false;
 
-  if (s_repeat_cancel_pending || !s_repeat_active || s_last_key == 0)
+  if (ctx->repeat_cancel_pending || !ctx->repeat_active || ctx->last_key == 0)
   {
-    s_repeat_cancel_pending = false;
-    s_repeat_started = false;
-    s_repeat_active = false;
+    ctx->repeat_cancel_pending = false;
+    ctx->repeat_started = false;
+    ctx->repeat_active = false;
 
     if (ENABLE_DEBUG_KEYPRESS_LOGGING)
     {
@@ -1164,13 +3357,13 @@ static void emit_repeat_cycle(uint8_t key, uint8_t modifiers)
     return;
   }
 
-  if (!is_key_currently_active(key))
+  if (!is_key_currently_active(ctx, key))
   {
-    s_repeat_cancel_pending = false;
-    s_repeat_started = false;
-    s_repeat_active = false;
-    s_last_key = 0;
-    s_last_modifiers = 0;
+    ctx->repeat_cancel_pending = false;
+    ctx->repeat_started = false;
+    ctx->repeat_active = false;
+    ctx->last_key = 0;
+    ctx->last_modifiers = 0;
 
     if (ENABLE_DEBUG_KEYPRESS_LOGGING)
     {
@@ -1181,12 +3374,11 @@ static void emit_repeat_cycle(uint8_t key, uint8_t modifiers)
     return;
   }
 
-  s_in_repeat_emit = true;
-  emit_keyboard_state(modifiers, press_keys, false, 0, 0);
-  s_in_repeat_emit = false;
+  ctx->in_repeat_emit = true;
+  emit_host_state(ctx, modifiers, &press_keys, false, 0, 0);
+  ctx->in_repeat_emit = false;
 
-  s_repeat_cancel_pending = false;
-  s_last_repeat_time = xTaskGetTickCount();
+  ctx->repeat_cancel_pending = false;
 
   if (ENABLE_DEBUG_KEYPRESS_LOGGING)
   {
@@ -1195,73 +3387,52 @@ static void emit_repeat_cycle(uint8_t key, uint8_t modifiers)
   }
 }
 
-static bool is_key_currently_active(uint8_t key)
+static bool is_key_currently_active(m4g_bridge_ctx_t *ctx, uint8_t key)
 {
   if (key == 0)
     return false;
 
-  for (uint8_t slot = 0; slot < M4G_BRIDGE_MAX_SLOTS; ++slot)
-  {
-    if (!s_slots[slot].present)
-      continue;
-
-    for (size_t i = 0; i < 6; ++i)
-    {
-      if (s_slots[slot].keys[i] == key)
-        return true;
-    }
-  }
-
-  return false;
+  return key_held_anywhere(ctx, key);
 }
 
-static bool start_repeat_from_held_key(TickType_t now, TickType_t collect_duration, uint32_t repeat_delay_ms)
+static bool start_repeat_from_held_key(m4g_bridge_ctx_t *ctx, int64_t collect_us, uint32_t repeat_delay_ms)
 {
-  if (s_chord_buffer_len != 1)
+  if (ctx->chord_buffer_len != 1)
     return false;
 
-  uint8_t held_key = s_chord_buffer[0];
+  uint8_t held_key = key_bitmap_first(&ctx->chord_buffer);
   if (held_key == 0)
     return false;
 
-  uint8_t held_modifiers = s_chord_buffer_modifiers;
-  uint8_t keys[6] = {held_key, 0, 0, 0, 0, 0};
+  uint8_t held_modifiers = ctx->chord_buffer_modifiers;
+  key_bitmap_t keys;
+  key_bitmap_single(&keys, held_key);
+  if (ctx->speculative_key == held_key)
+    ++ctx->speculative_hits;
 
-  emit_keyboard_state(held_modifiers, keys, true, 0, 0);
-
-  chord_buffer_reset();
-  s_chord_state = CHORD_STATE_IDLE;
-
-  TickType_t repeat_delay_ticks = pdMS_TO_TICKS(repeat_delay_ms);
-  if (repeat_delay_ms == 0)
-  {
-    repeat_delay_ticks = 0;
-  }
+  emit_keyboard_state(ctx, held_modifiers, &keys, true, 0, 0);
 
-  s_last_key = held_key;
-  s_last_modifiers = held_modifiers;
+  chord_buffer_reset(ctx);
+  ctx->chord_state = CHORD_STATE_IDLE;
 
-  if (collect_duration >= repeat_delay_ticks)
-  {
-    s_last_key_press_time = now - repeat_delay_ticks;
-  }
-  else
-  {
-    s_last_key_press_time = now - collect_duration;
-  }
+  // Backdate the press to when the key went down, capped so repeat starts no later than now
+  int64_t now_us = bridge_input_us(ctx);
+  int64_t repeat_delay_us = ms_to_us(repeat_delay_ms);
 
-  s_last_repeat_time = now;
-  s_repeat_started = false;
-  s_repeat_active = true;
-  s_repeat_cancel_pending = false;
-  s_in_repeat_emit = false;
+  ctx->last_key = held_key;
+  ctx->last_modifiers = held_modifiers;
+  ctx->last_key_press_us = now_us - (collect_us < repeat_delay_us ? collect_us : repeat_delay_us);
+  ctx->last_repeat_us = now_us;
+  ctx->repeat_started = false;
+  ctx->repeat_active = true;
+  ctx->repeat_cancel_pending = false;
+  ctx->in_repeat_emit = false;
 
   if (ENABLE_DEBUG_KEYPRESS_LOGGING)
   {
     LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
                  "Held key promoted to repeat: key=0x%02X delay_ms=%" PRIu32 " held_ms=%" PRIu32,
-                 held_key, repeat_delay_ms,
-                 (uint32_t)pdTICKS_TO_MS(collect_duration));
+                 held_key, repeat_delay_ms, (uint32_t)(collect_us / 1000));
   }
 
   return true;
@@ -1269,43 +3440,69 @@ static bool start_repeat_from_held_key(TickType_t now, TickType_t collect_durati
 
 #endif
 
-void m4g_bridge_get_stats(m4g_bridge_stats_t *out)
+void m4g_bridge_ctx_get_stats(m4g_bridge_ctx_t *ctx, m4g_bridge_stats_t *out)
 {
-  if (!out)
+  if (!ctx || !out)
     return;
-  out->keyboard_reports_sent = s_kb_sent;
-  out->mouse_reports_sent = s_mouse_sent;
-  out->chord_reports_processed = s_chord_processed;
-  out->chord_reports_delayed = s_chord_delayed;
+  out->keyboard_reports_sent = ctx->kb_sent;
+  out->mouse_reports_sent = ctx->mouse_sent;
+  out->chord_reports_processed = ctx->chord_processed;
+  out->chord_reports_delayed = ctx->chord_delayed;
+  out->events_dropped = 0;
+  for (size_t i = 0; i < M4G_BRIDGE_SOURCE_COUNT; ++i)
+    out->events_dropped += ctx->rings[i].dropped;
+  out->max_event_latency_us = ctx->max_event_latency_us;
+  out->reports_unchanged = ctx->reports_unchanged;
+  out->speculative_hits = ctx->speculative_hits;
+  out->speculative_misses = ctx->speculative_misses;
+  out->robot_bursts = ctx->robot_bursts;
+  out->grace_early_expiries = ctx->grace_early_expiries;
+  out->grace_late_outputs = ctx->grace_late_outputs;
+  out->output_reports_deferred = ctx->output_deferred;
+  out->output_link_refusals = ctx->output_refusals;
+  out->output_reports_dropped = ctx->output_dropped;
+  out->reports_coalesced = ctx->reports_coalesced;
+  out->mouse_reports_merged = ctx->mouse_merged;
+#ifdef CONFIG_M4G_LOCAL_CHORDS
+  out->local_chords = ctx->local_chords;
+#else
+  out->local_chords = 0;
+#endif
+#ifdef CONFIG_M4G_ABBREV_EXPANSION
+  out->abbrev_expansions = ctx->abbrev_expansions;
+#else
+  out->abbrev_expansions = 0;
+#endif
 }
 
-bool m4g_bridge_get_last_keyboard(uint8_t out[8])
+bool m4g_bridge_ctx_get_last_keyboard(m4g_bridge_ctx_t *ctx, uint8_t out[8])
 {
-  if (!s_have_kb)
+  if (!ctx || !ctx->have_kb)
     return false;
-  memcpy(out, s_last_kb_report, 8);
+  memcpy(out, ctx->last_kb_report, 8);
   return true;
 }
 
-bool m4g_bridge_get_last_mouse(uint8_t out[3])
+bool m4g_bridge_ctx_get_last_mouse(m4g_bridge_ctx_t *ctx, uint8_t out[M4G_BRIDGE_MOUSE_REPORT_LEN])
 {
-  if (!s_have_mouse)
+  if (!ctx || !ctx->have_mouse)
     return false;
-  memcpy(out, s_last_mouse_report, 3);
+  memcpy(out, ctx->last_mouse_report, M4G_BRIDGE_MOUSE_REPORT_LEN);
   return true;
 }
 
-void m4g_bridge_process_usb_report(uint8_t slot, const uint8_t *report, size_t len, bool is_charachorder)
+static void bridge_handle_report(m4g_bridge_ctx_t *ctx, uint8_t slot, const uint8_t *report, size_t len,
+                                 bool is_charachorder, int64_t timestamp_us)
 {
-  if (!report || len == 0)
+  if (len == 0)
     return;
 
   if (slot >= M4G_BRIDGE_MAX_SLOTS)
   {
-    if (!s_warned_invalid_slot)
+    if (!ctx->warned_invalid_slot)
     {
       LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, W, BRIDGE_TAG, "Ignoring report for invalid slot %u", slot);
-      s_warned_invalid_slot = true;
+      ctx->warned_invalid_slot = true;
     }
     return;
   }
@@ -1313,41 +3510,41 @@ void m4g_bridge_process_usb_report(uint8_t slot, const uint8_t *report, size_t l
   const uint8_t *kb_payload = NULL;
   size_t kb_len = 0;
 
-  // Check for mouse report (Report ID 0x02) - forward to BLE
-  if (len > 0 && report[0] == 0x02)
+  // Mouse reports - forward to BLE through the output pacing. A slot whose report
+  // descriptor was read is decoded with its layout, any other with the boot-style one
+  const bridge_slot_state_t *slot_state = &ctx->slots[slot];
+  const m4g_hid_mouse_layout_t *layout = slot_state->has_mouse_layout ? &slot_state->mouse_layout
+                                                                      : &s_boot_mouse_layout;
+  if (layout->report_id == 0 || report[0] == layout->report_id)
   {
-    // Mouse report format: [0x02, buttons, dx, dy, ...]
-    // We need at least 4 bytes: Report ID + buttons + dx + dy
-    if (len >= 4)
+    m4g_hid_mouse_state_t mouse;
+    if (m4g_hid_mouse_read(layout, report, len, &mouse)) // Too short for X and Y: dropped
     {
-      // Extract and apply acceleration to mouse movement
-      uint8_t mouse[3];
-      mouse[0] = report[1]; // buttons
-      int8_t dx = (int8_t)report[2];
-      int8_t dy = (int8_t)report[3];
+      uint8_t buttons = mouse.buttons & MOUSE_REPORT_BUTTONS;
+      mouse_motion_t motion = {
+          .x = mouse_clamp(mouse.x, MOUSE_REPORT_MAX_MOTION),
+          .y = mouse_clamp(mouse.y, MOUSE_REPORT_MAX_MOTION),
+          .wheel = mouse_clamp(mouse.wheel, MOUSE_REPORT_MAX_SCROLL),
+          .pan = mouse_clamp(mouse.pan, MOUSE_REPORT_MAX_SCROLL),
+      };
 
       // Apply acceleration to USB mouse movement
-      apply_usb_mouse_acceleration(&dx, &dy);
-
-      mouse[1] = (uint8_t)dx;
-      mouse[2] = (uint8_t)dy;
+      apply_usb_mouse_acceleration(ctx, timestamp_us, &motion.x, &motion.y);
+#ifdef CONFIG_M4G_ABBREV_EXPANSION
+      // A click may have moved the text cursor away from the word being typed
+      if (buttons)
+        m4g_abbrev_reset(&ctx->abbrev);
+#endif
 
       if (ENABLE_DEBUG_KEYPRESS_LOGGING)
       {
         LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                     "USB Mouse: buttons=0x%02X dx=%d dy=%d (accelerated from %d,%d)",
-                     mouse[0], (int8_t)mouse[1], (int8_t)mouse[2],
-                     (int8_t)report[2], (int8_t)report[3]);
+                     "USB Mouse: buttons=0x%02X dx=%" PRId32 " dy=%" PRId32 " (accelerated from %" PRId32
+                     ",%" PRId32 ") wheel=%" PRId32 " pan=%" PRId32,
+                     buttons, motion.x, motion.y, mouse.x, mouse.y, motion.wheel, motion.pan);
       }
 
-      if (m4g_ble_send_mouse_report(mouse))
-      {
-        ++s_mouse_sent;
-      }
-      else
-      {
-        LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, W, BRIDGE_TAG, "USB mouse report forward failed");
-      }
+      output_submit_mouse(ctx, buttons, &motion);
     }
     return;
   }
@@ -1372,32 +3569,78 @@ void m4g_bridge_process_usb_report(uint8_t slot, const uint8_t *report, size_t l
     return;
   }
 
-  bridge_slot_state_t *state = &s_slots[slot];
-  uint8_t slot_keys[6] = {0};
-  size_t key_count = extract_chara_keys(kb_payload, kb_len, slot_keys, is_charachorder);
+  bridge_slot_state_t *state = &ctx->slots[slot];
+  // A slot that changes sides leaves its keys in the old group first
+  if (state->present && state->is_charachorder != is_charachorder)
+    bridge_handle_reset_slot(ctx, slot);
+
+  slot_group_t group = slot_group(is_charachorder);
+  ctx->report_us = timestamp_us;
+  if (group == SLOT_GROUP_CHORD)
+    robot_burst_classify(ctx, state, is_charachorder, timestamp_us);
+
+  uint8_t modifiers = kb_payload[0];
+  key_bitmap_t keys;
+  key_bitmap_clear(&keys);
+  extract_chara_keys(ctx, kb_payload, kb_len, &keys, &modifiers, is_charachorder);
+
+  key_event_t events[BRIDGE_MAX_KEY_EVENTS];
+  size_t n_events = diff_slot_keys(state, modifiers, &keys, events);
+
+  // A repeated report changes nothing downstream. A filtered backspace still has to
+  // reach the chord FSM because it extends the output grace window.
+  if (n_events == 0 && state->present && state->is_charachorder == is_charachorder && !ctx->just_filtered_backspace)
+  {
+    ++ctx->reports_unchanged;
+    return;
+  }
 
   state->present = true;
   state->is_charachorder = is_charachorder;
-  state->modifiers = (kb_len >= 1) ? kb_payload[0] : 0;
-  memset(state->keys, 0, sizeof(state->keys));
-  if (key_count > 0)
-    memcpy(state->keys, slot_keys, key_count);
+  if (is_charachorder)
+    ctx->charachorder_slots |= 1u << slot;
+  else
+    ctx->charachorder_slots &= ~(1u << slot);
+  state->modifiers = modifiers;
+  state->keys = keys;
+  apply_key_events(ctx, group, events, n_events);
 
   if (ENABLE_DEBUG_KEYPRESS_LOGGING)
   {
+    uint8_t logged[6];
+    key_bitmap_to_array(&state->keys, logged, sizeof(logged));
     LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
                  "Slot %u update: mod=0x%02X keys=[0x%02X 0x%02X 0x%02X 0x%02X 0x%02X 0x%02X]",
                  slot, state->modifiers,
-                 state->keys[0], state->keys[1], state->keys[2],
-                 state->keys[3], state->keys[4], state->keys[5]);
+                 logged[0], logged[1], logged[2],
+                 logged[3], logged[4], logged[5]);
   }
 
   combined_state_t combined;
-  compute_combined_state(&combined);
-  process_combined_state(&combined);
+  compute_combined_state(ctx, &combined, group);
+  if (group == SLOT_GROUP_DIRECT)
+  {
+#ifdef CONFIG_M4G_ABBREV_EXPANSION
+    if (m4g_abbrev_ready())
+    {
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+      // Arrow-mouse keys move the pointer instead of typing
+      if (combined.mouse_dx != 0 || combined.mouse_dy != 0)
+        m4g_abbrev_reset(&ctx->abbrev);
+      else
+#endif
+      if (abbrev_process_events(ctx, events, n_events, modifiers))
+        compute_combined_state(ctx, &combined, group);
+    }
+#endif
+    direct_process_state(ctx, &combined);
+    return;
+  }
+  process_combined_state(ctx, &combined, events, n_events);
+  chord_deadline_update(ctx);
 }
 
-void m4g_bridge_reset_slot(uint8_t slot)
+static void bridge_handle_reset_slot(m4g_bridge_ctx_t *ctx, uint8_t slot)
 {
   if (slot >= M4G_BRIDGE_MAX_SLOTS)
     return;
@@ -1406,90 +3649,476 @@ void m4g_bridge_reset_slot(uint8_t slot)
   {
     LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG, "Resetting slot %u", slot);
   }
-  chord_buffer_reset();
-  s_chord_state = CHORD_STATE_IDLE;
-  s_expect_output_tick = xTaskGetTickCount();
+  slot_group_t group = slot_group(ctx->slots[slot].is_charachorder);
+  if (group == SLOT_GROUP_CHORD)
+  {
+    chord_buffer_reset(ctx);
+    ctx->chord_state = CHORD_STATE_IDLE;
+    ctx->expect_output_us = bridge_input_us(ctx);
+    chord_deadline_update(ctx);
+  }
 
-  memset(s_slots[slot].keys, 0, sizeof(s_slots[slot].keys));
-  s_slots[slot].modifiers = 0;
-  s_slots[slot].present = false;
-  s_slots[slot].is_charachorder = false;
+  key_event_t events[BRIDGE_MAX_KEY_EVENTS];
+  size_t n_events = diff_slot_keys(&ctx->slots[slot], 0, &s_no_keys, events);
+  apply_key_events(ctx, group, events, n_events);
 
-  uint8_t empty_keys[6] = {0};
-  emit_keyboard_state(0, empty_keys, false, 0, 0);
+  key_bitmap_clear(&ctx->slots[slot].keys);
+  ctx->slots[slot].modifiers = 0;
+  ctx->slots[slot].present = false;
+  ctx->slots[slot].is_charachorder = false;
+  ctx->slots[slot].last_report_us = 0;
+  ctx->charachorder_slots &= ~(1u << slot);
+
+  if (group == SLOT_GROUP_CHORD)
+  {
+    emit_keyboard_state(ctx, 0, &s_no_keys, false, 0, 0);
+  }
+  else
+  {
+    combined_state_t combined;
+    compute_combined_state(ctx, &combined, group);
+    direct_process_state(ctx, &combined);
+  }
 }
 
-void m4g_bridge_process_key_repeat(void)
+static void bridge_handle_key_repeat(m4g_bridge_ctx_t *ctx)
 {
 #ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
-  TickType_t now = xTaskGetTickCount();
-
-  // First, check if a single key has been held long enough to start repeat.
-  // Once the hold threshold elapses, treat it as a held key even in chord mode.
-  if (s_chord_state == CHORD_STATE_COLLECTING && s_chord_buffer_len == 1)
-  {
-    TickType_t collect_duration = now - s_chord_collect_start_tick;
-    uint32_t repeat_delay_ms = m4g_settings_get_key_repeat_delay_ms();
-    uint32_t chord_timeout_ms = m4g_settings_get_chord_timeout_ms();
-    uint32_t hold_threshold_ms = repeat_delay_ms;
-
-    if (hold_threshold_ms == 0 || (chord_timeout_ms > 0 && chord_timeout_ms < hold_threshold_ms))
-    {
-      if (chord_timeout_ms > 0)
-        hold_threshold_ms = chord_timeout_ms;
-    }
+  int64_t now_us = bridge_input_us(ctx);
 
-    TickType_t hold_threshold_ticks = pdMS_TO_TICKS(hold_threshold_ms);
+  // Single keys held in chord collection are promoted by the chord deadline timer
 
-    if (hold_threshold_ms == 0 || collect_duration >= hold_threshold_ticks)
-    {
-      start_repeat_from_held_key(now, collect_duration, repeat_delay_ms);
-    }
-  }
+  // The host repeats the held press itself
+  if (m4g_settings_is_host_typematic_enabled())
+    return;
 
   // Only process repeat if a key is currently held
-  if (s_last_key == 0)
+  if (ctx->last_key == 0)
   {
-    s_repeat_started = false;
-    s_repeat_active = false;
-    s_repeat_cancel_pending = false;
-    s_in_repeat_emit = false;
+    ctx->repeat_started = false;
+    ctx->repeat_active = false;
+    ctx->repeat_cancel_pending = false;
+    ctx->in_repeat_emit = false;
     return;
   }
 
-  TickType_t elapsed = now - s_last_key_press_time;
-
-  if (!s_repeat_started)
+  if (!ctx->repeat_started)
   {
     // Check if we've exceeded the initial delay
     uint32_t repeat_delay_ms = m4g_settings_get_key_repeat_delay_ms();
-    if (elapsed >= pdMS_TO_TICKS(repeat_delay_ms))
+    int64_t due_us = ctx->last_key_press_us + (int64_t)repeat_delay_ms * 1000;
+    if (now_us >= due_us)
     {
       // Start repeating
-      s_repeat_started = true;
-      s_repeat_active = true;
-      s_repeat_cancel_pending = false;
+      ctx->repeat_started = true;
+      ctx->repeat_active = true;
+      ctx->repeat_cancel_pending = false;
+      ctx->last_repeat_us = due_us;
 
-      emit_repeat_cycle(s_last_key, s_last_modifiers);
+      emit_repeat_cycle(ctx, ctx->last_key, ctx->last_modifiers);
 
       if (ENABLE_DEBUG_KEYPRESS_LOGGING)
       {
         LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, I, BRIDGE_TAG,
-                     "Key repeat started: key=0x%02X (after %" PRIu32 "ms)", s_last_key, repeat_delay_ms);
+                     "Key repeat started: key=0x%02X (after %" PRIu32 "ms)", ctx->last_key, repeat_delay_ms);
       }
     }
   }
   else
   {
     // Already repeating - check if it's time for next cycle
-    TickType_t since_last_repeat = now - s_last_repeat_time;
-    uint32_t repeat_rate_ms = m4g_settings_get_key_repeat_rate_ms();
+    int64_t rate_us = (int64_t)m4g_settings_get_key_repeat_rate_ms() * 1000;
+    int64_t due_us = ctx->last_repeat_us + rate_us;
+
+    if (now_us >= due_us)
+    {
+      // Stay on the original cadence unless a whole period was missed
+      ctx->last_repeat_us = (now_us - due_us < rate_us) ? due_us : now_us;
+      emit_repeat_cycle(ctx, ctx->last_key, ctx->last_modifiers);
+    }
+  }
+
+#else
+  (void)ctx;
+#endif
+}
 
-    if (since_last_repeat >= pdMS_TO_TICKS(repeat_rate_ms))
+static void bridge_handle_mouse_layout(m4g_bridge_ctx_t *ctx, uint8_t slot, const uint8_t *data)
+{
+  if (slot >= M4G_BRIDGE_MAX_SLOTS)
+    return;
+  bridge_slot_state_t *state = &ctx->slots[slot];
+  state->has_mouse_layout = data != NULL;
+  if (data)
+  {
+    memcpy(&state->mouse_layout, data, sizeof(state->mouse_layout));
+    if (ENABLE_DEBUG_USB_LOGGING)
     {
-      emit_repeat_cycle(s_last_key, s_last_modifiers);
+      LOG_AND_SAVE(ENABLE_DEBUG_USB_LOGGING, I, BRIDGE_TAG,
+                   "Slot %u mouse report: id=%u buttons=%u x=%u@%u y=%u@%u wheel=%u pan=%u", slot,
+                   state->mouse_layout.report_id, state->mouse_layout.buttons.bits, state->mouse_layout.x.bits,
+                   state->mouse_layout.x.offset, state->mouse_layout.y.bits, state->mouse_layout.y.offset,
+                   state->mouse_layout.wheel.bits, state->mouse_layout.pan.bits);
     }
   }
+}
+
+static void bridge_handle_event(m4g_bridge_ctx_t *ctx, const bridge_event_t *ev)
+{
+  switch (ev->type)
+  {
+  case BRIDGE_EVENT_REPORT:
+    bridge_handle_report(ctx, ev->slot, ev->data, ev->len, ev->is_charachorder, ev->timestamp_us);
+    break;
+  case BRIDGE_EVENT_RESET_SLOT:
+    bridge_handle_reset_slot(ctx, ev->slot);
+    // A different interface may come up behind the slot
+    bridge_handle_mouse_layout(ctx, ev->slot, NULL);
+    break;
+  case BRIDGE_EVENT_MOUSE_LAYOUT:
+    bridge_handle_mouse_layout(ctx, ev->slot, ev->len ? ev->data : NULL);
+    break;
+  case BRIDGE_EVENT_STATUS:
+    bridge_handle_status(ctx, ev->detected, ev->both_halves);
+    break;
+  case BRIDGE_EVENT_DEADLINE:
+    chord_deadline_update(ctx);
+    break;
+  case BRIDGE_EVENT_KEY_REPEAT:
+    bridge_handle_key_repeat(ctx);
+    break;
+  case BRIDGE_EVENT_OUTPUT:
+    output_pump(ctx);
+    break;
+  case BRIDGE_EVENT_ARROW_MOUSE:
+#ifdef CONFIG_M4G_ENABLE_ARROW_MOUSE
+    arrow_mouse_tick(ctx);
+#endif
+    break;
+  case BRIDGE_EVENT_TYPE_TEXT:
+  {
+    const char *text;
+    m4g_bridge_output_done_cb_t done;
+    void *arg;
+    memcpy(&text, ev->data, sizeof(text));
+    memcpy(&done, ev->data + sizeof(text), sizeof(done));
+    memcpy(&arg, ev->data + sizeof(text) + sizeof(done), sizeof(arg));
+    output_submit_job(ctx, OUTPUT_ENTRY_TEXT, text, 0, 0, done, arg);
+    break;
+  }
+  default:
+    break;
+  }
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+  key_repeat_update(ctx);
+#endif
+
+  // Write the latency model back between chords, never in the middle of one
+  if (ctx->grace_unsaved >= GRACE_MODEL_SAVE_EVERY && ctx->chord_state == CHORD_STATE_IDLE &&
+      ctx->held[SLOT_GROUP_CHORD].key_count == 0 && ctx->held[SLOT_GROUP_DIRECT].key_count == 0)
+    grace_model_save(ctx);
+}
+
+// Move the input clock up to until_us, first running the chord deadline and key
+// repeat at each time one fell due on the way. Live input never finds one here, as
+// their timers fire first; a batch delivered late finds the hold threshold and
+// repeat points that passed between two of its reports.
+static void bridge_advance_input(m4g_bridge_ctx_t *ctx, int64_t until_us)
+{
+  int64_t deadline_done_us = INT64_MIN;
+  for (;;)
+  {
+    int64_t deadline_us;
+    bool deadline = chord_state_deadline(ctx, &deadline_us) && deadline_us <= until_us &&
+                    deadline_us > deadline_done_us;
+    int64_t due_us = deadline_us;
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+    int64_t repeat_us = ctx->key_repeat_armed_us;
+    bool repeat = repeat_us != 0 && repeat_us <= until_us && (!deadline || repeat_us < deadline_us);
+    if (repeat)
+      due_us = repeat_us;
+#else
+    bool repeat = false;
+#endif
+    if (!deadline && !repeat)
+      break;
 
+    if (due_us > ctx->input_us)
+      ctx->input_us = due_us;
+    if (repeat)
+    {
+      bridge_handle_key_repeat(ctx);
+    }
+    else
+    {
+      chord_deadline_update(ctx);
+      deadline_done_us = deadline_us;
+    }
+#ifdef CONFIG_M4G_ENABLE_KEY_REPEAT
+    key_repeat_update(ctx);
 #endif
+  }
+  if (until_us > ctx->input_us)
+    ctx->input_us = until_us;
+}
+
+// Events that drive the chord FSM or key repeat; output, pointer and app work
+// leaves the input clock where it is
+static bool bridge_event_is_input(const bridge_event_t *ev)
+{
+  switch (ev->type)
+  {
+  case BRIDGE_EVENT_REPORT:
+  case BRIDGE_EVENT_RESET_SLOT:
+  case BRIDGE_EVENT_STATUS:
+  case BRIDGE_EVENT_DEADLINE:
+  case BRIDGE_EVENT_KEY_REPEAT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void m4g_bridge_ctx_drain_events(m4g_bridge_ctx_t *ctx)
+{
+  if (!ctx)
+    return;
+  for (;;)
+  {
+    // Merge the producer rings by timestamp so USB and ESP-NOW input stays ordered
+    bridge_ring_t *next_ring = NULL;
+    bridge_event_t *next = NULL;
+    for (size_t i = 0; i < M4G_BRIDGE_SOURCE_COUNT; ++i)
+    {
+      bridge_event_t *ev = ring_peek(&ctx->rings[i]);
+      if (ev && (!next || ev->timestamp_us < next->timestamp_us))
+      {
+        next = ev;
+        next_ring = &ctx->rings[i];
+      }
+    }
+    if (!next)
+      break;
+
+    int64_t waited_us = bridge_now_us(ctx) - next->timestamp_us;
+    if (waited_us > (int64_t)ctx->max_event_latency_us)
+      ctx->max_event_latency_us = (uint32_t)waited_us;
+
+    // Keyboard states stay staged until the last report of every open batch
+    uint32_t source_bit = 1u << (next_ring - ctx->rings);
+    bool batch_more = next->type == BRIDGE_EVENT_REPORT && next->batch_more;
+    if (batch_more)
+      ctx->batch_sources |= source_bit;
+    if (bridge_event_is_input(next))
+      bridge_advance_input(ctx, next->timestamp_us);
+    bridge_handle_event(ctx, next);
+    ring_consume(next_ring);
+    if (!batch_more && (ctx->batch_sources & source_bit))
+    {
+      ctx->batch_sources &= ~source_bit;
+      if (!ctx->batch_sources)
+        output_batch_flush(ctx);
+    }
+  }
+  // A batch is published whole, so none can still be open here
+  ctx->batch_sources = 0;
+  output_batch_flush(ctx);
+}
+
+static void bridge_task(void *arg)
+{
+  m4g_bridge_ctx_t *ctx = arg;
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    m4g_bridge_ctx_drain_events(ctx);
+  }
+}
+
+bool m4g_bridge_ctx_submit_report(m4g_bridge_ctx_t *ctx, m4g_bridge_source_t source, uint8_t slot,
+                                  const uint8_t *report, size_t len, bool is_charachorder)
+{
+  if (!ctx || source >= M4G_BRIDGE_SOURCE_COUNT || !report || len == 0)
+    return false;
+
+  bridge_ring_t *ring = &ctx->rings[source];
+  bridge_event_t *ev = ring_reserve(ring);
+  if (!ev)
+    return false;
+
+  // Reports longer than an event (none seen in practice) keep their leading bytes
+  if (len > BRIDGE_EVENT_MAX_REPORT)
+    len = BRIDGE_EVENT_MAX_REPORT;
+  ev->timestamp_us = bridge_now_us(ctx);
+  ev->type = BRIDGE_EVENT_REPORT;
+  ev->slot = slot;
+  ev->is_charachorder = is_charachorder;
+  ev->batch_more = false;
+  ev->len = (uint8_t)len;
+  memcpy(ev->data, report, len);
+  ring_publish(ctx, ring);
+  return true;
+}
+
+size_t m4g_bridge_ctx_process_reports(m4g_bridge_ctx_t *ctx, m4g_bridge_source_t source,
+                                      const m4g_bridge_report_t *reports, size_t n)
+{
+  if (!ctx || source >= M4G_BRIDGE_SOURCE_COUNT || !reports)
+    return 0;
+
+  // Fill every free slot the batch needs, then publish them together so the bridge
+  // task never sees part of a batch
+  bridge_ring_t *ring = &ctx->rings[source];
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  size_t room = ring->mask + 1 - (head - tail);
+  size_t count = n < room ? n : room;
+  int64_t now_us = bridge_now_us(ctx);
+  size_t queued = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    const m4g_bridge_report_t *report = &reports[i];
+    if (!report->data || report->len == 0)
+      continue;
+    bridge_event_t *ev = &ring->events[(head + queued) & ring->mask];
+    size_t len = report->len > BRIDGE_EVENT_MAX_REPORT ? BRIDGE_EVENT_MAX_REPORT : report->len;
+    ev->timestamp_us = report->timestamp_us ? report->timestamp_us : now_us;
+    ev->type = BRIDGE_EVENT_REPORT;
+    ev->slot = report->slot;
+    ev->is_charachorder = report->is_charachorder;
+    ev->batch_more = true;
+    ev->len = (uint8_t)len;
+    memcpy(ev->data, report->data, len);
+    ++queued;
+  }
+  if (queued == 0)
+    return count;
+  ring->events[(head + queued - 1) & ring->mask].batch_more = false;
+  ring_publish_many(ctx, ring, (uint32_t)queued);
+  return count;
+}
+
+void m4g_bridge_ctx_reset_slot(m4g_bridge_ctx_t *ctx, uint8_t slot)
+{
+  if (!ctx)
+    return;
+  bridge_ring_t *ring = &ctx->rings[M4G_BRIDGE_SOURCE_USB];
+  bridge_event_t *ev = ring_reserve(ring);
+  if (!ev)
+    return;
+  ev->timestamp_us = bridge_now_us(ctx);
+  ev->type = BRIDGE_EVENT_RESET_SLOT;
+  ev->slot = slot;
+  ring_publish(ctx, ring);
+}
+
+bool m4g_bridge_ctx_type_text(m4g_bridge_ctx_t *ctx, const char *text, m4g_bridge_output_done_cb_t done, void *arg)
+{
+  if (!ctx || !text)
+    return false;
+
+  bridge_ring_t *ring = &ctx->rings[M4G_BRIDGE_SOURCE_APP];
+  bridge_event_t *ev = ring_reserve(ring);
+  if (!ev)
+    return false;
+  _Static_assert(sizeof(text) + sizeof(done) + sizeof(arg) <= BRIDGE_EVENT_MAX_REPORT, "text event too small");
+  ev->timestamp_us = bridge_now_us(ctx);
+  ev->type = BRIDGE_EVENT_TYPE_TEXT;
+  memcpy(ev->data, &text, sizeof(text));
+  memcpy(ev->data + sizeof(text), &done, sizeof(done));
+  memcpy(ev->data + sizeof(text) + sizeof(done), &arg, sizeof(arg));
+  ring_publish(ctx, ring);
+  return true;
+}
+
+void m4g_bridge_ctx_set_mouse_layout(m4g_bridge_ctx_t *ctx, uint8_t slot, const m4g_hid_mouse_layout_t *layout)
+{
+  if (!ctx)
+    return;
+  bridge_ring_t *ring = &ctx->rings[M4G_BRIDGE_SOURCE_USB];
+  bridge_event_t *ev = ring_reserve(ring);
+  if (!ev)
+    return;
+  _Static_assert(sizeof(*layout) <= BRIDGE_EVENT_MAX_REPORT, "mouse layout event too small");
+  ev->timestamp_us = bridge_now_us(ctx);
+  ev->type = BRIDGE_EVENT_MOUSE_LAYOUT;
+  ev->slot = slot;
+  ev->len = layout ? (uint8_t)sizeof(*layout) : 0;
+  if (layout)
+    memcpy(ev->data, layout, sizeof(*layout));
+  ring_publish(ctx, ring);
+}
+
+void m4g_bridge_ctx_set_charachorder_status(m4g_bridge_ctx_t *ctx, bool detected, bool both_halves_connected)
+{
+  if (!ctx)
+    return;
+  bridge_ring_t *ring = &ctx->rings[M4G_BRIDGE_SOURCE_USB];
+  bridge_event_t *ev = ring_reserve(ring);
+  if (!ev)
+    return;
+  ev->timestamp_us = bridge_now_us(ctx);
+  ev->type = BRIDGE_EVENT_STATUS;
+  ev->detected = detected;
+  ev->both_halves = both_halves_connected;
+  ring_publish(ctx, ring);
+}
+
+// ---------------------------------------------------------------------------
+// Default instance API
+
+bool m4g_bridge_submit_report(m4g_bridge_source_t source, uint8_t slot, const uint8_t *report, size_t len,
+                              bool is_charachorder)
+{
+  return m4g_bridge_ctx_submit_report(&s_default_ctx, source, slot, report, len, is_charachorder);
+}
+
+void m4g_bridge_process_usb_report(uint8_t slot, const uint8_t *report, size_t len, bool is_charachorder)
+{
+  m4g_bridge_ctx_submit_report(&s_default_ctx, M4G_BRIDGE_SOURCE_USB, slot, report, len, is_charachorder);
+}
+
+size_t m4g_bridge_process_reports(m4g_bridge_source_t source, const m4g_bridge_report_t *reports, size_t n)
+{
+  return m4g_bridge_ctx_process_reports(&s_default_ctx, source, reports, n);
+}
+
+void m4g_bridge_reset_slot(uint8_t slot)
+{
+  m4g_bridge_ctx_reset_slot(&s_default_ctx, slot);
+}
+
+bool m4g_bridge_type_text(const char *text, m4g_bridge_output_done_cb_t done, void *arg)
+{
+  return m4g_bridge_ctx_type_text(&s_default_ctx, text, done, arg);
+}
+
+void m4g_bridge_set_charachorder_status(bool detected, bool both_halves_connected)
+{
+  m4g_bridge_ctx_set_charachorder_status(&s_default_ctx, detected, both_halves_connected);
+}
+
+void m4g_bridge_set_mouse_layout(uint8_t slot, const m4g_hid_mouse_layout_t *layout)
+{
+  m4g_bridge_ctx_set_mouse_layout(&s_default_ctx, slot, layout);
+}
+
+void m4g_bridge_drain_events(void)
+{
+  m4g_bridge_ctx_drain_events(&s_default_ctx);
+}
+
+bool m4g_bridge_get_last_keyboard(uint8_t out[8])
+{
+  return m4g_bridge_ctx_get_last_keyboard(&s_default_ctx, out);
+}
+
+bool m4g_bridge_get_last_mouse(uint8_t out[M4G_BRIDGE_MOUSE_REPORT_LEN])
+{
+  return m4g_bridge_ctx_get_last_mouse(&s_default_ctx, out);
+}
+
+void m4g_bridge_get_stats(m4g_bridge_stats_t *out)
+{
+  m4g_bridge_ctx_get_stats(&s_default_ctx, out);
 }
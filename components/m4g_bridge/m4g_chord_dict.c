@@ -0,0 +1,122 @@
+#include "m4g_chord_dict.h"
+#include "m4g_logging.h"
+#include <string.h>
+#include "esp_partition.h"
+#include "sdkconfig.h"
+
+static const char *DICT_TAG = "M4G-CHORDS";
+
+static const uint8_t *s_image = NULL; // Start of the mapped partition
+static esp_partition_mmap_handle_t s_mmap_handle;
+static const m4g_chord_dict_header_t *s_header = NULL;
+static const m4g_chord_dict_entry_t *s_slots = NULL;
+static const m4g_chord_dict_output_t *s_outputs = NULL;
+
+// FNV-1a with the seed folded into the basis, finished with the murmur3 mixer so
+// the low bits used for the modulo are well spread
+uint32_t m4g_chord_dict_hash(const uint8_t key[M4G_CHORD_DICT_KEY_LEN], uint32_t seed)
+{
+  uint32_t h = 2166136261u ^ seed;
+  for (size_t i = 0; i < M4G_CHORD_DICT_KEY_LEN; ++i)
+  {
+    h ^= key[i];
+    h *= 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+  return h;
+}
+
+// Check the header against the partition before trusting any offset in it
+static bool chord_dict_validate(const m4g_chord_dict_header_t *hdr, size_t partition_size)
+{
+  if (hdr->magic != M4G_CHORD_DICT_MAGIC || hdr->version != M4G_CHORD_DICT_VERSION ||
+      hdr->max_keys != M4G_CHORD_DICT_MAX_KEYS)
+    return false;
+  if (hdr->image_size > partition_size || hdr->bucket_count == 0 || hdr->slot_count == 0 ||
+      hdr->slot_count < hdr->entry_count)
+    return false;
+
+  uint64_t buckets_end = (uint64_t)hdr->buckets_offset + (uint64_t)hdr->bucket_count * sizeof(uint16_t);
+  uint64_t slots_end = (uint64_t)hdr->slots_offset + (uint64_t)hdr->slot_count * sizeof(m4g_chord_dict_entry_t);
+  uint64_t outputs_end = (uint64_t)hdr->outputs_offset + (uint64_t)hdr->output_count * sizeof(m4g_chord_dict_output_t);
+  return hdr->buckets_offset >= sizeof(*hdr) && buckets_end <= hdr->slots_offset &&
+         slots_end <= hdr->outputs_offset && outputs_end <= hdr->image_size;
+}
+
+esp_err_t m4g_chord_dict_init(void)
+{
+  if (s_header)
+    return ESP_OK;
+
+  const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                         CONFIG_M4G_LOCAL_CHORDS_PARTITION_LABEL);
+  if (!part)
+  {
+    LOG_AND_SAVE(true, I, DICT_TAG, "No '%s' partition - local chords disabled", CONFIG_M4G_LOCAL_CHORDS_PARTITION_LABEL);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  const void *ptr = NULL;
+  esp_err_t err = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &s_mmap_handle);
+  if (err != ESP_OK)
+  {
+    LOG_AND_SAVE(true, E, DICT_TAG, "Mapping '%s' failed: %s", part->label, esp_err_to_name(err));
+    return err;
+  }
+
+  const m4g_chord_dict_header_t *hdr = (const m4g_chord_dict_header_t *)ptr;
+  if (part->size < sizeof(*hdr) || !chord_dict_validate(hdr, part->size))
+  {
+    LOG_AND_SAVE(true, I, DICT_TAG, "Partition '%s' holds no chord dictionary", part->label);
+    esp_partition_munmap(s_mmap_handle);
+    return ESP_ERR_INVALID_VERSION;
+  }
+
+  s_image = (const uint8_t *)ptr;
+  s_slots = (const m4g_chord_dict_entry_t *)(s_image + hdr->slots_offset);
+  s_outputs = (const m4g_chord_dict_output_t *)(s_image + hdr->outputs_offset);
+  s_header = hdr;
+
+  LOG_AND_SAVE(true, I, DICT_TAG, "Chord dictionary mapped: %u chords, %u slots, %u bytes",
+               (unsigned)hdr->entry_count, (unsigned)hdr->slot_count, (unsigned)hdr->image_size);
+  return ESP_OK;
+}
+
+bool m4g_chord_dict_ready(void)
+{
+  return s_header != NULL;
+}
+
+size_t m4g_chord_dict_size(void)
+{
+  return s_header ? s_header->entry_count : 0;
+}
+
+const m4g_chord_dict_output_t *m4g_chord_dict_lookup(const uint8_t *keys, size_t n_keys, uint8_t modifiers,
+                                                     size_t *out_len)
+{
+  if (!s_header || n_keys == 0 || n_keys > M4G_CHORD_DICT_MAX_KEYS)
+    return NULL;
+
+  uint8_t key[M4G_CHORD_DICT_KEY_LEN] = {0};
+  memcpy(key, keys, n_keys);
+  key[M4G_CHORD_DICT_MAX_KEYS] = modifiers;
+
+  uint32_t bucket = m4g_chord_dict_hash(key, s_header->seed) % s_header->bucket_count;
+  uint16_t displacement;
+  memcpy(&displacement, s_image + s_header->buckets_offset + bucket * sizeof(uint16_t), sizeof(displacement));
+
+  uint32_t slot = m4g_chord_dict_hash(key, s_header->seed + displacement + 1u) % s_header->slot_count;
+  const m4g_chord_dict_entry_t *entry = &s_slots[slot];
+  if (memcmp(entry->keys, key, M4G_CHORD_DICT_MAX_KEYS) != 0 || entry->modifiers != modifiers)
+    return NULL;
+  if ((uint64_t)entry->output_index + entry->output_len > s_header->output_count)
+    return NULL;
+
+  *out_len = entry->output_len;
+  return &s_outputs[entry->output_index];
+}
@@ -0,0 +1,283 @@
+#include "m4g_hid_mouse.h"
+#include <string.h>
+
+#define HID_MAX_REPORTS 8       // Report IDs tracked per descriptor
+#define HID_MAX_USAGES 16       // Local usages remembered for one main item
+#define HID_MAX_GLOBAL_STACK 4  // Push/Pop depth
+#define HID_MAX_COLLECTIONS 8
+
+#define HID_PAGE_DESKTOP 0x01
+#define HID_PAGE_BUTTON 0x09
+#define HID_PAGE_CONSUMER 0x0C
+#define HID_USAGE(page, id) (((uint32_t)(page) << 16) | (id))
+#define HID_USAGE_POINTER HID_USAGE(HID_PAGE_DESKTOP, 0x01)
+#define HID_USAGE_MOUSE HID_USAGE(HID_PAGE_DESKTOP, 0x02)
+#define HID_USAGE_X HID_USAGE(HID_PAGE_DESKTOP, 0x30)
+#define HID_USAGE_Y HID_USAGE(HID_PAGE_DESKTOP, 0x31)
+#define HID_USAGE_WHEEL HID_USAGE(HID_PAGE_DESKTOP, 0x38)
+#define HID_USAGE_AC_PAN HID_USAGE(HID_PAGE_CONSUMER, 0x238)
+
+#define HID_INPUT_CONSTANT 0x01
+#define HID_INPUT_VARIABLE 0x02
+#define HID_INPUT_RELATIVE 0x04
+
+typedef struct
+{
+  uint16_t usage_page;
+  uint8_t report_id;
+  uint8_t report_size;
+  uint16_t report_count;
+} hid_globals_t;
+
+// Input bits seen so far for one Report ID, and the mouse fields among them
+typedef struct
+{
+  uint16_t bits;
+  m4g_hid_mouse_layout_t layout;
+} hid_report_t;
+
+typedef struct
+{
+  hid_report_t reports[HID_MAX_REPORTS];
+  size_t n_reports;
+  uint32_t usages[HID_MAX_USAGES];
+  size_t n_usages;
+  uint32_t usage_min;
+  uint32_t usage_max;
+  bool have_range;
+  bool collection_mouse[HID_MAX_COLLECTIONS];
+  size_t depth;
+} hid_parser_t;
+
+static hid_report_t *hid_report(hid_parser_t *p, uint8_t report_id)
+{
+  for (size_t i = 0; i < p->n_reports; ++i)
+  {
+    if (p->reports[i].layout.report_id == report_id)
+      return &p->reports[i];
+  }
+  if (p->n_reports == HID_MAX_REPORTS)
+    return NULL;
+  hid_report_t *r = &p->reports[p->n_reports++];
+  memset(r, 0, sizeof(*r));
+  r->layout.report_id = report_id;
+  return r;
+}
+
+// Usage of the i-th field of a main item, with the page filled in for short usages
+static uint32_t hid_field_usage(const hid_parser_t *p, const hid_globals_t *g, size_t i)
+{
+  uint32_t usage = 0;
+  if (p->n_usages > 0)
+    usage = p->usages[i < p->n_usages ? i : p->n_usages - 1];
+  else if (p->have_range)
+    usage = p->usage_min + i <= p->usage_max ? p->usage_min + (uint32_t)i : p->usage_max;
+  return usage > 0xFFFF ? usage : HID_USAGE(g->usage_page, usage);
+}
+
+static bool hid_in_mouse(const hid_parser_t *p)
+{
+  for (size_t i = 0; i < p->depth && i < HID_MAX_COLLECTIONS; ++i)
+  {
+    if (p->collection_mouse[i])
+      return true;
+  }
+  return false;
+}
+
+static void hid_take_field(m4g_hid_field_t *field, uint16_t offset, uint8_t bits)
+{
+  if (field->bits == 0)
+  {
+    field->offset = offset;
+    field->bits = bits;
+  }
+}
+
+static void hid_input(hid_parser_t *p, const hid_globals_t *g, uint32_t flags)
+{
+  hid_report_t *r = hid_report(p, g->report_id);
+  if (!r)
+    return;
+  uint16_t offset = r->bits;
+  r->bits = (uint16_t)(r->bits + g->report_size * g->report_count);
+  if ((flags & (HID_INPUT_CONSTANT | HID_INPUT_VARIABLE)) != HID_INPUT_VARIABLE || !hid_in_mouse(p) ||
+      g->report_size == 0 || g->report_size > 32)
+    return;
+
+  m4g_hid_mouse_layout_t *layout = &r->layout;
+  bool relative = (flags & HID_INPUT_RELATIVE) != 0;
+  for (size_t i = 0; i < g->report_count; ++i)
+  {
+    uint16_t field_offset = (uint16_t)(offset + i * g->report_size);
+    uint32_t usage = hid_field_usage(p, g, i);
+    if ((usage >> 16) == HID_PAGE_BUTTON && g->report_size == 1)
+    {
+      // Buttons count as long as they continue the run that started first
+      if (layout->buttons.bits == 0)
+        hid_take_field(&layout->buttons, field_offset, 1);
+      else if (layout->buttons.offset + layout->buttons.bits == field_offset && layout->buttons.bits < 8)
+        ++layout->buttons.bits;
+    }
+    else if (relative && usage == HID_USAGE_X)
+      hid_take_field(&layout->x, field_offset, g->report_size);
+    else if (relative && usage == HID_USAGE_Y)
+      hid_take_field(&layout->y, field_offset, g->report_size);
+    else if (relative && usage == HID_USAGE_WHEEL)
+      hid_take_field(&layout->wheel, field_offset, g->report_size);
+    else if (relative && usage == HID_USAGE_AC_PAN)
+      hid_take_field(&layout->pan, field_offset, g->report_size);
+  }
+}
+
+bool m4g_hid_mouse_parse(const uint8_t *desc, size_t len, m4g_hid_mouse_layout_t *out)
+{
+  if (!desc || !out)
+    return false;
+
+  hid_parser_t p;
+  memset(&p, 0, sizeof(p));
+  hid_globals_t globals = {0};
+  hid_globals_t stack[HID_MAX_GLOBAL_STACK];
+  size_t stack_depth = 0;
+
+  size_t pos = 0;
+  while (pos < len)
+  {
+    uint8_t prefix = desc[pos++];
+    if (prefix == 0xFE)
+    {
+      // Long item: data size, tag, data (none are defined)
+      if (pos >= len)
+        break;
+      pos += 1 + (size_t)desc[pos] + 1;
+      continue;
+    }
+
+    size_t size = (prefix & 0x03) == 3 ? 4 : (prefix & 0x03);
+    if (pos + size > len)
+      break;
+    uint32_t value = 0;
+    for (size_t i = 0; i < size; ++i)
+      value |= (uint32_t)desc[pos + i] << (8 * i);
+    pos += size;
+
+    uint8_t type = (prefix >> 2) & 0x03;
+    uint8_t tag = prefix >> 4;
+    if (type == 0) // Main (Output and Feature items add no input bits)
+    {
+      if (tag == 0x8) // Input
+        hid_input(&p, &globals, value);
+      else if (tag == 0xA) // Collection
+      {
+        if (p.depth < HID_MAX_COLLECTIONS)
+        {
+          uint32_t usage = hid_field_usage(&p, &globals, 0);
+          p.collection_mouse[p.depth] = usage == HID_USAGE_MOUSE || usage == HID_USAGE_POINTER;
+        }
+        ++p.depth;
+      }
+      else if (tag == 0xC && p.depth > 0) // End Collection
+        --p.depth;
+      p.n_usages = 0;
+      p.have_range = false;
+    }
+    else if (type == 1) // Global
+    {
+      switch (tag)
+      {
+      case 0x0:
+        globals.usage_page = (uint16_t)value;
+        break;
+      case 0x7:
+        globals.report_size = (uint8_t)value;
+        break;
+      case 0x8:
+        globals.report_id = (uint8_t)value;
+        break;
+      case 0x9:
+        globals.report_count = (uint16_t)value;
+        break;
+      case 0xA: // Push
+        if (stack_depth < HID_MAX_GLOBAL_STACK)
+          stack[stack_depth++] = globals;
+        break;
+      case 0xB: // Pop
+        if (stack_depth > 0)
+          globals = stack[--stack_depth];
+        break;
+      default:
+        break;
+      }
+    }
+    else if (type == 2) // Local
+    {
+      // Four-byte usages carry their own page
+      uint32_t usage = size == 4 ? value : value & 0xFFFF;
+      if (tag == 0x0 && p.n_usages < HID_MAX_USAGES)
+        p.usages[p.n_usages++] = usage;
+      else if (tag == 0x1)
+      {
+        p.usage_min = usage;
+        p.have_range = true;
+      }
+      else if (tag == 0x2)
+        p.usage_max = usage;
+    }
+  }
+
+  for (size_t i = 0; i < p.n_reports; ++i)
+  {
+    const m4g_hid_mouse_layout_t *layout = &p.reports[i].layout;
+    if (layout->x.bits != 0 && layout->y.bits != 0)
+    {
+      *out = *layout;
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint32_t hid_read_bits(const uint8_t *data, const m4g_hid_field_t *field)
+{
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < field->bits; ++i)
+  {
+    uint32_t bit = (uint32_t)field->offset + i;
+    value |= (uint32_t)((data[bit >> 3] >> (bit & 7)) & 1) << i;
+  }
+  return value;
+}
+
+static int32_t hid_read_signed(const uint8_t *data, size_t len, const m4g_hid_field_t *field)
+{
+  if (field->bits == 0 || field->offset + field->bits > len * 8)
+    return 0;
+  uint32_t value = hid_read_bits(data, field);
+  if (field->bits < 32 && (value & (1u << (field->bits - 1))))
+    value |= ~0u << field->bits;
+  return (int32_t)value;
+}
+
+bool m4g_hid_mouse_read(const m4g_hid_mouse_layout_t *layout, const uint8_t *report, size_t len,
+                        m4g_hid_mouse_state_t *out)
+{
+  if (layout->report_id != 0)
+  {
+    if (len == 0 || report[0] != layout->report_id)
+      return false;
+    ++report;
+    --len;
+  }
+  if (layout->x.offset + layout->x.bits > len * 8 || layout->y.offset + layout->y.bits > len * 8)
+    return false;
+
+  out->buttons = 0;
+  if (layout->buttons.bits != 0 && layout->buttons.offset + layout->buttons.bits <= len * 8)
+    out->buttons = (uint8_t)hid_read_bits(report, &layout->buttons);
+  out->x = hid_read_signed(report, len, &layout->x);
+  out->y = hid_read_signed(report, len, &layout->y);
+  out->wheel = hid_read_signed(report, len, &layout->wheel);
+  out->pan = hid_read_signed(report, len, &layout->pan);
+  return true;
+}
@@ -7,7 +7,8 @@
 // RIGHT side stubs - these functions are not available without bridge/ble
 static inline bool m4g_ble_is_connected(void) { return false; }
 static inline bool m4g_ble_notifications_enabled(void) { return false; }
-static inline bool m4g_ble_send_keyboard_report(const uint8_t *report) { (void)report; return false; }
+typedef enum { M4G_BLE_SEND_OK = 0, M4G_BLE_SEND_FAILED = 2 } m4g_ble_send_result_t;
+static inline m4g_ble_send_result_t m4g_ble_send_keyboard_report(const uint8_t *report) { (void)report; return M4G_BLE_SEND_FAILED; }
 static inline bool m4g_bridge_get_last_keyboard(uint8_t *out) { (void)out; return false; }
 #endif
 #include "m4g_usb.h"
@@ -101,7 +102,7 @@ esp_err_t m4g_diag_run_startup_checks(void)
 
   // 2. BLE notification dry run (expected to fail if not connected yet)
   uint8_t empty_report[8] = {0};
-  bool sent = m4g_ble_send_keyboard_report(empty_report);
+  bool sent = m4g_ble_send_keyboard_report(empty_report) == M4G_BLE_SEND_OK;
   LOG_AND_SAVE(ENABLE_DEBUG_BLE_LOGGING, I, DIAG_TAG, "BLE test send (no connection yet is fine): %s", sent ? "delivered" : "not sent");
 
   // 3. Bridge initial state
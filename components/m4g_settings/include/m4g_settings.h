@@ -32,20 +32,40 @@ extern "C"
     M4G_SETTING_CHORD_TIMEOUT_MS = 0x02,               /*!< Single-key timeout before emit (ms) */
     M4G_SETTING_CHORD_PRESS_DEVIATION_MAX_MS = 0x03,   /*!< Max press deviation for chords (ms) */
     M4G_SETTING_CHORD_RELEASE_DEVIATION_MAX_MS = 0x04, /*!< Max release deviation for chords (ms) */
+    M4G_SETTING_CHORD_GRACE_PERCENTILE = 0x05,         /*!< Output latency percentile the learned window covers (%) */
+    M4G_SETTING_CHORD_GRACE_MARGIN_MS = 0x06,          /*!< Margin added to the learned output latency (ms) */
 
     // Key Repeat Settings (0x10-0x1F)
-    M4G_SETTING_KEY_REPEAT_ENABLED = 0x10,  /*!< Enable/disable key repeat (bool) */
-    M4G_SETTING_KEY_REPEAT_DELAY_MS = 0x11, /*!< Initial delay before repeat starts (ms) */
-    M4G_SETTING_KEY_REPEAT_RATE_MS = 0x12,  /*!< Time between repeats (ms) */
+    M4G_SETTING_KEY_REPEAT_ENABLED = 0x10,        /*!< Enable/disable key repeat (bool) */
+    M4G_SETTING_KEY_REPEAT_DELAY_MS = 0x11,       /*!< Initial delay before repeat starts (ms) */
+    M4G_SETTING_KEY_REPEAT_RATE_MS = 0x12,        /*!< Time between repeats (ms) */
+    M4G_SETTING_KEY_REPEAT_HOST_TYPEMATIC = 0x13, /*!< Hold keys pressed and let the host repeat (bool) */
 
     // Feature Toggles (0x20-0x2F)
     M4G_SETTING_RAW_MODE_ENABLED = 0x20,              /*!< Bypass chord detection (bool) */
     M4G_SETTING_DUPLICATE_SUPPRESSION_ENABLED = 0x21, /*!< Suppress duplicate reports (bool) */
     M4G_SETTING_DEVIATION_TRACKING_ENABLED = 0x22,    /*!< Track chord quality metrics (bool) */
+    M4G_SETTING_SPECULATIVE_PRESS_ENABLED = 0x23,     /*!< Send a chord's first key before it resolves (bool) */
+    M4G_SETTING_ADAPTIVE_GRACE_ENABLED = 0x24,        /*!< Learn the chord output window from observed latency (bool) */
+
+    // Mouse Settings (0x30-0x3F)
+    M4G_SETTING_MOUSE_ACCEL_CURVE = 0x30, /*!< Pointer acceleration curve (m4g_mouse_accel_curve_t) */
 
     M4G_SETTING_MAX /*!< Sentinel value for validation */
   } m4g_setting_id_t;
 
+  /**
+   * @brief Pointer acceleration curves (values of M4G_SETTING_MOUSE_ACCEL_CURVE)
+   */
+  typedef enum
+  {
+    M4G_MOUSE_ACCEL_FLAT = 0, /*!< Output follows the device 1:1 */
+    M4G_MOUSE_ACCEL_LOW,      /*!< Up to 2x for fast motion */
+    M4G_MOUSE_ACCEL_MEDIUM,   /*!< Slow motion damped, up to 3x for fast motion */
+    M4G_MOUSE_ACCEL_HIGH,     /*!< Slow motion damped, up to 5x for fast motion */
+    M4G_MOUSE_ACCEL_CURVE_COUNT
+  } m4g_mouse_accel_curve_t;
+
   /**
    * @brief Setting metadata for validation and UI
    */
@@ -126,6 +146,41 @@ extern "C"
    */
   esp_err_t m4g_settings_reset_to_defaults(bool erase_nvs);
 
+  /**
+   * @brief Load a binary blob stored alongside the settings
+   *
+   * For state other components learn at runtime (not user settings). Blobs live
+   * in the settings NVS namespace, so m4g_settings_reset_to_defaults(true)
+   * erases them too.
+   *
+   * @param key NVS key (at most 15 characters)
+   * @param data Buffer to fill
+   * @param len Expected blob size; a stored blob of any other size is rejected
+   * @return
+   *      - ESP_OK: Success
+   *      - ESP_ERR_INVALID_ARG: NULL key or data
+   *      - ESP_ERR_NOT_FOUND: No blob stored under key
+   *      - ESP_ERR_INVALID_SIZE: Stored blob has a different size
+   *      - ESP_ERR_NOT_SUPPORTED: NVS persistence disabled
+   */
+  esp_err_t m4g_settings_load_blob(const char *key, void *data, size_t len);
+
+  /**
+   * @brief Store and commit a binary blob alongside the settings
+   *
+   * Each call is an NVS write; callers should batch updates.
+   *
+   * @param key NVS key (at most 15 characters)
+   * @param data Blob contents
+   * @param len Blob size in bytes
+   * @return
+   *      - ESP_OK: Success
+   *      - ESP_ERR_INVALID_ARG: NULL key or data
+   *      - ESP_ERR_NOT_SUPPORTED: NVS persistence disabled
+   *      - ESP_ERR_NVS_*: NVS operation failed
+   */
+  esp_err_t m4g_settings_save_blob(const char *key, const void *data, size_t len);
+
   /**
    * @brief Get setting metadata for UI/validation
    *
@@ -191,6 +246,26 @@ extern "C"
     return value;
   }
 
+  /**
+   * @brief Get the output latency percentile the adaptive chord window covers
+   */
+  static inline uint32_t m4g_settings_get_chord_grace_percentile(void)
+  {
+    uint32_t value = CONFIG_M4G_CHORD_GRACE_PERCENTILE_DEFAULT;
+    m4g_settings_get(M4G_SETTING_CHORD_GRACE_PERCENTILE, &value);
+    return value;
+  }
+
+  /**
+   * @brief Get the margin added to the learned chord output latency in milliseconds
+   */
+  static inline uint32_t m4g_settings_get_chord_grace_margin_ms(void)
+  {
+    uint32_t value = CONFIG_M4G_CHORD_GRACE_MARGIN_MS_DEFAULT;
+    m4g_settings_get(M4G_SETTING_CHORD_GRACE_MARGIN_MS, &value);
+    return value;
+  }
+
   /**
    * @brief Check if key repeat is enabled
    */
@@ -224,6 +299,19 @@ extern "C"
     return value;
   }
 
+  /**
+   * @brief Check if key repeat is left to the host's typematic repeat
+   */
+  static inline bool m4g_settings_is_host_typematic_enabled(void)
+  {
+    uint32_t value = 0;
+#ifdef CONFIG_M4G_KEY_REPEAT_HOST_TYPEMATIC_DEFAULT
+    value = CONFIG_M4G_KEY_REPEAT_HOST_TYPEMATIC_DEFAULT;
+#endif
+    m4g_settings_get(M4G_SETTING_KEY_REPEAT_HOST_TYPEMATIC, &value);
+    return (bool)value;
+  }
+
   /**
    * @brief Check if raw mode is enabled
    */
@@ -260,6 +348,42 @@ extern "C"
     return (bool)value;
   }
 
+  /**
+   * @brief Check if speculative first-key press is enabled
+   */
+  static inline bool m4g_settings_is_speculative_press_enabled(void)
+  {
+    uint32_t value = 0;
+#ifdef CONFIG_M4G_SPECULATIVE_PRESS_DEFAULT
+    value = CONFIG_M4G_SPECULATIVE_PRESS_DEFAULT;
+#endif
+    m4g_settings_get(M4G_SETTING_SPECULATIVE_PRESS_ENABLED, &value);
+    return (bool)value;
+  }
+
+  /**
+   * @brief Check if the chord output window is learned from observed latency
+   */
+  static inline bool m4g_settings_is_adaptive_grace_enabled(void)
+  {
+    uint32_t value = 0;
+#ifdef CONFIG_M4G_ADAPTIVE_GRACE_DEFAULT
+    value = CONFIG_M4G_ADAPTIVE_GRACE_DEFAULT;
+#endif
+    m4g_settings_get(M4G_SETTING_ADAPTIVE_GRACE_ENABLED, &value);
+    return (bool)value;
+  }
+
+  /**
+   * @brief Get the pointer acceleration curve
+   */
+  static inline m4g_mouse_accel_curve_t m4g_settings_get_mouse_accel_curve(void)
+  {
+    uint32_t value = CONFIG_M4G_MOUSE_ACCEL_CURVE_DEFAULT;
+    m4g_settings_get(M4G_SETTING_MOUSE_ACCEL_CURVE, &value);
+    return (m4g_mouse_accel_curve_t)value;
+  }
+
 #ifdef __cplusplus
 }
 #endif
@@ -54,6 +54,22 @@ static const m4g_setting_metadata_t s_metadata[] = {
      .max_value = 300,
      .default_value = CONFIG_M4G_CHORD_RELEASE_DEVIATION_MAX_MS_DEFAULT,
      .unit = "ms"},
+    {.id = M4G_SETTING_CHORD_GRACE_PERCENTILE,
+     .name = "Grace Percentile",
+     .description = "Share of chord outputs the learned window must cover",
+     .is_boolean = false,
+     .min_value = 50,
+     .max_value = 100,
+     .default_value = CONFIG_M4G_CHORD_GRACE_PERCENTILE_DEFAULT,
+     .unit = "%"},
+    {.id = M4G_SETTING_CHORD_GRACE_MARGIN_MS,
+     .name = "Grace Margin",
+     .description = "Margin added to the learned output latency",
+     .is_boolean = false,
+     .min_value = 0,
+     .max_value = 500,
+     .default_value = CONFIG_M4G_CHORD_GRACE_MARGIN_MS_DEFAULT,
+     .unit = "ms"},
 
     // Key Repeat Settings
     {
@@ -85,6 +101,19 @@ static const m4g_setting_metadata_t s_metadata[] = {
      .max_value = 200,
      .default_value = CONFIG_M4G_KEY_REPEAT_RATE_MS_DEFAULT,
      .unit = "ms"},
+    {
+        .id = M4G_SETTING_KEY_REPEAT_HOST_TYPEMATIC,
+        .name = "Host Typematic",
+        .description = "Hold keys pressed and let the host repeat",
+        .is_boolean = true,
+        .min_value = 0,
+        .max_value = 1,
+#ifdef CONFIG_M4G_KEY_REPEAT_HOST_TYPEMATIC_DEFAULT
+        .default_value = CONFIG_M4G_KEY_REPEAT_HOST_TYPEMATIC_DEFAULT,
+#else
+        .default_value = 0,
+#endif
+        .unit = ""},
 
     // Feature Toggles
     {
@@ -119,6 +148,40 @@ static const m4g_setting_metadata_t s_metadata[] = {
 #else
      .default_value = 0,
 #endif
+     .unit = ""},
+    {.id = M4G_SETTING_SPECULATIVE_PRESS_ENABLED,
+     .name = "Speculative Press",
+     .description = "Send a chord's first key before it resolves",
+     .is_boolean = true,
+     .min_value = 0,
+     .max_value = 1,
+#ifdef CONFIG_M4G_SPECULATIVE_PRESS_DEFAULT
+     .default_value = CONFIG_M4G_SPECULATIVE_PRESS_DEFAULT,
+#else
+     .default_value = 0,
+#endif
+     .unit = ""},
+    {.id = M4G_SETTING_ADAPTIVE_GRACE_ENABLED,
+     .name = "Adaptive Grace",
+     .description = "Learn the chord output window from observed latency",
+     .is_boolean = true,
+     .min_value = 0,
+     .max_value = 1,
+#ifdef CONFIG_M4G_ADAPTIVE_GRACE_DEFAULT
+     .default_value = CONFIG_M4G_ADAPTIVE_GRACE_DEFAULT,
+#else
+     .default_value = 0,
+#endif
+     .unit = ""},
+
+    // Mouse Settings
+    {.id = M4G_SETTING_MOUSE_ACCEL_CURVE,
+     .name = "Mouse Acceleration Curve",
+     .description = "Pointer acceleration: 0 flat, 1 low, 2 medium, 3 high",
+     .is_boolean = false,
+     .min_value = 0,
+     .max_value = M4G_MOUSE_ACCEL_CURVE_COUNT - 1,
+     .default_value = CONFIG_M4G_MOUSE_ACCEL_CURVE_DEFAULT,
      .unit = ""}};
 
 static const size_t s_metadata_count = sizeof(s_metadata) / sizeof(s_metadata[0]);
@@ -378,6 +441,79 @@ esp_err_t m4g_settings_reset_to_defaults(bool erase_nvs)
   return ESP_OK;
 }
 
+esp_err_t m4g_settings_load_blob(const char *key, void *data, size_t len)
+{
+  if (key == NULL || data == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+#ifdef CONFIG_M4G_SETTINGS_ENABLE_NVS_PERSISTENCE
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+  if (err != ESP_OK)
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  size_t stored_len = 0;
+  err = nvs_get_blob(handle, key, NULL, &stored_len);
+  if (err == ESP_OK && stored_len != len)
+  {
+    ESP_LOGW(TAG, "Blob '%s' has size %u, expected %u - ignoring", key, (unsigned int)stored_len, (unsigned int)len);
+    err = ESP_ERR_INVALID_SIZE;
+  }
+  else if (err == ESP_OK)
+  {
+    err = nvs_get_blob(handle, key, data, &stored_len);
+  }
+  else if (err == ESP_ERR_NVS_NOT_FOUND)
+  {
+    err = ESP_ERR_NOT_FOUND;
+  }
+
+  nvs_close(handle);
+  return err;
+#else
+  (void)len;
+  return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t m4g_settings_save_blob(const char *key, const void *data, size_t len)
+{
+  if (key == NULL || data == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+#ifdef CONFIG_M4G_SETTINGS_ENABLE_NVS_PERSISTENCE
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  err = nvs_set_blob(handle, key, data, len);
+  if (err == ESP_OK)
+  {
+    err = nvs_commit(handle);
+  }
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to save blob '%s': %s", key, esp_err_to_name(err));
+  }
+
+  nvs_close(handle);
+  return err;
+#else
+  (void)len;
+  return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 const m4g_setting_metadata_t *m4g_settings_get_metadata(m4g_setting_id_t setting_id)
 {
   for (size_t i = 0; i < s_metadata_count; i++)
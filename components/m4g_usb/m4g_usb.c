@@ -6,7 +6,7 @@
 #include "m4g_bridge.h" // Bridge for translation
 #else
 // RIGHT side stubs - these functions/constants are not available without bridge/ble
-#define M4G_BRIDGE_MAX_SLOTS 2
+#define M4G_BRIDGE_MAX_SLOTS CONFIG_M4G_BRIDGE_MAX_SLOTS
 #define M4G_INVALID_SLOT 0xFF
 static inline void m4g_bridge_set_charachorder_status(bool detected, bool both_halves) { (void)detected; (void)both_halves; }
 static inline void m4g_bridge_reset_slot(uint8_t slot) { (void)slot; }
@@ -95,9 +95,15 @@ typedef struct
   uint8_t consecutive_errors;
   TickType_t last_error_tick;
   bool is_charachorder;
+  uint16_t report_desc_len; // Report descriptor to read once the interface is up (0: none)
 } m4g_usb_hid_device_t;
 
+#ifdef CONFIG_M4G_SPLIT_ROLE_LEFT
+// The last bridge slot carries the RIGHT half (M4G_BRIDGE_REMOTE_SLOT)
+static m4g_usb_hid_device_t s_hid_devices[M4G_BRIDGE_MAX_SLOTS - 1];
+#else
 static m4g_usb_hid_device_t s_hid_devices[M4G_BRIDGE_MAX_SLOTS];
+#endif
 #define M4G_USB_MAX_HID_DEVICES (sizeof(s_hid_devices) / sizeof(s_hid_devices[0]))
 static uint8_t s_claimed_device_count = 0;
 static bool s_restart_needed = false;
@@ -121,6 +127,23 @@ static const char *transfer_status_to_str(usb_transfer_status_t status)
   }
 }
 
+// Length of the report descriptor announced by the HID descriptor that follows an
+// interface descriptor in the configuration, 0 if there is none
+static uint16_t hid_report_descriptor_length(const usb_config_desc_t *cfg, const usb_intf_desc_t *intf)
+{
+  const uint8_t *p = (const uint8_t *)intf + intf->bLength;
+  const uint8_t *end = (const uint8_t *)cfg + cfg->wTotalLength;
+  while (p + 2 <= end && p[0] != 0 && p[1] != USB_B_DESCRIPTOR_TYPE_INTERFACE)
+  {
+    // bLength, bDescriptorType 0x21, bcdHID, bCountryCode, bNumDescriptors, then
+    // the first class descriptor's type and length
+    if (p[1] == 0x21 && p[0] >= 9 && p + 9 <= end && p[6] == 0x22)
+      return (uint16_t)(p[7] | (p[8] << 8));
+    p += p[0];
+  }
+  return 0;
+}
+
 static int allocate_hid_slot(void)
 {
   for (int i = 0; i < (int)M4G_USB_MAX_HID_DEVICES; ++i)
@@ -283,10 +306,7 @@ static void cleanup_all_devices(void)
         if (!already_closed)
         {
           usb_host_device_close(s_client, s_hid_devices[i].dev_hdl);
-          if (closed_count < 2)
-          {
-            closed_handles[closed_count++] = s_hid_devices[i].dev_hdl;
-          }
+          closed_handles[closed_count++] = s_hid_devices[i].dev_hdl;
         }
       }
       memset(&s_hid_devices[i], 0, sizeof(s_hid_devices[i]));
@@ -509,6 +529,8 @@ static void enumerate_device(uint8_t dev_addr)
         dev->vid = dev_desc->idVendor;
         dev->pid = dev_desc->idProduct;
         dev->is_charachorder = s_seen_charachorder_hub && is_charachorder_device(dev->vid, dev->pid);
+        // CharaChorder halves keep the fixed mouse report the bridge assumes
+        dev->report_desc_len = dev->is_charachorder ? 0 : hid_report_descriptor_length(cfg, intf_desc);
 
         if (ENABLE_DEBUG_USB_LOGGING)
         {
@@ -806,6 +828,71 @@ static void hid_transfer_callback(usb_transfer_t *transfer)
   }
 }
 
+#ifndef CONFIG_M4G_SPLIT_ROLE_RIGHT
+#define M4G_USB_MAX_REPORT_DESC 512 // Longer report descriptors are read in part
+
+static void report_descriptor_callback(usb_transfer_t *transfer)
+{
+  m4g_usb_hid_device_t *dev = (m4g_usb_hid_device_t *)transfer->context;
+  // actual_num_bytes of a control transfer includes the setup packet
+  if (transfer->status == USB_TRANSFER_STATUS_COMPLETED && dev && dev->active &&
+      dev->dev_hdl == transfer->device_handle && dev->slot != M4G_INVALID_SLOT &&
+      transfer->actual_num_bytes > (int)sizeof(usb_setup_packet_t))
+  {
+    const uint8_t *desc = transfer->data_buffer + sizeof(usb_setup_packet_t);
+    size_t len = transfer->actual_num_bytes - sizeof(usb_setup_packet_t);
+    m4g_hid_mouse_layout_t layout;
+    if (m4g_hid_mouse_parse(desc, len, &layout))
+    {
+      m4g_bridge_set_mouse_layout(dev->slot, &layout);
+      LOG_AND_SAVE(ENABLE_DEBUG_USB_LOGGING, I, USB_TAG,
+                   "dev=%s mouse report: id=%u, %u buttons, %u-bit X/Y, wheel %u-bit, pan %u-bit",
+                   dev->device_name, layout.report_id, layout.buttons.bits, layout.x.bits, layout.wheel.bits,
+                   layout.pan.bits);
+    }
+  }
+  else if (transfer->status != USB_TRANSFER_STATUS_COMPLETED)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_USB_LOGGING, W, USB_TAG, "Report descriptor read failed: %s",
+                 transfer_status_to_str(transfer->status));
+  }
+  usb_host_transfer_free(transfer);
+}
+
+// Read the interface's report descriptor so the bridge decodes its mouse reports
+// (16-bit motion, wheel, pan) by their real layout instead of the boot one
+static void request_report_descriptor(m4g_usb_hid_device_t *dev)
+{
+  if (dev->report_desc_len == 0)
+    return;
+  uint16_t len = dev->report_desc_len < M4G_USB_MAX_REPORT_DESC ? dev->report_desc_len : M4G_USB_MAX_REPORT_DESC;
+  usb_transfer_t *t;
+  if (usb_host_transfer_alloc(sizeof(usb_setup_packet_t) + M4G_USB_MAX_REPORT_DESC, 0, &t) != ESP_OK)
+    return;
+  usb_setup_packet_t *setup = (usb_setup_packet_t *)t->data_buffer;
+  setup->bmRequestType = 0x81; // Device-to-Host, Standard, Interface
+  setup->bRequest = 0x06;      // GET_DESCRIPTOR
+  setup->wValue = 0x2200;      // Report descriptor, index 0
+  setup->wIndex = dev->intf_num;
+  setup->wLength = len;
+
+  t->device_handle = dev->dev_hdl;
+  t->bEndpointAddress = 0;
+  t->callback = report_descriptor_callback;
+  t->context = dev;
+  t->num_bytes = sizeof(usb_setup_packet_t) + len;
+  t->timeout_ms = 1000;
+
+  esp_err_t err = usb_host_transfer_submit_control(s_client, t);
+  if (err != ESP_OK)
+  {
+    LOG_AND_SAVE(ENABLE_DEBUG_USB_LOGGING, W, USB_TAG, "Report descriptor request failed for dev=%s: %s",
+                 dev->device_name, esp_err_to_name(err));
+    usb_host_transfer_free(t);
+  }
+}
+#endif
+
 static void setup_hid_transfers(void)
 {
   LOG_AND_SAVE(ENABLE_DEBUG_USB_LOGGING, I, USB_TAG, "Setting up transfers for %d devices", s_active_hid_devices);
@@ -845,6 +932,9 @@ static void setup_hid_transfers(void)
       LOG_AND_SAVE(true, I, USB_TAG, 
                   "INT transfer started for dev=%s ep=0x%02X", 
                   dev->device_name, dev->ep_addr);
+#ifndef CONFIG_M4G_SPLIT_ROLE_RIGHT
+      request_report_descriptor(dev);
+#endif
       
       // CharaChorder has an OUT endpoint (0x04) - try sending wake-up/activation commands
       if (dev->is_charachorder)
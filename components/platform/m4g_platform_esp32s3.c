@@ -59,7 +59,7 @@ esp_err_t m4g_platform_init(void)
     return err;
   }
 
-  // Initialize bridge layer (registers callbacks with BLE)
+  // Initialize bridge layer (starts the bridge task that owns all chord/repeat state)
   if ((err = m4g_bridge_init()) != ESP_OK)
   {
     ESP_LOGE(TAG, "Bridge init failed: %s", esp_err_to_name(err));
@@ -67,7 +67,7 @@ esp_err_t m4g_platform_init(void)
   }
 
   // Initialize USB host last (starts enumeration, calls bridge directly)
-  // Note: USB component calls m4g_bridge_process_usb_report() directly,
+  // Note: USB component queues reports with m4g_bridge_process_usb_report(),
   // so we pass NULL for the optional notification callback
   if ((err = m4g_usb_init(NULL, NULL)) != ESP_OK)
   {
@@ -114,18 +114,9 @@ void app_main(void)
 
     for (;;)
     {
-        // Process key repeat with shorter delay for responsive repeat
-        vTaskDelay(pdMS_TO_TICKS(10)); // 10ms for responsive key repeat
-        m4g_bridge_process_key_repeat();
-
-        // Only do the following checks every 1 second
-        static TickType_t last_heartbeat = 0;
-        TickType_t now = xTaskGetTickCount();
-        if ((now - last_heartbeat) < pdMS_TO_TICKS(1000))
-        {
-            continue;
-        }
-        last_heartbeat = now;
+        // Key repeat runs off bridge timers, so this loop only does 1 Hz housekeeping
+        vTaskDelay(pdMS_TO_TICKS(1000));
+
         if (m4g_log_persistence_enabled())
         {
             m4g_log_flush();
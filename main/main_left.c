@@ -64,8 +64,11 @@ static void espnow_rx_cb(uint8_t slot, const uint8_t *report, size_t len, bool i
                      slot, len, is_charachorder);
     }
     
-    // Process through bridge (use slot 1 for right side to distinguish from left)
-    m4g_bridge_process_usb_report(1, report, len, is_charachorder);
+    // Queue for the bridge task on the ESP-NOW ring, in the slot the USB host leaves free for the right side
+    if (!m4g_bridge_submit_report(M4G_BRIDGE_SOURCE_ESPNOW, M4G_BRIDGE_REMOTE_SLOT, report, len, is_charachorder))
+    {
+        LOG_AND_SAVE(ENABLE_DEBUG_KEYPRESS_LOGGING, W, TAG, "Bridge ESP-NOW queue full - report dropped");
+    }
 }
 
 static void log_stack_watermarks(void)
@@ -193,18 +196,8 @@ void app_main(void)
 
     for (;;)
     {
-        // Process key repeat with shorter delay for responsive repeat
-        vTaskDelay(pdMS_TO_TICKS(10)); // 10ms for responsive key repeat
-        m4g_bridge_process_key_repeat();
-
-        // Only do the following checks every 1 second
-        static TickType_t last_heartbeat = 0;
-        TickType_t now = xTaskGetTickCount();
-        if ((now - last_heartbeat) < pdMS_TO_TICKS(1000))
-        {
-            continue;
-        }
-        last_heartbeat = now;
+        // Key repeat runs off bridge timers, so this loop only does 1 Hz housekeeping
+        vTaskDelay(pdMS_TO_TICKS(1000));
         
         if (m4g_log_persistence_enabled())
         {
@@ -0,0 +1,369 @@
+/**
+ * @file chord_bench.c
+ * @brief Per-report cost of the chord FSM for the bridge host build
+ *
+ * Feeds seeded CharaChorder workloads through a bridge instance
+ * (m4g_bridge_ctx_create) and measures the CPU time of every input report from
+ * submission until the bridge has drained it: the slot diff, the chord FSM and the
+ * keyboard output it produces. Timer work (chord deadlines, repeat cycles, paced
+ * output) runs between reports and is not counted. Time is read from the CPU's
+ * time-stamp counter where there is one, so the figures are cycles per report.
+ * Every workload is run several times and the round with the lowest mean is
+ * reported, which keeps other load on the machine out of the figures.
+ *
+ * Each workload's output report stream is hashed together with its virtual
+ * timestamps. A change to the FSM that keeps its behaviour keeps every hash.
+ */
+
+#include "m4g_ble.h"
+#include "m4g_bridge.h"
+#include "m4g_host.h"
+#include "m4g_settings.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define BENCH_CONN_INTERVAL_US 7500
+#define BENCH_KEY_UP 0x29 // Escape: arrow-mouse up in the host build
+
+typedef struct
+{
+  m4g_bridge_ctx_t *ctx;
+  int64_t now_us;
+  int64_t timer_due_us[M4G_BRIDGE_TIMER_COUNT]; // 0: stopped
+  uint32_t rng;
+  uint64_t hash; // FNV-1a over every report and its virtual timestamp
+  uint32_t reports_out;
+  uint64_t *cost; // Per input report
+  size_t n_cost;
+  size_t cap_cost;
+} bench_run_t;
+
+typedef struct
+{
+  const char *name;
+  bool chord_mode; // CharaChorder detected with both halves, so the FSM collects chords
+  void (*step)(bench_run_t *run);
+} bench_workload_t;
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_UNIT "cycles"
+static inline uint64_t bench_counter(void)
+{
+  return __rdtsc();
+}
+#else
+#define BENCH_UNIT "ns"
+static inline uint64_t bench_counter(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+static int64_t bench_now_us(void *user)
+{
+  return ((bench_run_t *)user)->now_us;
+}
+
+static void bench_set_timer(void *user, m4g_bridge_timer_t timer, int64_t due_us)
+{
+  ((bench_run_t *)user)->timer_due_us[timer] = due_us;
+}
+
+static void bench_hash(bench_run_t *run, uint8_t kind, const uint8_t *report, size_t len)
+{
+  uint64_t h = run->hash;
+  const uint8_t *t = (const uint8_t *)&run->now_us;
+  for (size_t i = 0; i < sizeof(run->now_us); ++i)
+    h = (h ^ t[i]) * 0x100000001B3ull;
+  h = (h ^ kind) * 0x100000001B3ull;
+  for (size_t i = 0; i < len; ++i)
+    h = (h ^ report[i]) * 0x100000001B3ull;
+  run->hash = h;
+  ++run->reports_out;
+}
+
+static m4g_bridge_send_result_t bench_send_keyboard(void *user, const uint8_t report[8])
+{
+  bench_hash(user, M4G_HOST_REPORT_KEYBOARD, report, 8);
+  return M4G_BRIDGE_SEND_OK;
+}
+
+static m4g_bridge_send_result_t bench_send_nkro(void *user, const uint8_t *report, size_t len)
+{
+  bench_hash(user, M4G_HOST_REPORT_NKRO, report, len);
+  return M4G_BRIDGE_SEND_OK;
+}
+
+static m4g_bridge_send_result_t bench_send_mouse(void *user, const uint8_t report[M4G_BRIDGE_MOUSE_REPORT_LEN])
+{
+  bench_hash(user, M4G_HOST_REPORT_MOUSE, report, M4G_BRIDGE_MOUSE_REPORT_LEN);
+  return M4G_BRIDGE_SEND_OK;
+}
+
+static bool bench_link_ready(void *user)
+{
+  (void)user;
+  return true;
+}
+
+static bool bench_report_notifications(void *user)
+{
+  (void)user;
+  return true;
+}
+
+static bool bench_boot_protocol(void *user)
+{
+  (void)user;
+  return false;
+}
+
+static uint32_t bench_conn_interval_us(void *user)
+{
+  (void)user;
+  return BENCH_CONN_INTERVAL_US;
+}
+
+static uint32_t bench_rand(bench_run_t *run, uint32_t lo, uint32_t hi)
+{
+  // xorshift32
+  uint32_t x = run->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  run->rng = x;
+  return lo + x % (hi - lo + 1);
+}
+
+// Move the clock forward, firing timers on the way
+static void bench_advance(bench_run_t *run, int64_t delta_us)
+{
+  int64_t target_us = run->now_us + delta_us;
+  for (;;)
+  {
+    int next = -1;
+    for (int i = 0; i < M4G_BRIDGE_TIMER_COUNT; ++i)
+    {
+      int64_t due_us = run->timer_due_us[i];
+      if (due_us != 0 && due_us <= target_us && (next < 0 || due_us < run->timer_due_us[next]))
+        next = i;
+    }
+    if (next < 0)
+      break;
+    if (run->timer_due_us[next] > run->now_us)
+      run->now_us = run->timer_due_us[next];
+    run->timer_due_us[next] = 0;
+    m4g_bridge_ctx_timer_expired(run->ctx, (m4g_bridge_timer_t)next);
+    m4g_bridge_ctx_drain_events(run->ctx);
+  }
+  run->now_us = target_us;
+}
+
+// One report from a CharaChorder half (report ID prefixed), timed
+static void bench_key(bench_run_t *run, int64_t delay_us, uint8_t slot, uint8_t usage)
+{
+  uint8_t report[9] = {0x01, 0x00, 0x00, usage};
+  bench_advance(run, delay_us);
+
+  uint64_t begin = bench_counter();
+  m4g_bridge_ctx_submit_report(run->ctx, M4G_BRIDGE_SOURCE_USB, slot, report, sizeof(report), true);
+  m4g_bridge_ctx_drain_events(run->ctx);
+  uint64_t cost = bench_counter() - begin;
+
+  if (run->n_cost == run->cap_cost)
+  {
+    run->cap_cost = run->cap_cost ? run->cap_cost * 2 : 4096;
+    run->cost = realloc(run->cost, run->cap_cost * sizeof(uint64_t));
+  }
+  run->cost[run->n_cost++] = cost;
+}
+
+static uint8_t bench_letter(bench_run_t *run)
+{
+  return (uint8_t)bench_rand(run, 0x04, 0x1D);
+}
+
+static void bench_tap(bench_run_t *run)
+{
+  bench_key(run, bench_rand(run, 80000, 200000), 0, bench_letter(run));
+  bench_key(run, bench_rand(run, 60000, 120000), 0, 0);
+}
+
+// Two keys on the two halves, then the device's Backspaces and word at robot speed
+static void bench_chord(bench_run_t *run)
+{
+  bench_key(run, bench_rand(run, 80000, 200000), 0, bench_letter(run));
+  bench_key(run, bench_rand(run, 2000, 10000), 1, bench_letter(run));
+  bench_key(run, bench_rand(run, 60000, 100000), 0, 0);
+  bench_key(run, bench_rand(run, 2000, 6000), 1, 0);
+
+  uint32_t word_len = bench_rand(run, 3, 8);
+  int64_t delay_us = bench_rand(run, 15000, 25000);
+  for (uint32_t i = 0; i < 2 + word_len + 1; ++i)
+  {
+    uint8_t usage = i < 2 ? 0x2A : i < 2 + word_len ? bench_letter(run) : 0x2C;
+    bench_key(run, delay_us, 0, usage);
+    bench_key(run, 1000, 0, 0);
+    delay_us = 1000;
+  }
+}
+
+// A key held into auto-repeat, or an arrow-mouse key held to move the pointer
+static void bench_hold(bench_run_t *run)
+{
+  uint8_t usage = bench_rand(run, 0, 1) ? bench_letter(run) : BENCH_KEY_UP;
+  bench_key(run, bench_rand(run, 80000, 200000), 0, usage);
+  bench_key(run, bench_rand(run, 600000, 1500000), 0, 0);
+}
+
+static void step_taps(bench_run_t *run)
+{
+  bench_tap(run);
+}
+
+static void step_chords(bench_run_t *run)
+{
+  bench_chord(run);
+}
+
+static void step_held(bench_run_t *run)
+{
+  bench_hold(run);
+}
+
+static void step_mixed(bench_run_t *run)
+{
+  uint32_t pick = bench_rand(run, 0, 9);
+  if (pick < 5)
+    bench_tap(run);
+  else if (pick < 9)
+    bench_chord(run);
+  else
+    bench_hold(run);
+}
+
+static const bench_workload_t s_workloads[] = {
+    {"raw", false, step_mixed},  {"taps", true, step_taps}, {"chords", true, step_chords},
+    {"held", true, step_held},   {"mixed", true, step_mixed},
+};
+
+static int compare_u64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void bench_workload(const bench_workload_t *workload, size_t n_reports, uint32_t seed, bench_run_t *run)
+{
+  memset(run, 0, sizeof(*run));
+  run->rng = seed;
+  run->hash = 0xCBF29CE484222325ull;
+  run->now_us = 1000000;
+
+  m4g_bridge_io_t io = {
+      .user = run,
+      .now_us = bench_now_us,
+      .set_timer = bench_set_timer,
+      .send_keyboard = bench_send_keyboard,
+      .send_nkro = bench_send_nkro,
+      .send_mouse = bench_send_mouse,
+      .link_ready = bench_link_ready,
+      .report_notifications = bench_report_notifications,
+      .boot_protocol = bench_boot_protocol,
+      .conn_interval_us = bench_conn_interval_us,
+  };
+  run->ctx = m4g_bridge_ctx_create(&io);
+  if (!run->ctx)
+  {
+    fprintf(stderr, "m4g_bridge_ctx_create failed\n");
+    exit(1);
+  }
+  m4g_bridge_ctx_set_charachorder_status(run->ctx, workload->chord_mode, workload->chord_mode);
+  m4g_bridge_ctx_drain_events(run->ctx);
+
+  while (run->n_cost < n_reports)
+    workload->step(run);
+  bench_advance(run, 2000000);
+  m4g_bridge_ctx_destroy(run->ctx);
+  run->ctx = NULL;
+}
+
+static void usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [--reports N] [--rounds N] [--seed N]\n"
+          "  --reports  input reports per workload (default 50000)\n"
+          "  --rounds   runs of each workload, the fastest is reported (default 5)\n"
+          "  --seed     workload seed (default 1)\n",
+          argv0);
+}
+
+int main(int argc, char **argv)
+{
+  size_t n_reports = 50000;
+  size_t rounds = 5;
+  uint32_t seed = 1;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--reports") == 0 && i + 1 < argc)
+      n_reports = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc)
+      rounds = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+      seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (n_reports == 0 || rounds == 0 || seed == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  m4g_host_set_log_level(ESP_LOG_ERROR);
+  m4g_settings_init();
+
+  printf("%zu reports per workload, seed %" PRIu32 ", %s per report\n", n_reports, seed, BENCH_UNIT);
+  printf("workload  reports   out     mean     p50     p99  hash\n");
+  for (size_t w = 0; w < sizeof(s_workloads) / sizeof(s_workloads[0]); ++w)
+  {
+    // An extra first round warms the caches
+    bench_run_t best = {0};
+    uint64_t best_total = UINT64_MAX;
+    for (size_t round = 0; round <= rounds; ++round)
+    {
+      bench_run_t run;
+      bench_workload(&s_workloads[w], n_reports, seed, &run);
+      uint64_t total = 0;
+      for (size_t i = 0; i < run.n_cost; ++i)
+        total += run.cost[i];
+      if (round > 0 && total < best_total)
+      {
+        free(best.cost);
+        best = run;
+        best_total = total;
+      }
+      else
+        free(run.cost);
+    }
+
+    qsort(best.cost, best.n_cost, sizeof(uint64_t), compare_u64);
+    printf("%-8s %8zu %6" PRIu32 " %8.0f %7" PRIu64 " %7" PRIu64 "  %016" PRIx64 "\n", s_workloads[w].name,
+           best.n_cost, best.reports_out, (double)best_total / (double)best.n_cost, best.cost[best.n_cost / 2],
+           best.cost[best.n_cost * 99 / 100], best.hash);
+    free(best.cost);
+  }
+  return 0;
+}
@@ -0,0 +1,571 @@
+/**
+ * @file host_platform.c
+ * @brief Host stand-ins for the ESP-IDF/FreeRTOS/NimBLE services used by m4g_bridge
+ *
+ * Provides a virtual FreeRTOS tick and esp_timer, an in-memory NVS store, memory-backed
+ * flash partitions and a capturing replacement for the m4g_ble report API (with an
+ * optional connection-interval link model) so the bridge can run as a normal
+ * Linux process.
+ */
+
+#include "m4g_host.h"
+#include "m4g_ble.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+// Virtual clock
+// ---------------------------------------------------------------------------
+
+static int64_t s_now_us = 0;
+
+void m4g_host_set_time_us(int64_t now_us)
+{
+  if (now_us > s_now_us)
+    s_now_us = now_us;
+}
+
+int64_t m4g_host_time_us(void) { return s_now_us; }
+
+TickType_t xTaskGetTickCount(void)
+{
+  return (TickType_t)((s_now_us * configTICK_RATE_HZ) / 1000000);
+}
+
+// ---------------------------------------------------------------------------
+// Tasks (never scheduled; see freertos/task.h)
+// ---------------------------------------------------------------------------
+
+static int s_task_handle_placeholder;
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+  (void)pxTaskCode;
+  (void)pcName;
+  (void)usStackDepth;
+  (void)pvParameters;
+  (void)uxPriority;
+  if (pxCreatedTask)
+    *pxCreatedTask = &s_task_handle_placeholder;
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+  (void)xTaskToNotify;
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+  (void)xClearCountOnExit;
+  (void)xTicksToWait;
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// esp_timer (virtual clock)
+// ---------------------------------------------------------------------------
+
+#define HOST_MAX_TIMERS 8
+
+struct esp_timer
+{
+  bool used;
+  bool armed;
+  int64_t expiry_us;
+  esp_timer_cb_t callback;
+  void *arg;
+};
+
+static struct esp_timer s_timers[HOST_MAX_TIMERS];
+
+int64_t esp_timer_get_time(void) { return s_now_us; }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+  if (!create_args || !create_args->callback || !out_handle)
+    return ESP_ERR_INVALID_ARG;
+  for (size_t i = 0; i < HOST_MAX_TIMERS; ++i)
+  {
+    if (!s_timers[i].used)
+    {
+      s_timers[i] = (struct esp_timer){.used = true, .callback = create_args->callback, .arg = create_args->arg};
+      *out_handle = &s_timers[i];
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+  if (timer->armed)
+    return ESP_ERR_INVALID_STATE;
+  timer->armed = true;
+  timer->expiry_us = s_now_us + (int64_t)timeout_us;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+  if (!timer->armed)
+    return ESP_ERR_INVALID_STATE;
+  timer->armed = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+  if (timer->armed)
+    return ESP_ERR_INVALID_STATE;
+  timer->used = false;
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) { return timer && timer->armed; }
+
+bool m4g_host_next_timer_us(int64_t *out_expiry_us)
+{
+  bool found = false;
+  for (size_t i = 0; i < HOST_MAX_TIMERS; ++i)
+  {
+    if (s_timers[i].used && s_timers[i].armed && (!found || s_timers[i].expiry_us < *out_expiry_us))
+    {
+      *out_expiry_us = s_timers[i].expiry_us;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void m4g_host_run_timers(void)
+{
+  // Callbacks may re-arm timers; loop until nothing is due at the current time
+  bool fired = true;
+  while (fired)
+  {
+    fired = false;
+    for (size_t i = 0; i < HOST_MAX_TIMERS; ++i)
+    {
+      struct esp_timer *t = &s_timers[i];
+      if (t->used && t->armed && t->expiry_us <= s_now_us)
+      {
+        t->armed = false;
+        t->callback(t->arg);
+        fired = true;
+      }
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Logging
+// ---------------------------------------------------------------------------
+
+static esp_log_level_t s_log_level = ESP_LOG_WARN;
+
+void m4g_host_set_log_level(esp_log_level_t level) { s_log_level = level; }
+
+void m4g_host_log(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+  static const char level_chars[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+  if (level > s_log_level || level == ESP_LOG_NONE)
+    return;
+  fprintf(stderr, "%c (%lld.%03lld) %s: ", level_chars[level],
+          (long long)(s_now_us / 1000), (long long)(s_now_us % 1000), tag);
+  va_list ap;
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  fputc('\n', stderr);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+  switch (code)
+  {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_NO_MEM:
+    return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_ARG:
+    return "ESP_ERR_INVALID_ARG";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_INVALID_SIZE:
+    return "ESP_ERR_INVALID_SIZE";
+  case ESP_ERR_NOT_FOUND:
+    return "ESP_ERR_NOT_FOUND";
+  case ESP_ERR_INVALID_VERSION:
+    return "ESP_ERR_INVALID_VERSION";
+  case ESP_ERR_NVS_NOT_FOUND:
+    return "ESP_ERR_NVS_NOT_FOUND";
+  default:
+    return "ESP_ERR_UNKNOWN";
+  }
+}
+
+// ---------------------------------------------------------------------------
+// NVS (in-memory)
+// ---------------------------------------------------------------------------
+
+#define HOST_NVS_MAX_NAMESPACES 8
+#define HOST_NVS_MAX_ENTRIES 64
+#define HOST_NVS_MAX_BLOB 2048
+
+typedef struct
+{
+  bool used;
+  uint8_t ns;
+  char key[16];
+  size_t len;
+  uint8_t data[HOST_NVS_MAX_BLOB];
+} host_nvs_entry_t;
+
+static char s_nvs_namespaces[HOST_NVS_MAX_NAMESPACES][16];
+static host_nvs_entry_t s_nvs_entries[HOST_NVS_MAX_ENTRIES];
+
+void m4g_host_nvs_reset(void)
+{
+  memset(s_nvs_namespaces, 0, sizeof(s_nvs_namespaces));
+  memset(s_nvs_entries, 0, sizeof(s_nvs_entries));
+}
+
+esp_err_t nvs_flash_init(void) { return ESP_OK; }
+
+esp_err_t nvs_flash_erase(void)
+{
+  m4g_host_nvs_reset();
+  return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+  if (!name || !out_handle)
+    return ESP_ERR_INVALID_ARG;
+  for (uint32_t i = 0; i < HOST_NVS_MAX_NAMESPACES; ++i)
+  {
+    if (strncmp(s_nvs_namespaces[i], name, sizeof(s_nvs_namespaces[i])) == 0)
+    {
+      *out_handle = i + 1;
+      return ESP_OK;
+    }
+  }
+  if (open_mode == NVS_READONLY)
+    return ESP_ERR_NVS_NOT_FOUND;
+  for (uint32_t i = 0; i < HOST_NVS_MAX_NAMESPACES; ++i)
+  {
+    if (s_nvs_namespaces[i][0] == '\0')
+    {
+      snprintf(s_nvs_namespaces[i], sizeof(s_nvs_namespaces[i]), "%s", name);
+      *out_handle = i + 1;
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle) { (void)handle; }
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+  (void)handle;
+  return ESP_OK;
+}
+
+static host_nvs_entry_t *nvs_find(nvs_handle_t handle, const char *key, bool create)
+{
+  host_nvs_entry_t *free_entry = NULL;
+  for (size_t i = 0; i < HOST_NVS_MAX_ENTRIES; ++i)
+  {
+    host_nvs_entry_t *e = &s_nvs_entries[i];
+    if (!e->used)
+    {
+      if (!free_entry)
+        free_entry = e;
+      continue;
+    }
+    if (e->ns == handle && strncmp(e->key, key, sizeof(e->key)) == 0)
+      return e;
+  }
+  if (!create || !free_entry)
+    return NULL;
+  memset(free_entry, 0, sizeof(*free_entry));
+  free_entry->used = true;
+  free_entry->ns = (uint8_t)handle;
+  snprintf(free_entry->key, sizeof(free_entry->key), "%s", key);
+  return free_entry;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+  for (size_t i = 0; i < HOST_NVS_MAX_ENTRIES; ++i)
+  {
+    if (s_nvs_entries[i].used && s_nvs_entries[i].ns == handle)
+      s_nvs_entries[i].used = false;
+  }
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+  host_nvs_entry_t *e = nvs_find(handle, key, false);
+  if (!e)
+    return ESP_ERR_NVS_NOT_FOUND;
+  e->used = false;
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+  host_nvs_entry_t *e = nvs_find(handle, key, false);
+  if (!e || e->len != sizeof(uint32_t))
+    return ESP_ERR_NVS_NOT_FOUND;
+  memcpy(out_value, e->data, sizeof(uint32_t));
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+  return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+  host_nvs_entry_t *e = nvs_find(handle, key, false);
+  if (!e)
+    return ESP_ERR_NVS_NOT_FOUND;
+  if (!length)
+    return ESP_ERR_INVALID_ARG;
+  if (!out_value)
+  {
+    *length = e->len;
+    return ESP_OK;
+  }
+  if (*length < e->len)
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  memcpy(out_value, e->data, e->len);
+  *length = e->len;
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+  if (length > HOST_NVS_MAX_BLOB)
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  host_nvs_entry_t *e = nvs_find(handle, key, true);
+  if (!e)
+    return ESP_ERR_NO_MEM;
+  memcpy(e->data, value, length);
+  e->len = length;
+  return ESP_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Flash partitions (memory-backed, looked up by label)
+// ---------------------------------------------------------------------------
+
+#define HOST_MAX_PARTITIONS 4
+
+static esp_partition_t s_partitions[HOST_MAX_PARTITIONS];
+static const void *s_partition_data[HOST_MAX_PARTITIONS];
+static size_t s_partition_count = 0;
+
+void m4g_host_set_partition(const char *label, const void *data, size_t len)
+{
+  size_t i = 0;
+  while (i < s_partition_count && strncmp(label, s_partitions[i].label, sizeof(s_partitions[i].label)) != 0)
+    ++i;
+  if (i == HOST_MAX_PARTITIONS)
+    return;
+  if (i == s_partition_count)
+    ++s_partition_count;
+
+  esp_partition_t *part = &s_partitions[i];
+  memset(part, 0, sizeof(*part));
+  part->type = ESP_PARTITION_TYPE_DATA;
+  part->subtype = ESP_PARTITION_SUBTYPE_ANY;
+  part->size = (uint32_t)len;
+  snprintf(part->label, sizeof(part->label), "%s", label);
+  s_partition_data[i] = data;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+  (void)subtype;
+  for (size_t i = 0; i < s_partition_count; ++i)
+  {
+    if (!s_partition_data[i] || type != s_partitions[i].type)
+      continue;
+    if (label && strncmp(label, s_partitions[i].label, sizeof(s_partitions[i].label)) != 0)
+      continue;
+    return &s_partitions[i];
+  }
+  return NULL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+  (void)memory;
+  if (partition < s_partitions || partition >= s_partitions + s_partition_count || !out_ptr || !out_handle ||
+      offset + size > partition->size)
+    return ESP_ERR_INVALID_ARG;
+  size_t i = (size_t)(partition - s_partitions);
+  *out_ptr = (const uint8_t *)s_partition_data[i] + offset;
+  *out_handle = (esp_partition_mmap_handle_t)(i + 1);
+  return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle) { (void)handle; }
+
+// ---------------------------------------------------------------------------
+// BLE (report capture)
+// ---------------------------------------------------------------------------
+
+#define HOST_MAX_TX_BUFFERS 64
+
+typedef struct
+{
+  m4g_host_report_kind_t kind;
+  size_t len;
+  uint8_t data[M4G_BLE_NKRO_REPORT_LEN];
+} host_notification_t;
+
+static m4g_host_report_sink_t s_report_sink = NULL;
+static void *s_report_sink_arg = NULL;
+static bool s_ble_connected = true;
+static bool s_boot_protocol = false;
+static bool s_report_notifications = true;
+
+// Link model: notifications wait in tx buffers for the next connection event
+static uint32_t s_link_interval_us = 0; // 0: deliver at once
+static size_t s_link_per_event = 0;
+static size_t s_link_buffers = 0;
+static host_notification_t s_tx_queue[HOST_MAX_TX_BUFFERS];
+static size_t s_tx_head = 0;
+static size_t s_tx_count = 0;
+static esp_timer_handle_t s_link_timer = NULL;
+
+void m4g_host_set_report_sink(m4g_host_report_sink_t sink, void *arg)
+{
+  s_report_sink = sink;
+  s_report_sink_arg = arg;
+}
+
+// Like the firmware, every (re)connection starts in report protocol
+void m4g_host_set_ble_connected(bool connected)
+{
+  s_ble_connected = connected;
+  s_boot_protocol = false;
+  s_report_notifications = true;
+  s_tx_count = 0;
+}
+void m4g_host_set_boot_protocol(bool boot) { s_boot_protocol = boot; }
+void m4g_host_set_report_notifications(bool enabled) { s_report_notifications = enabled; }
+
+bool m4g_ble_is_connected(void) { return s_ble_connected; }
+bool m4g_ble_notifications_enabled(void) { return s_ble_connected; }
+bool m4g_ble_is_boot_protocol(void) { return s_boot_protocol; }
+bool m4g_ble_report_notifications_enabled(void) { return s_ble_connected && s_report_notifications; }
+uint32_t m4g_ble_conn_interval_us(void) { return s_ble_connected ? s_link_interval_us : 0; }
+
+// Next connection event strictly after now (events fall on multiples of the interval)
+static void link_arm(void)
+{
+  int64_t next_us = (s_now_us / s_link_interval_us + 1) * (int64_t)s_link_interval_us;
+  esp_timer_start_once(s_link_timer, (uint64_t)(next_us - s_now_us));
+}
+
+// Connection event: the controller sends up to packets_per_event notifications
+static void link_event_cb(void *arg)
+{
+  (void)arg;
+  for (size_t n = 0; n < s_link_per_event && s_tx_count > 0; ++n)
+  {
+    const host_notification_t *tx = &s_tx_queue[s_tx_head];
+    if (s_report_sink)
+      s_report_sink(tx->kind, tx->data, tx->len, s_report_sink_arg);
+    s_tx_head = (s_tx_head + 1) % HOST_MAX_TX_BUFFERS;
+    --s_tx_count;
+  }
+  if (s_tx_count > 0)
+    link_arm();
+}
+
+void m4g_host_set_ble_link(uint32_t conn_interval_us, size_t packets_per_event, size_t tx_buffers)
+{
+  if (!s_link_timer)
+  {
+    const esp_timer_create_args_t args = {.callback = link_event_cb, .name = "ble_link"};
+    esp_timer_create(&args, &s_link_timer);
+  }
+  esp_timer_stop(s_link_timer);
+  s_link_interval_us = conn_interval_us;
+  s_link_per_event = packets_per_event ? packets_per_event : 1;
+  s_link_buffers = tx_buffers < HOST_MAX_TX_BUFFERS ? tx_buffers : HOST_MAX_TX_BUFFERS;
+  s_tx_count = 0;
+}
+
+// Deliver now, or take a tx buffer until the next connection event (no buffer
+// when every one is in use, like NimBLE running out of mbufs)
+static m4g_ble_send_result_t host_notify(m4g_host_report_kind_t kind, const uint8_t *report, size_t len)
+{
+  if (!s_ble_connected)
+    return M4G_BLE_SEND_FAILED;
+  if (!s_link_interval_us)
+  {
+    if (s_report_sink)
+      s_report_sink(kind, report, len, s_report_sink_arg);
+    return M4G_BLE_SEND_OK;
+  }
+  if (s_tx_count >= s_link_buffers)
+    return M4G_BLE_SEND_NO_BUFFER;
+
+  host_notification_t *tx = &s_tx_queue[(s_tx_head + s_tx_count) % HOST_MAX_TX_BUFFERS];
+  tx->kind = kind;
+  tx->len = len;
+  memcpy(tx->data, report, len);
+  if (s_tx_count++ == 0)
+    link_arm();
+  return M4G_BLE_SEND_OK;
+}
+
+m4g_ble_send_result_t m4g_ble_send_keyboard_report(const uint8_t report[8])
+{
+  return host_notify(M4G_HOST_REPORT_KEYBOARD, report, 8);
+}
+
+m4g_ble_send_result_t m4g_ble_send_nkro_report(const uint8_t report[M4G_BLE_NKRO_REPORT_LEN])
+{
+  if (s_boot_protocol || !s_report_notifications)
+    return M4G_BLE_SEND_FAILED;
+  return host_notify(M4G_HOST_REPORT_NKRO, report, M4G_BLE_NKRO_REPORT_LEN);
+}
+
+m4g_ble_send_result_t m4g_ble_send_mouse_report(const uint8_t report[M4G_BLE_MOUSE_REPORT_LEN])
+{
+  if (s_boot_protocol || !s_report_notifications)
+    return M4G_BLE_SEND_FAILED;
+  return host_notify(M4G_HOST_REPORT_MOUSE, report, M4G_BLE_MOUSE_REPORT_LEN);
+}
@@ -0,0 +1,5 @@
+// Host stand-in for FreeRTOS queue.h (bridge host build only)
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef void *QueueHandle_t;
@@ -0,0 +1,60 @@
+// Bridge host harness API (bridge host build only)
+//
+// The host build links the real bridge, settings and logging sources against the
+// stand-ins in this directory. Time only advances when the harness says so, which
+// keeps replays deterministic and lets hours of typing run in seconds.
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  typedef enum
+  {
+    M4G_HOST_REPORT_KEYBOARD, // 8 bytes: mods, reserved, 6 keys
+    M4G_HOST_REPORT_NKRO,     // M4G_BLE_NKRO_REPORT_LEN bytes: mods, usage bitmap
+    M4G_HOST_REPORT_MOUSE,
+  } m4g_host_report_kind_t;
+
+  // Called for every report the bridge hands to m4g_ble_send_*_report
+  typedef void (*m4g_host_report_sink_t)(m4g_host_report_kind_t kind, const uint8_t *report, size_t len, void *arg);
+
+  // Virtual clock (microseconds since harness start)
+  void m4g_host_set_time_us(int64_t now_us);
+  int64_t m4g_host_time_us(void);
+
+  // esp_timer stand-in: earliest pending expiry (false if none), and firing of due timers
+  bool m4g_host_next_timer_us(int64_t *out_expiry_us);
+  void m4g_host_run_timers(void);
+
+  // BLE stand-in: capture emitted reports, and simulate link state
+  void m4g_host_set_report_sink(m4g_host_report_sink_t sink, void *arg);
+  void m4g_host_set_ble_connected(bool connected);
+  void m4g_host_set_boot_protocol(bool boot);
+  // Whether the host subscribed to the report characteristic (true after every
+  // connection); false leaves the boot keyboard characteristic, which takes no
+  // NKRO or mouse reports
+  void m4g_host_set_report_notifications(bool enabled);
+
+  // BLE link model: with a connection interval, notifications take one of tx_buffers
+  // and reach the sink packets_per_event at a time on each connection event; sends
+  // fail while every buffer is taken. Interval 0 (the default) delivers at once.
+  void m4g_host_set_ble_link(uint32_t conn_interval_us, size_t packets_per_event, size_t tx_buffers);
+
+  // Log level threshold for ESP_LOGx output (default: ESP_LOG_WARN)
+  void m4g_host_set_log_level(esp_log_level_t level);
+
+  // In-memory NVS stand-in
+  void m4g_host_nvs_reset(void);
+
+  // Flash partition stand-in: data must stay valid while the bridge runs
+  void m4g_host_set_partition(const char *label, const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
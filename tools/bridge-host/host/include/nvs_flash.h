@@ -0,0 +1,6 @@
+// Host stand-in for ESP-IDF nvs_flash.h (bridge host build only)
+#pragma once
+#include "nvs.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
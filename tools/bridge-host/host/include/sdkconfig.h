@@ -0,0 +1,70 @@
+// Host build configuration for the bridge (bridge host build only)
+//
+// Mirrors the Kconfig defaults of a STANDALONE firmware build. Feature toggles can be
+// switched off from CMake (see M4G_HOST_* options in tools/bridge-host/CMakeLists.txt).
+#pragma once
+
+#define CONFIG_IDF_TARGET "linux"
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_M4G_SPLIT_ROLE_STANDALONE 1
+
+// M4G Settings Configuration
+#define CONFIG_M4G_SETTINGS_ENABLE_NVS_PERSISTENCE 1
+#define CONFIG_M4G_CHORD_DELAY_MS_DEFAULT 15
+#define CONFIG_M4G_CHORD_TIMEOUT_MS_DEFAULT 500
+#define CONFIG_M4G_CHORD_PRESS_DEVIATION_MAX_MS_DEFAULT 100
+#define CONFIG_M4G_CHORD_RELEASE_DEVIATION_MAX_MS_DEFAULT 72
+#define CONFIG_M4G_ADAPTIVE_GRACE_DEFAULT 1
+#define CONFIG_M4G_CHORD_GRACE_PERCENTILE_DEFAULT 99
+#define CONFIG_M4G_CHORD_GRACE_MARGIN_MS_DEFAULT 30
+#define CONFIG_M4G_KEY_REPEAT_DELAY_MS_DEFAULT 1000
+#define CONFIG_M4G_KEY_REPEAT_RATE_MS_DEFAULT 33
+#define CONFIG_M4G_DUPLICATE_SUPPRESSION_DEFAULT 1
+#define CONFIG_M4G_MOUSE_ACCEL_CURVE_DEFAULT 2
+
+// Bridge feature toggles
+#ifndef M4G_HOST_NO_KEY_REPEAT
+#define CONFIG_M4G_ENABLE_KEY_REPEAT 1
+#define CONFIG_M4G_KEY_REPEAT_DELAY_MS 1000
+#define CONFIG_M4G_KEY_REPEAT_RATE_MS 33
+#endif
+
+#ifndef M4G_HOST_NO_ARROW_MOUSE
+#define CONFIG_M4G_ENABLE_ARROW_MOUSE 1
+#define CONFIG_M4G_MOUSE_BASE_SPEED 6
+#define CONFIG_M4G_MOUSE_ENABLE_ACCELERATION 1
+#define CONFIG_M4G_MOUSE_ACCEL_INCREMENT 2
+#define CONFIG_M4G_MOUSE_ACCEL_INTERVAL_MS 75
+#define CONFIG_M4G_MOUSE_MAX_SPEED 40
+#define CONFIG_M4G_ARROW_MOUSE_UP_KEY 0x29
+#define CONFIG_M4G_ARROW_MOUSE_DOWN_KEY 0x2A
+#define CONFIG_M4G_ARROW_MOUSE_LEFT_KEY 0x38
+#define CONFIG_M4G_ARROW_MOUSE_RIGHT_KEY 0x2E
+#endif
+
+#define CONFIG_M4G_ENABLE_DUPLICATE_SUPPRESSION 1
+#ifndef M4G_HOST_NO_NKRO
+#define CONFIG_M4G_ENABLE_NKRO 1
+#endif
+
+// CharaChorder Configuration
+#define CONFIG_M4G_CHARACHORDER_CHORD_TIMEOUT_MS 500
+#define CONFIG_M4G_CHARACHORDER_CHORD_DELAY_MS 15
+#define CONFIG_M4G_CHARACHORDER_ROBOT_BURST_US 6000
+#define CONFIG_M4G_CHARACHORDER_REQUIRE_BOTH_HALVES 1
+#ifdef M4G_HOST_RAW_MODE
+#define CONFIG_M4G_CHARACHORDER_RAW_MODE 1
+#endif
+#ifndef M4G_HOST_NO_LOCAL_CHORDS
+#define CONFIG_M4G_LOCAL_CHORDS 1
+#define CONFIG_M4G_LOCAL_CHORDS_PARTITION_LABEL "chords"
+#endif
+#ifndef M4G_HOST_NO_ABBREV
+#define CONFIG_M4G_ABBREV_EXPANSION 1
+#define CONFIG_M4G_ABBREV_PARTITION_LABEL "abbrev"
+#endif
+
+#define CONFIG_M4G_BRIDGE_MAX_SLOTS 8
+#define CONFIG_M4G_BLE_CONN_INTERVAL_MIN_MS 20
+#define CONFIG_M4G_BLE_CONN_INTERVAL_MAX_MS 40
+#define CONFIG_M4G_BLE_REPORTS_PER_EVENT 4
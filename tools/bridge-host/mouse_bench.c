@@ -0,0 +1,294 @@
+/**
+ * @file mouse_bench.c
+ * @brief Pointer acceleration benchmark for the bridge host build
+ *
+ * Moves a synthetic USB mouse along a few paths (a slow crawl, circles at 1000 and
+ * 125 Hz, a fast flick) through the bridge with each acceleration curve, over the
+ * host BLE link model. For every run it reports the wall-clock cost per input
+ * report and how faithfully the pointer path the host received follows the raw
+ * device motion: the gain (ratio of the paths' extents) and the largest distance
+ * between the two paths once the output is scaled back by that gain, in device
+ * counts (0 for a perfect copy, whatever the gain).
+ */
+
+#include "m4g_ble.h"
+#include "m4g_bridge.h"
+#include "m4g_host.h"
+#include "m4g_settings.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct
+{
+  double *x; // Cumulative position after each motion
+  double *y;
+  size_t len;
+  size_t cap;
+} bench_path_t;
+
+typedef struct
+{
+  const char *name;
+  uint32_t rate_hz;
+  uint32_t duration_ms;
+  // Device position (counts) at time t (s); reports carry the rounded differences
+  void (*position)(double t, double *x, double *y);
+} bench_pattern_t;
+
+static bench_path_t s_out;
+
+static void path_push(bench_path_t *path, double dx, double dy)
+{
+  if (path->len == path->cap)
+  {
+    path->cap = path->cap ? path->cap * 2 : 1024;
+    path->x = realloc(path->x, path->cap * sizeof(double));
+    path->y = realloc(path->y, path->cap * sizeof(double));
+  }
+  double x = path->len ? path->x[path->len - 1] : 0;
+  double y = path->len ? path->y[path->len - 1] : 0;
+  path->x[path->len] = x + dx;
+  path->y[path->len] = y + dy;
+  ++path->len;
+}
+
+static void path_reset(bench_path_t *path)
+{
+  path->len = 0;
+  path_push(path, 0, 0);
+}
+
+// Diagonal of the path's bounding box
+static double path_extent(const bench_path_t *path)
+{
+  double min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+  for (size_t i = 0; i < path->len; ++i)
+  {
+    min_x = fmin(min_x, path->x[i]);
+    max_x = fmax(max_x, path->x[i]);
+    min_y = fmin(min_y, path->y[i]);
+    max_y = fmax(max_y, path->y[i]);
+  }
+  return hypot(max_x - min_x, max_y - min_y);
+}
+
+// Distance from (x, y) to the nearest point of the path, positions multiplied by scale
+static double path_distance(const bench_path_t *path, double scale, double x, double y)
+{
+  double best = hypot(x - scale * path->x[0], y - scale * path->y[0]);
+  for (size_t i = 1; i < path->len; ++i)
+  {
+    double ax = scale * path->x[i - 1], ay = scale * path->y[i - 1];
+    double bx = scale * path->x[i], by = scale * path->y[i];
+    double len2 = (bx - ax) * (bx - ax) + (by - ay) * (by - ay);
+    double f = len2 > 0 ? ((x - ax) * (bx - ax) + (y - ay) * (by - ay)) / len2 : 0;
+    f = f < 0 ? 0 : (f > 1 ? 1 : f);
+    best = fmin(best, hypot(x - (ax + f * (bx - ax)), y - (ay + f * (by - ay))));
+  }
+  return best;
+}
+
+// Hausdorff distance between the raw path and the output path scaled back by the
+// gain: how far one strays from the other, in device counts
+static double path_shape_error(const bench_path_t *raw, const bench_path_t *out, double gain)
+{
+  double worst = 0;
+  for (size_t i = 0; i < out->len; ++i)
+    worst = fmax(worst, path_distance(raw, 1.0, out->x[i] / gain, out->y[i] / gain));
+  for (size_t i = 0; i < raw->len; ++i)
+    worst = fmax(worst, path_distance(out, 1.0 / gain, raw->x[i], raw->y[i]));
+  return worst;
+}
+
+static void on_report(m4g_host_report_kind_t kind, const uint8_t *report, size_t len, void *arg)
+{
+  (void)arg;
+  if (kind == M4G_HOST_REPORT_MOUSE && len == M4G_BLE_MOUSE_REPORT_LEN)
+    path_push(&s_out, (int16_t)(report[1] | report[2] << 8), (int16_t)(report[3] | report[4] << 8));
+}
+
+static int64_t cpu_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compare_i64(const void *a, const void *b)
+{
+  int64_t x = *(const int64_t *)a;
+  int64_t y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Run timers and bridge events until nothing is pending
+static void bench_run_until_idle(void)
+{
+  int64_t timer_us;
+  while (m4g_host_next_timer_us(&timer_us))
+  {
+    m4g_host_set_time_us(timer_us);
+    m4g_host_run_timers();
+    m4g_bridge_drain_events();
+  }
+}
+
+// Step the virtual clock to target_us, firing timers at their expiry
+static void bench_advance_to(int64_t target_us)
+{
+  int64_t timer_us;
+  while (m4g_host_next_timer_us(&timer_us) && timer_us <= target_us)
+  {
+    if (timer_us > m4g_host_time_us())
+      m4g_host_set_time_us(timer_us);
+    m4g_host_run_timers();
+    m4g_bridge_drain_events();
+  }
+  m4g_host_set_time_us(target_us);
+}
+
+// About 0.1 counts per ms: slower than one count per report
+static void pattern_slow(double t, double *x, double *y)
+{
+  *x = 100.0 * t;
+  *y = 40.0 * t;
+}
+
+// Two turns of a 300-count circle per second: about 1.9 counts per ms
+static void pattern_circle(double t, double *x, double *y)
+{
+  *x = 150.0 * sin(4 * M_PI * t);
+  *y = 150.0 * (1 - cos(4 * M_PI * t));
+}
+
+// A 1500-count flick at 30 degrees, peaking near 7.5 counts per ms
+static void pattern_flick(double t, double *x, double *y)
+{
+  double s = t / 0.3;
+  double d = 1500.0 * (s < 1 ? s * s * (3 - 2 * s) : 1);
+  *x = d * cos(M_PI / 6);
+  *y = -d * sin(M_PI / 6);
+}
+
+static const bench_pattern_t s_patterns[] = {
+    {"slow", 125, 3000, pattern_slow},
+    {"circle", 1000, 1000, pattern_circle},
+    {"circle", 125, 1000, pattern_circle},
+    {"flick", 1000, 300, pattern_flick},
+};
+
+static const char *const s_curve_names[M4G_MOUSE_ACCEL_CURVE_COUNT] = {"flat", "low", "medium", "high"};
+
+static void bench_run(const bench_pattern_t *pattern, uint32_t curve, uint32_t interval_us, size_t packets,
+                      size_t buffers, bench_path_t *raw)
+{
+  m4g_host_set_ble_link(interval_us, packets, buffers);
+  m4g_settings_set(M4G_SETTING_MOUSE_ACCEL_CURVE, curve);
+  m4g_bridge_init();
+  path_reset(&s_out);
+  path_reset(raw);
+
+  size_t n_reports = (size_t)pattern->duration_ms * pattern->rate_hz / 1000;
+  int64_t *cost_ns = malloc(n_reports * sizeof(int64_t));
+  int64_t start_us = m4g_host_time_us() + 100000;
+  double px = 0, py = 0;
+  long sent_x = 0, sent_y = 0;
+  for (size_t i = 0; i < n_reports; ++i)
+  {
+    double t = (double)(i + 1) / pattern->rate_hz;
+    pattern->position(t, &px, &py);
+    long dx = lround(px) - sent_x;
+    long dy = lround(py) - sent_y;
+    dx = dx > 127 ? 127 : (dx < -127 ? -127 : dx);
+    dy = dy > 127 ? 127 : (dy < -127 ? -127 : dy);
+    sent_x += dx;
+    sent_y += dy;
+    if (dx != 0 || dy != 0)
+      path_push(raw, (double)dx, (double)dy);
+
+    bench_advance_to(start_us + (int64_t)(t * 1e6));
+    uint8_t report[4] = {0x02, 0x00, (uint8_t)(int8_t)dx, (uint8_t)(int8_t)dy};
+    int64_t begin = cpu_now_ns();
+    m4g_bridge_process_usb_report(0, report, sizeof(report), false);
+    m4g_bridge_drain_events();
+    cost_ns[i] = cpu_now_ns() - begin;
+  }
+  bench_run_until_idle();
+
+  qsort(cost_ns, n_reports, sizeof(int64_t), compare_i64);
+  int64_t total_ns = 0;
+  for (size_t i = 0; i < n_reports; ++i)
+    total_ns += cost_ns[i];
+
+  m4g_bridge_stats_t stats;
+  m4g_bridge_get_stats(&stats);
+  double raw_extent = path_extent(raw);
+  double out_extent = path_extent(&s_out);
+  double gain = raw_extent > 0 && out_extent > 0 ? out_extent / raw_extent : 1.0;
+
+  printf("%-7s %5u Hz  %-7s %7zu  %5u  %6.0f  %6" PRId64 "  %7.0f  %7.0f  %5.2fx  %6.2f\n", pattern->name,
+         pattern->rate_hz, s_curve_names[curve], n_reports, stats.mouse_reports_sent,
+         (double)total_ns / (double)n_reports, cost_ns[n_reports * 99 / 100], raw_extent, out_extent, gain,
+         path_shape_error(raw, &s_out, gain));
+  free(cost_ns);
+}
+
+static void usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [--interval US] [--packets N] [--buffers N]\n"
+          "  --interval  BLE connection interval in us (default 7500)\n"
+          "  --packets   notifications the central takes per connection event (default 4)\n"
+          "  --buffers   notification buffers in the BLE stack (default 12)\n",
+          argv0);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t interval_us = 7500;
+  size_t packets = 4;
+  size_t buffers = 12;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+      interval_us = (uint32_t)strtoul(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "--packets") == 0 && i + 1 < argc)
+      packets = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "--buffers") == 0 && i + 1 < argc)
+      buffers = strtoul(argv[++i], NULL, 10);
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (interval_us == 0 || packets == 0 || buffers == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  m4g_host_set_log_level(ESP_LOG_ERROR);
+  m4g_host_set_report_sink(on_report, NULL);
+  m4g_settings_init();
+
+  bench_path_t raw = {0};
+  printf("link: %.1f ms interval, %zu notifications per connection event, %zu buffers\n", interval_us / 1000.0,
+         packets, buffers);
+  printf("pattern    rate    curve   reports   sent  ns/rep  p99 ns  raw ext  out ext   gain   shape\n");
+  for (size_t p = 0; p < sizeof(s_patterns) / sizeof(s_patterns[0]); ++p)
+  {
+    for (uint32_t curve = 0; curve < M4G_MOUSE_ACCEL_CURVE_COUNT; ++curve)
+      bench_run(&s_patterns[p], curve, interval_us, packets, buffers, &raw);
+  }
+
+  free(raw.x);
+  free(raw.y);
+  free(s_out.x);
+  free(s_out.y);
+  return 0;
+}
@@ -0,0 +1,209 @@
+/**
+ * @file output_bench.c
+ * @brief Paced output benchmark for the bridge host build
+ *
+ * Types a block of text through m4g_bridge_type_text() over the host BLE link
+ * model at 7.5, 15 and 30 ms connection intervals and reports the characters per
+ * second the host received, next to the ceiling the link allows for the same
+ * report sequence. The received reports are decoded back to text and compared
+ * with the input, so a dropped or reordered report fails the run.
+ */
+
+#include "m4g_bridge.h"
+#include "m4g_ble.h"
+#include "m4g_host.h"
+#include "m4g_settings.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SAMPLE "The quick brown fox jumps over the lazy dog; PACK MY BOX with 5 dozen liquor jugs!\n"
+
+typedef struct
+{
+  uint8_t keys[32]; // Usage bitmap of the previous keyboard report
+  char *text;       // Decoded presses
+  size_t text_len;
+  size_t text_cap;
+  uint32_t reports;
+  int64_t last_us;
+} bench_host_t;
+
+static bench_host_t s_host;
+
+// US layout, the inverse of the bridge's text table
+static char usage_to_char(uint8_t usage, bool shift)
+{
+  static const char digits[] = "1234567890";
+  static const char digits_shifted[] = "!@#$%^&*()";
+  static const char symbols[] = "-=[]\\#;'`,./";         // 0x2D-0x38
+  static const char symbols_shifted[] = "_+{}|~:\"~<>?"; // 0x2D-0x38
+  if (usage >= 0x04 && usage <= 0x1D)
+    return (char)((shift ? 'A' : 'a') + usage - 0x04);
+  if (usage >= 0x1E && usage <= 0x27)
+    return (shift ? digits_shifted : digits)[usage - 0x1E];
+  if (usage >= 0x2D && usage <= 0x38)
+    return (shift ? symbols_shifted : symbols)[usage - 0x2D];
+  switch (usage)
+  {
+  case 0x28:
+    return '\n';
+  case 0x2B:
+    return '\t';
+  case 0x2C:
+    return ' ';
+  default:
+    return '?';
+  }
+}
+
+static void bench_push_char(char c)
+{
+  if (s_host.text_len + 1 >= s_host.text_cap)
+  {
+    s_host.text_cap = s_host.text_cap ? s_host.text_cap * 2 : 256;
+    s_host.text = realloc(s_host.text, s_host.text_cap);
+  }
+  s_host.text[s_host.text_len++] = c;
+  s_host.text[s_host.text_len] = '\0';
+}
+
+// Host side: every usage that goes down types a character
+static void on_report(m4g_host_report_kind_t kind, const uint8_t *report, size_t len, void *arg)
+{
+  (void)arg;
+  uint8_t keys[32] = {0};
+  if (kind == M4G_HOST_REPORT_NKRO && len == M4G_BLE_NKRO_REPORT_LEN)
+  {
+    memcpy(keys, &report[1], len - 1);
+  }
+  else if (kind == M4G_HOST_REPORT_KEYBOARD && len == 8)
+  {
+    for (size_t i = 2; i < 8; ++i)
+      keys[report[i] >> 3] |= (uint8_t)(1u << (report[i] & 7));
+    keys[0] &= 0xF0; // Usages 0-3 are not keys
+  }
+  else
+  {
+    return;
+  }
+
+  bool shift = (report[0] & 0x22) != 0;
+  for (size_t i = 0; i < sizeof(keys); ++i)
+  {
+    uint8_t pressed = (uint8_t)(keys[i] & ~s_host.keys[i]);
+    for (int bit = 0; bit < 8; ++bit)
+    {
+      if (pressed & (1u << bit))
+        bench_push_char(usage_to_char((uint8_t)(i * 8 + bit), shift));
+    }
+  }
+  memcpy(s_host.keys, keys, sizeof(keys));
+  ++s_host.reports;
+  s_host.last_us = m4g_host_time_us();
+}
+
+static void on_done(void *arg, bool delivered)
+{
+  *(int *)arg = delivered ? 1 : -1;
+}
+
+// Run timers and bridge events until nothing is pending (output sent, link idle)
+static void bench_run_until_idle(void)
+{
+  int64_t timer_us;
+  while (m4g_host_next_timer_us(&timer_us))
+  {
+    m4g_host_set_time_us(timer_us);
+    m4g_host_run_timers();
+    m4g_bridge_drain_events();
+  }
+}
+
+static int bench_interval(uint32_t interval_us, size_t packets, size_t buffers, const char *text)
+{
+  free(s_host.text);
+  memset(&s_host, 0, sizeof(s_host));
+  m4g_host_set_ble_link(interval_us, packets, buffers);
+  m4g_bridge_init();
+
+  int done = 0;
+  int64_t start_us = m4g_host_time_us();
+  if (!m4g_bridge_type_text(text, on_done, &done))
+  {
+    fprintf(stderr, "type_text refused\n");
+    return 1;
+  }
+  m4g_bridge_drain_events();
+  bench_run_until_idle();
+
+  m4g_bridge_stats_t stats;
+  m4g_bridge_get_stats(&stats);
+  size_t chars = strlen(text);
+  double elapsed_s = (double)(s_host.last_us - start_us) / 1e6;
+  double cps = elapsed_s > 0 ? (double)chars / elapsed_s : 0;
+  // Same report sequence at the full link rate (packets every connection event)
+  double ceiling_cps = (double)chars / ((double)s_host.reports / (double)packets * (double)interval_us / 1e6);
+  bool ok = done == 1 && s_host.text && strcmp(s_host.text, text) == 0;
+
+  printf("%6.1f ms  %6zu  %7u  %8.1f  %8.0f  %8.0f  %4.0f%%  %7u  %s\n", interval_us / 1000.0, chars, s_host.reports,
+         elapsed_s * 1000.0, cps, ceiling_cps, ceiling_cps > 0 ? 100.0 * cps / ceiling_cps : 0.0,
+         stats.output_link_refusals, ok ? "ok" : "MISMATCH");
+  return ok ? 0 : 1;
+}
+
+static void usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [--chars N] [--packets N] [--buffers N]\n"
+          "  --chars    characters to type (default 2000)\n"
+          "  --packets  notifications the central takes per connection event (default 4)\n"
+          "  --buffers  notification buffers in the BLE stack (default 12)\n",
+          argv0);
+}
+
+int main(int argc, char **argv)
+{
+  size_t chars = 2000;
+  size_t packets = 4;
+  size_t buffers = 12;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--chars") == 0 && i + 1 < argc)
+      chars = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "--packets") == 0 && i + 1 < argc)
+      packets = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "--buffers") == 0 && i + 1 < argc)
+      buffers = strtoul(argv[++i], NULL, 10);
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (chars == 0 || packets == 0 || buffers == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  char *text = malloc(chars + 1);
+  for (size_t i = 0; i < chars; ++i)
+    text[i] = BENCH_SAMPLE[i % (sizeof(BENCH_SAMPLE) - 1)];
+  text[chars] = '\0';
+
+  m4g_host_set_log_level(ESP_LOG_ERROR);
+  m4g_host_set_report_sink(on_report, NULL);
+  m4g_settings_init();
+
+  printf("link: %zu notifications per connection event, %zu buffers\n", packets, buffers);
+  printf("interval   chars  reports   time ms   chars/s   ceiling   eff  refused  text\n");
+  int rc = 0;
+  static const uint32_t intervals_us[] = {7500, 15000, 30000};
+  for (size_t i = 0; i < sizeof(intervals_us) / sizeof(intervals_us[0]); ++i)
+    rc |= bench_interval(intervals_us[i], packets, buffers, text);
+
+  free(text);
+  free(s_host.text);
+  return rc;
+}
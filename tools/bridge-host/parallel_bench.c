@@ -0,0 +1,393 @@
+/**
+ * @file parallel_bench.c
+ * @brief Multi-instance throughput benchmark for the bridge host build
+ *
+ * Creates independent bridge instances (m4g_bridge_ctx_create), each with its own
+ * virtual clock, timers and report sink, and drives every one through the same
+ * kind of seeded workload: CharaChorder taps, chords followed by the device's
+ * robot-speed output, and an ordinary keyboard typing on another slot. The
+ * instances are run on one thread for reference and then spread over 1..N
+ * threads; each instance's report stream is hashed, so any difference between a
+ * threaded run and the reference fails the run.
+ */
+
+#include "m4g_bridge.h"
+#include "m4g_ble.h"
+#include "m4g_host.h"
+#include "m4g_settings.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_CONN_INTERVAL_US 7500
+
+typedef struct
+{
+  m4g_bridge_ctx_t *ctx;
+  int64_t now_us;
+  int64_t timer_due_us[M4G_BRIDGE_TIMER_COUNT]; // 0: stopped
+  uint32_t rng;
+  size_t events;
+  uint64_t hash; // FNV-1a over every report and its virtual timestamp
+  uint32_t reports;
+} bench_instance_t;
+
+typedef struct
+{
+  bench_instance_t *instances;
+  size_t n_instances;
+  size_t first;
+  size_t stride;
+  size_t events;
+} bench_worker_t;
+
+static int64_t bench_now_us(void *user)
+{
+  return ((bench_instance_t *)user)->now_us;
+}
+
+static void bench_set_timer(void *user, m4g_bridge_timer_t timer, int64_t due_us)
+{
+  ((bench_instance_t *)user)->timer_due_us[timer] = due_us;
+}
+
+static void bench_hash(bench_instance_t *inst, uint8_t kind, const uint8_t *report, size_t len)
+{
+  uint64_t h = inst->hash;
+  const uint8_t *t = (const uint8_t *)&inst->now_us;
+  for (size_t i = 0; i < sizeof(inst->now_us); ++i)
+    h = (h ^ t[i]) * 0x100000001B3ull;
+  h = (h ^ kind) * 0x100000001B3ull;
+  for (size_t i = 0; i < len; ++i)
+    h = (h ^ report[i]) * 0x100000001B3ull;
+  inst->hash = h;
+  ++inst->reports;
+}
+
+static m4g_bridge_send_result_t bench_send_keyboard(void *user, const uint8_t report[8])
+{
+  bench_hash(user, M4G_HOST_REPORT_KEYBOARD, report, 8);
+  return M4G_BRIDGE_SEND_OK;
+}
+
+static m4g_bridge_send_result_t bench_send_nkro(void *user, const uint8_t *report, size_t len)
+{
+  bench_hash(user, M4G_HOST_REPORT_NKRO, report, len);
+  return M4G_BRIDGE_SEND_OK;
+}
+
+static m4g_bridge_send_result_t bench_send_mouse(void *user, const uint8_t report[M4G_BRIDGE_MOUSE_REPORT_LEN])
+{
+  bench_hash(user, M4G_HOST_REPORT_MOUSE, report, M4G_BRIDGE_MOUSE_REPORT_LEN);
+  return M4G_BRIDGE_SEND_OK;
+}
+
+static bool bench_link_ready(void *user)
+{
+  (void)user;
+  return true;
+}
+
+static bool bench_report_notifications(void *user)
+{
+  (void)user;
+  return true;
+}
+
+static bool bench_boot_protocol(void *user)
+{
+  (void)user;
+  return false;
+}
+
+static uint32_t bench_conn_interval_us(void *user)
+{
+  (void)user;
+  return BENCH_CONN_INTERVAL_US;
+}
+
+static uint32_t bench_rand(bench_instance_t *inst, uint32_t lo, uint32_t hi)
+{
+  // xorshift32, seeded per instance
+  uint32_t x = inst->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  inst->rng = x;
+  return lo + x % (hi - lo + 1);
+}
+
+// Move the instance's clock forward, firing its timers on the way
+static void bench_advance(bench_instance_t *inst, int64_t delta_us)
+{
+  int64_t target_us = inst->now_us + delta_us;
+  for (;;)
+  {
+    int next = -1;
+    for (int i = 0; i < M4G_BRIDGE_TIMER_COUNT; ++i)
+    {
+      int64_t due_us = inst->timer_due_us[i];
+      if (due_us != 0 && due_us <= target_us && (next < 0 || due_us < inst->timer_due_us[next]))
+        next = i;
+    }
+    if (next < 0)
+      break;
+    if (inst->timer_due_us[next] > inst->now_us)
+      inst->now_us = inst->timer_due_us[next];
+    inst->timer_due_us[next] = 0;
+    m4g_bridge_ctx_timer_expired(inst->ctx, (m4g_bridge_timer_t)next);
+    m4g_bridge_ctx_drain_events(inst->ctx);
+  }
+  inst->now_us = target_us;
+}
+
+// One report from a CharaChorder half (report ID prefixed) or an ordinary keyboard
+static void bench_key(bench_instance_t *inst, int64_t delay_us, uint8_t slot, bool is_charachorder, uint8_t modifiers,
+                      uint8_t usage)
+{
+  uint8_t report[9] = {0};
+  size_t len = 8;
+  if (is_charachorder)
+  {
+    report[0] = 0x01;
+    report[1] = modifiers;
+    report[3] = usage;
+    len = 9;
+  }
+  else
+  {
+    report[0] = modifiers;
+    report[2] = usage;
+  }
+  bench_advance(inst, delay_us);
+  m4g_bridge_ctx_submit_report(inst->ctx, M4G_BRIDGE_SOURCE_USB, slot, report, len, is_charachorder);
+  m4g_bridge_ctx_drain_events(inst->ctx);
+  ++inst->events;
+}
+
+static uint8_t bench_letter(bench_instance_t *inst)
+{
+  return (uint8_t)bench_rand(inst, 0x04, 0x1D);
+}
+
+static void bench_tap(bench_instance_t *inst)
+{
+  bench_key(inst, bench_rand(inst, 80000, 200000), 0, true, 0, bench_letter(inst));
+  bench_key(inst, bench_rand(inst, 60000, 120000), 0, true, 0, 0);
+}
+
+// Two keys on the two halves, then the device's Backspaces and word at robot speed
+static void bench_chord(bench_instance_t *inst)
+{
+  bench_key(inst, bench_rand(inst, 80000, 200000), 0, true, 0, bench_letter(inst));
+  bench_key(inst, bench_rand(inst, 2000, 10000), 1, true, 0, bench_letter(inst));
+  bench_key(inst, bench_rand(inst, 60000, 100000), 0, true, 0, 0);
+  bench_key(inst, bench_rand(inst, 2000, 6000), 1, true, 0, 0);
+
+  uint32_t word_len = bench_rand(inst, 3, 8);
+  int64_t delay_us = bench_rand(inst, 15000, 25000);
+  for (uint32_t i = 0; i < 2 + word_len + 1; ++i)
+  {
+    uint8_t usage = i < 2 ? 0x2A : i < 2 + word_len ? bench_letter(inst) : 0x2C;
+    bench_key(inst, delay_us, 0, true, 0, usage);
+    bench_key(inst, 1000, 0, true, 0, 0);
+    delay_us = 1000;
+  }
+}
+
+// An ordinary keyboard typing a word, now and then shifted or held into auto-repeat
+static void bench_typing(bench_instance_t *inst)
+{
+  uint32_t word_len = bench_rand(inst, 3, 8);
+  for (uint32_t i = 0; i < word_len; ++i)
+  {
+    uint8_t modifiers = bench_rand(inst, 0, 7) == 0 ? 0x02 : 0;
+    uint32_t hold_us = bench_rand(inst, 0, 15) == 0 ? bench_rand(inst, 600000, 900000) : bench_rand(inst, 40000, 80000);
+    bench_key(inst, bench_rand(inst, 50000, 150000), 2, false, modifiers, bench_letter(inst));
+    bench_key(inst, hold_us, 2, false, 0, 0);
+  }
+}
+
+static void bench_run_instance(bench_instance_t *inst, size_t events)
+{
+  m4g_bridge_ctx_set_charachorder_status(inst->ctx, true, true);
+  m4g_bridge_ctx_drain_events(inst->ctx);
+  while (inst->events < events)
+  {
+    switch (bench_rand(inst, 0, 3))
+    {
+    case 0:
+      bench_tap(inst);
+      break;
+    case 1:
+      bench_chord(inst);
+      break;
+    default:
+      bench_typing(inst);
+      break;
+    }
+  }
+  // Let paced output and pending timers finish
+  bench_advance(inst, 2000000);
+}
+
+static void *bench_worker(void *arg)
+{
+  bench_worker_t *worker = arg;
+  for (size_t i = worker->first; i < worker->n_instances; i += worker->stride)
+    bench_run_instance(&worker->instances[i], worker->events);
+  return NULL;
+}
+
+static double bench_seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void bench_destroy(bench_instance_t *instances, size_t n_instances)
+{
+  for (size_t i = 0; i < n_instances; ++i)
+    m4g_bridge_ctx_destroy(instances[i].ctx);
+}
+
+// Run every instance's workload on n_threads threads; returns elapsed seconds, or < 0 on failure
+static double bench_run(bench_instance_t *instances, size_t n_instances, size_t events, size_t n_threads)
+{
+  for (size_t i = 0; i < n_instances; ++i)
+  {
+    bench_instance_t *inst = &instances[i];
+    memset(inst, 0, sizeof(*inst));
+    inst->rng = 0x9E3779B9u ^ (uint32_t)(i + 1) * 0x85EBCA6Bu;
+    inst->hash = 0xCBF29CE484222325ull;
+    const m4g_bridge_io_t io = {
+        .now_us = bench_now_us,
+        .set_timer = bench_set_timer,
+        .send_keyboard = bench_send_keyboard,
+        .send_nkro = bench_send_nkro,
+        .send_mouse = bench_send_mouse,
+        .link_ready = bench_link_ready,
+        .report_notifications = bench_report_notifications,
+        .boot_protocol = bench_boot_protocol,
+        .conn_interval_us = bench_conn_interval_us,
+        .user = inst,
+        .persist_grace_model = false,
+    };
+    inst->ctx = m4g_bridge_ctx_create(&io);
+    if (!inst->ctx)
+    {
+      fprintf(stderr, "m4g_bridge_ctx_create failed\n");
+      bench_destroy(instances, i);
+      return -1;
+    }
+  }
+
+  pthread_t threads[n_threads];
+  bench_worker_t workers[n_threads];
+  double start = bench_seconds();
+  for (size_t t = 0; t < n_threads; ++t)
+  {
+    workers[t] = (bench_worker_t){instances, n_instances, t, n_threads, events};
+    if (pthread_create(&threads[t], NULL, bench_worker, &workers[t]) != 0)
+    {
+      fprintf(stderr, "pthread_create failed\n");
+      for (size_t j = 0; j < t; ++j)
+        pthread_join(threads[j], NULL);
+      bench_destroy(instances, n_instances);
+      return -1;
+    }
+  }
+  for (size_t t = 0; t < n_threads; ++t)
+    pthread_join(threads[t], NULL);
+  double elapsed = bench_seconds() - start;
+
+  bench_destroy(instances, n_instances);
+  return elapsed;
+}
+
+static void usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [--instances N] [--events N] [--threads N]\n"
+          "  --instances  bridge instances (default 64)\n"
+          "  --events     reports fed to each instance (default 20000)\n"
+          "  --threads    most threads to try (default: online CPUs)\n",
+          argv0);
+}
+
+int main(int argc, char **argv)
+{
+  size_t n_instances = 64;
+  size_t events = 20000;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t max_threads = cpus > 0 ? (size_t)cpus : 1;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+      n_instances = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc)
+      events = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      max_threads = strtoul(argv[++i], NULL, 10);
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (n_instances == 0 || events == 0 || max_threads == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  if (max_threads > n_instances)
+    max_threads = n_instances;
+
+  m4g_host_set_log_level(ESP_LOG_ERROR);
+  m4g_settings_init();
+
+  bench_instance_t *reference = calloc(n_instances, sizeof(*reference));
+  bench_instance_t *instances = calloc(n_instances, sizeof(*instances));
+  double base = bench_run(reference, n_instances, events, 1);
+  if (base < 0)
+    return 1;
+  uint64_t total_events = 0;
+  uint64_t total_reports = 0;
+  for (size_t i = 0; i < n_instances; ++i)
+  {
+    total_events += reference[i].events;
+    total_reports += reference[i].reports;
+  }
+
+  printf("%zu instances, %llu events in, %llu reports out\n", n_instances, (unsigned long long)total_events,
+         (unsigned long long)total_reports);
+  printf("threads   time ms    events/s  speedup  reports\n");
+  printf("%7s  %8.1f  %10.0f  %6.2fx  %s\n", "ref", base * 1000.0, (double)total_events / base, 1.0, "-");
+  int rc = 0;
+  // 1, 2, 4, ... threads, ending on max_threads
+  for (size_t n_threads = 1;; n_threads = n_threads * 2 < max_threads ? n_threads * 2 : max_threads)
+  {
+    double elapsed = bench_run(instances, n_instances, events, n_threads);
+    if (elapsed < 0)
+      return 1;
+    bool ok = true;
+    for (size_t i = 0; i < n_instances; ++i)
+    {
+      if (instances[i].hash != reference[i].hash || instances[i].reports != reference[i].reports)
+        ok = false;
+    }
+    printf("%7zu  %8.1f  %10.0f  %6.2fx  %s\n", n_threads, elapsed * 1000.0, (double)total_events / elapsed,
+           base / elapsed, ok ? "ok" : "MISMATCH");
+    rc |= ok ? 0 : 1;
+    if (n_threads == max_threads)
+      break;
+  }
+
+  free(reference);
+  free(instances);
+  return rc;
+}
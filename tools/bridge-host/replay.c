@@ -0,0 +1,621 @@
+/**
+ * @file replay.c
+ * @brief Replay recorded USB HID traces through the host build of m4g_bridge
+ *
+ * Each trace line is "<t_us> <command> [args...]" ('#' starts a comment):
+ *
+ *   <t_us> report <slot> <is_charachorder> <hex bytes...>   raw USB HID report
+ *   <t_us> status <detected> <both_halves>                  CharaChorder detection
+ *   <t_us> reset <slot>                                     slot disconnected
+ *   <t_us> descriptor <slot> <hex bytes...>                 slot's HID report descriptor (mouse layout)
+ *   <t_us> set <setting_id> <value>                         runtime setting change
+ *   <t_us> ble <connected>                                  BLE link up/down
+ *   <t_us> protocol <boot|report>                           HID protocol mode chosen by the host
+ *   <t_us> batch <usb|espnow> ... <t_us> batch end          reports delivered together
+ *
+ * Reports between "batch" and "batch end" are not delivered at their own time:
+ * they are handed over in one m4g_bridge_process_reports() call at the "batch end"
+ * time, keeping their timestamps as receive times (an ESP-NOW backlog, say).
+ *
+ * There is no scheduler on the host, so the bridge task's queue is drained after
+ * every posted event. Between events the virtual clock jumps from one pending
+ * esp_timer expiry to the next, running each callback exactly on time. Every report
+ * handed to BLE is printed with its virtual timestamp, followed by a summary of
+ * per-report CPU time and press-to-host virtual latency.
+ */
+
+#include "m4g_ble.h"
+#include "m4g_bridge.h"
+#include "m4g_host.h"
+#include "m4g_logging.h"
+#include "m4g_settings.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPLAY_MAX_LINE 1024
+#define REPLAY_MAX_REPORT 64
+#define REPLAY_MAX_BATCH 256
+
+typedef struct
+{
+  int64_t *values;
+  size_t count;
+  size_t capacity;
+} sample_set_t;
+
+typedef struct
+{
+  bool quiet;
+  int64_t tail_us;
+} replay_options_t;
+
+typedef struct
+{
+  // Input side: last keys seen per slot and when each usage was last pressed
+  uint8_t slot_keys[M4G_BRIDGE_MAX_SLOTS][6];
+  int64_t pending_press_us[256];
+  // Output side: usages held in the last 6KRO [0] and NKRO [1] report handed to BLE
+  bool out_keys[2][256];
+  uint32_t kb_out;
+  uint32_t mouse_out;
+  uint32_t reports_in;
+  sample_set_t cpu_ns;
+  sample_set_t latency_us;
+  bool quiet;
+  // Reports collected between "batch" and "batch end"
+  bool batch_open;
+  m4g_bridge_source_t batch_source;
+  size_t batch_len;
+  int64_t batch_last_us;
+  m4g_bridge_report_t batch[REPLAY_MAX_BATCH];
+  uint8_t batch_data[REPLAY_MAX_BATCH][REPLAY_MAX_REPORT];
+} replay_state_t;
+
+static replay_state_t s_replay;
+
+static void samples_add(sample_set_t *set, int64_t value)
+{
+  if (set->count == set->capacity)
+  {
+    size_t cap = set->capacity ? set->capacity * 2 : 1024;
+    int64_t *grown = realloc(set->values, cap * sizeof(*grown));
+    if (!grown)
+      return;
+    set->values = grown;
+    set->capacity = cap;
+  }
+  set->values[set->count++] = value;
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+  int64_t x = *(const int64_t *)a;
+  int64_t y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void samples_print(const char *name, const char *unit, sample_set_t *set)
+{
+  if (set->count == 0)
+  {
+    printf("%-12s n=0\n", name);
+    return;
+  }
+  qsort(set->values, set->count, sizeof(int64_t), cmp_i64);
+  long double sum = 0;
+  for (size_t i = 0; i < set->count; ++i)
+    sum += set->values[i];
+  printf("%-12s n=%zu mean=%.1Lf%s p50=%" PRId64 "%s p99=%" PRId64 "%s max=%" PRId64 "%s\n",
+         name, set->count, sum / set->count, unit,
+         set->values[set->count / 2], unit,
+         set->values[(set->count * 99) / 100], unit,
+         set->values[set->count - 1], unit);
+}
+
+// Update one output format's held usages and record latency for newly pressed ones
+static void note_output_keys(replay_state_t *st, size_t format, const bool now_held[256], int64_t now)
+{
+  for (size_t key = 4; key < 256; ++key)
+  {
+    if (now_held[key] && !st->out_keys[format][key] && st->pending_press_us[key] >= 0)
+    {
+      samples_add(&st->latency_us, now - st->pending_press_us[key]);
+      st->pending_press_us[key] = -1;
+    }
+    st->out_keys[format][key] = now_held[key];
+  }
+}
+
+static bool keys_contain(const uint8_t keys[6], uint8_t key)
+{
+  for (size_t i = 0; i < 6; ++i)
+  {
+    if (keys[i] == key)
+      return true;
+  }
+  return false;
+}
+
+static void on_report(m4g_host_report_kind_t kind, const uint8_t *report, size_t len, void *arg)
+{
+  replay_state_t *st = (replay_state_t *)arg;
+  int64_t now = m4g_host_time_us();
+
+  if (kind == M4G_HOST_REPORT_KEYBOARD && len >= 8)
+  {
+    ++st->kb_out;
+    bool held[256] = {false};
+    for (size_t i = 2; i < 8; ++i)
+      held[report[i]] = true;
+    note_output_keys(st, 0, held, now);
+    if (!st->quiet)
+    {
+      printf("%10" PRId64 " KB    mod=%02X keys=%02X %02X %02X %02X %02X %02X\n",
+             now, report[0], report[2], report[3], report[4], report[5], report[6], report[7]);
+    }
+  }
+  else if (kind == M4G_HOST_REPORT_NKRO && len == M4G_BLE_NKRO_REPORT_LEN)
+  {
+    ++st->kb_out;
+    bool held[256] = {false};
+    for (size_t key = 0; key <= M4G_BLE_NKRO_MAX_USAGE; ++key)
+      held[key] = (report[1 + key / 8] >> (key % 8)) & 1;
+    note_output_keys(st, 1, held, now);
+    if (!st->quiet)
+    {
+      printf("%10" PRId64 " NKRO  mod=%02X keys=", now, report[0]);
+      for (size_t key = 0; key <= M4G_BLE_NKRO_MAX_USAGE; ++key)
+      {
+        if (held[key])
+          printf("%02X ", (unsigned)key);
+      }
+      printf("\n");
+    }
+  }
+  else if (kind == M4G_HOST_REPORT_MOUSE && len == M4G_BLE_MOUSE_REPORT_LEN)
+  {
+    ++st->mouse_out;
+    if (!st->quiet)
+    {
+      printf("%10" PRId64 " MOUSE btn=%02X dx=%d dy=%d", now, report[0], (int16_t)(report[1] | report[2] << 8),
+             (int16_t)(report[3] | report[4] << 8));
+      if (report[5] || report[6])
+        printf(" wheel=%d pan=%d", (int8_t)report[5], (int8_t)report[6]);
+      printf("\n");
+    }
+  }
+}
+
+// Record press times of usages that appear in a keyboard report for latency tracking
+static void note_input_presses(uint8_t slot, const uint8_t *report, size_t len, int64_t now)
+{
+  const uint8_t *payload = NULL;
+  if (len >= 9 && report[0] == 0x01)
+    payload = &report[1];
+  else if (len >= 8 && report[0] != 0x02)
+    payload = report;
+  if (!payload || slot >= M4G_BRIDGE_MAX_SLOTS)
+    return;
+
+  uint8_t keys[6] = {0};
+  memcpy(keys, &payload[2], 6);
+  for (size_t i = 0; i < 6; ++i)
+  {
+    uint8_t key = keys[i];
+    if (key > 0x03 && !keys_contain(s_replay.slot_keys[slot], key))
+      s_replay.pending_press_us[key] = now;
+  }
+  memcpy(s_replay.slot_keys[slot], keys, 6);
+}
+
+static int64_t cpu_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Step the virtual clock to target_us, firing esp_timer callbacks at their exact expiry
+static void advance_to(int64_t target_us)
+{
+  int64_t timer_us;
+  while (m4g_host_next_timer_us(&timer_us) && timer_us <= target_us)
+  {
+    if (timer_us > m4g_host_time_us())
+      m4g_host_set_time_us(timer_us);
+    m4g_host_run_timers();
+    m4g_bridge_drain_events();
+  }
+  m4g_host_set_time_us(target_us);
+  m4g_bridge_drain_events();
+}
+
+static int parse_hex_bytes(char *cursor, uint8_t *out, size_t max)
+{
+  size_t n = 0;
+  char *tok;
+  while ((tok = strtok_r(cursor, " \t\r\n", &cursor)) != NULL)
+  {
+    if (tok[0] == '#')
+      break;
+    if (n >= max)
+      return -1;
+    char *end = NULL;
+    unsigned long v = strtoul(tok, &end, 16);
+    if (*end != '\0' || v > 0xFF)
+      return -1;
+    out[n++] = (uint8_t)v;
+  }
+  return (int)n;
+}
+
+// Hand the collected batch to the bridge, a ring's worth at a time
+static void replay_batch_deliver(void)
+{
+  size_t done = 0;
+  int64_t start = cpu_now_ns();
+  while (done < s_replay.batch_len)
+  {
+    size_t queued = m4g_bridge_process_reports(s_replay.batch_source, &s_replay.batch[done], s_replay.batch_len - done);
+    m4g_bridge_drain_events();
+    if (queued == 0)
+      break;
+    done += queued;
+  }
+  int64_t per_report = s_replay.batch_len ? (cpu_now_ns() - start) / (int64_t)s_replay.batch_len : 0;
+  for (size_t i = 0; i < s_replay.batch_len; ++i)
+    samples_add(&s_replay.cpu_ns, per_report);
+  s_replay.batch_open = false;
+  s_replay.batch_len = 0;
+}
+
+static int replay_line(char *line, unsigned lineno)
+{
+  char *cursor = line;
+  char *tok = strtok_r(cursor, " \t\r\n", &cursor);
+  if (!tok || tok[0] == '#')
+    return 0;
+
+  char *end = NULL;
+  long long t_us = strtoll(tok, &end, 10);
+  if (*end != '\0' || t_us < m4g_host_time_us() || (s_replay.batch_open && t_us < s_replay.batch_last_us))
+  {
+    fprintf(stderr, "line %u: bad or non-monotonic timestamp '%s'\n", lineno, tok);
+    return -1;
+  }
+  char *cmd = strtok_r(cursor, " \t\r\n", &cursor);
+  if (!cmd)
+  {
+    fprintf(stderr, "line %u: missing command\n", lineno);
+    return -1;
+  }
+
+  if (s_replay.batch_open)
+  {
+    char *arg = strtok_r(cursor, " \t\r\n", &cursor);
+    if (strcmp(cmd, "batch") == 0 && arg && strcmp(arg, "end") == 0)
+    {
+      advance_to(t_us);
+      replay_batch_deliver();
+      return 0;
+    }
+    char *chara_s = strtok_r(cursor, " \t\r\n", &cursor);
+    uint8_t *data = s_replay.batch_data[s_replay.batch_len];
+    int len = (strcmp(cmd, "report") == 0 && arg && chara_s && s_replay.batch_len < REPLAY_MAX_BATCH)
+                  ? parse_hex_bytes(cursor, data, REPLAY_MAX_REPORT)
+                  : -1;
+    if (len <= 0)
+    {
+      fprintf(stderr, "line %u: only reports fit in a batch (at most %d)\n", lineno, REPLAY_MAX_BATCH);
+      return -1;
+    }
+    uint8_t slot = (uint8_t)strtoul(arg, NULL, 0);
+    note_input_presses(slot, data, (size_t)len, t_us);
+    ++s_replay.reports_in;
+    s_replay.batch[s_replay.batch_len++] = (m4g_bridge_report_t){
+        .timestamp_us = t_us,
+        .slot = slot,
+        .is_charachorder = strtoul(chara_s, NULL, 0) != 0,
+        .len = (uint8_t)len,
+        .data = data,
+    };
+    s_replay.batch_last_us = t_us;
+    return 0;
+  }
+
+  advance_to(t_us);
+
+  if (strcmp(cmd, "report") == 0)
+  {
+    char *slot_s = strtok_r(cursor, " \t\r\n", &cursor);
+    char *chara_s = strtok_r(cursor, " \t\r\n", &cursor);
+    uint8_t report[REPLAY_MAX_REPORT];
+    int len = (slot_s && chara_s) ? parse_hex_bytes(cursor, report, sizeof(report)) : -1;
+    if (len <= 0)
+    {
+      fprintf(stderr, "line %u: malformed report\n", lineno);
+      return -1;
+    }
+    uint8_t slot = (uint8_t)strtoul(slot_s, NULL, 0);
+    bool is_chara = strtoul(chara_s, NULL, 0) != 0;
+
+    note_input_presses(slot, report, (size_t)len, t_us);
+    ++s_replay.reports_in;
+    int64_t start = cpu_now_ns();
+    m4g_bridge_process_usb_report(slot, report, (size_t)len, is_chara);
+    m4g_bridge_drain_events();
+    samples_add(&s_replay.cpu_ns, cpu_now_ns() - start);
+  }
+  else if (strcmp(cmd, "status") == 0)
+  {
+    char *a = strtok_r(cursor, " \t\r\n", &cursor);
+    char *b = strtok_r(cursor, " \t\r\n", &cursor);
+    m4g_bridge_set_charachorder_status(a && atoi(a), b && atoi(b));
+    m4g_bridge_drain_events();
+  }
+  else if (strcmp(cmd, "reset") == 0)
+  {
+    char *a = strtok_r(cursor, " \t\r\n", &cursor);
+    m4g_bridge_reset_slot(a ? (uint8_t)atoi(a) : 0);
+    m4g_bridge_drain_events();
+  }
+  else if (strcmp(cmd, "descriptor") == 0)
+  {
+    // What the USB host does once it has read an interface's report descriptor
+    char *slot_s = strtok_r(cursor, " \t\r\n", &cursor);
+    uint8_t desc[REPLAY_MAX_LINE / 3];
+    int len = slot_s ? parse_hex_bytes(cursor, desc, sizeof(desc)) : -1;
+    m4g_hid_mouse_layout_t layout;
+    if (len <= 0 || !m4g_hid_mouse_parse(desc, (size_t)len, &layout))
+    {
+      fprintf(stderr, "line %u: no mouse report in descriptor\n", lineno);
+      return -1;
+    }
+    m4g_bridge_set_mouse_layout((uint8_t)strtoul(slot_s, NULL, 0), &layout);
+    m4g_bridge_drain_events();
+  }
+  else if (strcmp(cmd, "set") == 0)
+  {
+    char *id = strtok_r(cursor, " \t\r\n", &cursor);
+    char *value = strtok_r(cursor, " \t\r\n", &cursor);
+    if (!id || !value ||
+        m4g_settings_set((m4g_setting_id_t)strtoul(id, NULL, 0), (uint32_t)strtoul(value, NULL, 0)) != ESP_OK)
+    {
+      fprintf(stderr, "line %u: setting rejected\n", lineno);
+      return -1;
+    }
+  }
+  else if (strcmp(cmd, "batch") == 0)
+  {
+    char *source = strtok_r(cursor, " \t\r\n", &cursor);
+    if (!source || (strcmp(source, "usb") != 0 && strcmp(source, "espnow") != 0))
+    {
+      fprintf(stderr, "line %u: batch source must be usb or espnow\n", lineno);
+      return -1;
+    }
+    s_replay.batch_open = true;
+    s_replay.batch_source = strcmp(source, "usb") == 0 ? M4G_BRIDGE_SOURCE_USB : M4G_BRIDGE_SOURCE_ESPNOW;
+    s_replay.batch_last_us = t_us;
+  }
+  else if (strcmp(cmd, "ble") == 0)
+  {
+    char *a = strtok_r(cursor, " \t\r\n", &cursor);
+    m4g_host_set_ble_connected(a && atoi(a));
+  }
+  else if (strcmp(cmd, "protocol") == 0)
+  {
+    char *mode = strtok_r(cursor, " \t\r\n", &cursor);
+    if (!mode || (strcmp(mode, "boot") != 0 && strcmp(mode, "report") != 0))
+    {
+      fprintf(stderr, "line %u: protocol must be boot or report\n", lineno);
+      return -1;
+    }
+    m4g_host_set_boot_protocol(strcmp(mode, "boot") == 0);
+  }
+  else if (strcmp(cmd, "subscribe") == 0)
+  {
+    char *chars = strtok_r(cursor, " \t\r\n", &cursor);
+    if (!chars || (strcmp(chars, "both") != 0 && strcmp(chars, "boot") != 0))
+    {
+      fprintf(stderr, "line %u: subscribe must be both or boot\n", lineno);
+      return -1;
+    }
+    m4g_host_set_report_notifications(strcmp(chars, "both") == 0);
+  }
+  else
+  {
+    fprintf(stderr, "line %u: unknown command '%s'\n", lineno, cmd);
+    return -1;
+  }
+  return 0;
+}
+
+// Whole file into a malloc'd buffer (NULL and a message on failure)
+static void *read_file(const char *path, size_t *out_len)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f)
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  void *data = len > 0 ? malloc((size_t)len) : NULL;
+  if (!data || fread(data, 1, (size_t)len, f) != (size_t)len)
+  {
+    fprintf(stderr, "%s: read failed\n", path);
+    free(data);
+    fclose(f);
+    return NULL;
+  }
+  fclose(f);
+  *out_len = (size_t)len;
+  return data;
+}
+
+static void usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-q] [-v] [--tail-ms N] [--ble-link US:PACKETS:BUFFERS] [--chord-dict FILE] [--abbrev-dict FILE]\n"
+          "          trace.txt\n"
+          "  -q           only print the summary\n"
+          "  -v           print bridge debug logging\n"
+          "  --tail-ms    virtual time to run after the last event (default 2000)\n"
+          "  --ble-link   model a BLE link: connection interval, notifications per event, tx buffers\n"
+          "  --chord-dict chord dictionary image to serve as the 'chords' partition\n"
+          "  --abbrev-dict abbreviation dictionary image to serve as the 'abbrev' partition\n",
+          argv0);
+}
+
+int main(int argc, char **argv)
+{
+  replay_options_t opt = {.quiet = false, .tail_us = 2000000};
+  const char *path = NULL;
+  const char *dict_path = NULL;
+  const char *abbrev_path = NULL;
+  bool verbose = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-q") == 0)
+      opt.quiet = true;
+    else if (strcmp(argv[i], "-v") == 0)
+      verbose = true;
+    else if (strcmp(argv[i], "--tail-ms") == 0 && i + 1 < argc)
+      opt.tail_us = strtoll(argv[++i], NULL, 10) * 1000;
+    else if (strcmp(argv[i], "--ble-link") == 0 && i + 1 < argc)
+    {
+      unsigned interval_us = 0;
+      unsigned packets = 0;
+      unsigned buffers = 0;
+      if (sscanf(argv[++i], "%u:%u:%u", &interval_us, &packets, &buffers) != 3 || !packets || !buffers)
+      {
+        usage(argv[0]);
+        return 2;
+      }
+      m4g_host_set_ble_link(interval_us, packets, buffers);
+    }
+    else if (strcmp(argv[i], "--chord-dict") == 0 && i + 1 < argc)
+      dict_path = argv[++i];
+    else if (strcmp(argv[i], "--abbrev-dict") == 0 && i + 1 < argc)
+      abbrev_path = argv[++i];
+    else if (argv[i][0] != '-' && !path)
+      path = argv[i];
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (!path)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  FILE *f = fopen(path, "r");
+  if (!f)
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  void *dict_image = NULL;
+  if (dict_path)
+  {
+    size_t dict_len = 0;
+    dict_image = read_file(dict_path, &dict_len);
+    if (!dict_image)
+    {
+      fclose(f);
+      return 1;
+    }
+    m4g_host_set_partition("chords", dict_image, dict_len);
+  }
+  void *abbrev_image = NULL;
+  if (abbrev_path)
+  {
+    size_t abbrev_len = 0;
+    abbrev_image = read_file(abbrev_path, &abbrev_len);
+    if (!abbrev_image)
+    {
+      free(dict_image);
+      fclose(f);
+      return 1;
+    }
+    m4g_host_set_partition("abbrev", abbrev_image, abbrev_len);
+  }
+
+  for (size_t i = 0; i < 256; ++i)
+    s_replay.pending_press_us[i] = -1;
+  s_replay.quiet = opt.quiet;
+
+  m4g_host_set_log_level(ESP_LOG_WARN);
+  m4g_host_set_report_sink(on_report, &s_replay);
+  m4g_settings_init();
+  m4g_bridge_init();
+  if (verbose)
+  {
+    m4g_log_enable_keypress(true);
+    m4g_host_set_log_level(ESP_LOG_VERBOSE);
+  }
+
+  char line[REPLAY_MAX_LINE];
+  unsigned lineno = 0;
+  int rc = 0;
+  while (fgets(line, sizeof(line), f))
+  {
+    ++lineno;
+    if (replay_line(line, lineno) != 0)
+    {
+      rc = 1;
+      break;
+    }
+  }
+  fclose(f);
+  if (s_replay.batch_open)
+  {
+    fprintf(stderr, "%s: batch not ended\n", path);
+    rc = 1;
+  }
+  advance_to(m4g_host_time_us() + opt.tail_us);
+
+  size_t unmatched = 0;
+  for (size_t i = 0; i < 256; ++i)
+  {
+    if (s_replay.pending_press_us[i] >= 0)
+      ++unmatched;
+  }
+
+  m4g_bridge_stats_t stats;
+  m4g_bridge_get_stats(&stats);
+  printf("--- summary ---\n");
+  printf("reports in=%u keyboard out=%u mouse out=%u chords=%u\n",
+         s_replay.reports_in, s_replay.kb_out, s_replay.mouse_out, stats.chord_reports_processed);
+  samples_print("cpu", "ns", &s_replay.cpu_ns);
+  samples_print("latency", "us", &s_replay.latency_us);
+  printf("presses never seen by host: %zu\n", unmatched);
+  printf("events dropped: %u\n", stats.events_dropped);
+  printf("unchanged reports: %u\n", stats.reports_unchanged);
+  printf("speculation hits=%u misses=%u\n", stats.speculative_hits, stats.speculative_misses);
+  printf("robot bursts: %u\n", stats.robot_bursts);
+  printf("grace window: early expiries=%u late outputs=%u\n", stats.grace_early_expiries, stats.grace_late_outputs);
+  printf("local chords: %u\n", stats.local_chords);
+  printf("abbreviations expanded: %u\n", stats.abbrev_expansions);
+  printf("output paced=%u refused=%u dropped=%u\n", stats.output_reports_deferred, stats.output_link_refusals,
+         stats.output_reports_dropped);
+  printf("batched states coalesced: %u\n", stats.reports_coalesced);
+  printf("mouse reports merged: %u\n", stats.mouse_reports_merged);
+
+  free(s_replay.cpu_ns.values);
+  free(s_replay.latency_us.values);
+  free(dict_image);
+  free(abbrev_image);
+  return rc;
+}
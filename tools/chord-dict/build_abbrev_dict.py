@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Build the abbreviation dictionary partition image (CONFIG_M4G_ABBREV_EXPANSION).
+
+Reads an abbreviation list and writes the trie that
+components/m4g_bridge/m4g_abbrev.c maps from flash. The layout must match
+components/m4g_bridge/include/m4g_abbrev.h.
+
+Accepted inputs:
+  - JSON object: {"btw": "by the way", "omw": "on my way", ...}
+  - JSON list: [{"input": "btw", "output": "by the way"}, ...]
+  - Text: one "abbreviation<TAB>expansion" per line, "#" starts a comment
+
+Abbreviations are letters and digits only (matched case-insensitively, as HID
+usages); the expansion may hold any character of the US layout.
+
+Usage:
+  build_abbrev_dict.py abbrev.json -o abbrev.bin [--partition-size 0x40000]
+  parttool.py write_partition --partition-name abbrev --input abbrev.bin
+"""
+
+import argparse
+import json
+import struct
+import sys
+from collections import deque
+
+from build_chord_dict import align4, char_to_hid
+
+MAGIC = 0x4241344D  # "M4AB"
+VERSION = 1
+MAX_DEPTH = 32
+HEADER_FMT = "<IHHIIIIIII"
+NODE_FMT = "<IBBHI"
+
+
+def load_abbreviations(path):
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    try:
+        data = json.loads(text)
+    except json.JSONDecodeError:
+        pairs = []
+        for line in text.splitlines():
+            line = line.rstrip("\r\n")
+            if not line.strip() or line.lstrip().startswith("#"):
+                continue
+            if "\t" not in line:
+                sys.exit(f"{path}: expected 'abbreviation<TAB>expansion': {line!r}")
+            abbrev, expansion = line.split("\t", 1)
+            pairs.append((abbrev.strip(), expansion))
+        return pairs
+    if isinstance(data, dict):
+        return list(data.items())
+    if isinstance(data, list):
+        return [(a["input"], a["output"]) for a in data]
+    sys.exit(f"{path}: no abbreviation list found")
+
+
+def encode(pairs):
+    """Abbreviation pairs -> {usage tuple: [(modifiers, usage), ...]}, plus skip count."""
+    table = {}
+    skipped = 0
+    for abbrev, expansion in pairs:
+        try:
+            usages = tuple(char_to_hid(ch.lower())[1] for ch in abbrev)
+            output = [char_to_hid(ch) for ch in expansion]
+        except KeyError:
+            skipped += 1
+            continue
+        # Only letters and digits extend a word on the device
+        if not usages or len(usages) > MAX_DEPTH or not all(0x04 <= u <= 0x27 for u in usages):
+            skipped += 1
+            continue
+        if not output or len(output) > 255 or usages in table:
+            skipped += 1
+            continue
+        table[usages] = output
+    return table, skipped
+
+
+def build_trie(table):
+    """Breadth-first node list: each node is [children {usage: index}, output or None].
+    Breadth-first numbering keeps every node's edges contiguous."""
+    nodes = [[{}, None]]
+    for usages, output in sorted(table.items()):
+        node = 0
+        for u in usages:
+            child = nodes[node][0].get(u)
+            if child is None:
+                child = len(nodes)
+                nodes.append([{}, None])
+                nodes[node][0][u] = child
+            node = child
+        nodes[node][1] = output
+
+    order = []
+    renumber = {}
+    queue = deque([0])
+    while queue:
+        n = queue.popleft()
+        renumber[n] = len(order)
+        order.append(n)
+        queue.extend(nodes[n][0][u] for u in sorted(nodes[n][0]))
+    return [(({u: renumber[c] for u, c in nodes[n][0].items()}), nodes[n][1]) for n in order]
+
+
+def build_image(trie):
+    node_records = []
+    edges = []
+    outputs = []
+    for children, output in trie:
+        first_edge = len(edges)
+        edges.extend((child << 8) | u for u, child in sorted(children.items()))
+        if output:
+            node_records.append(struct.pack(NODE_FMT, first_edge, len(children), len(output), 0, len(outputs)))
+            outputs.extend(output)
+        else:
+            node_records.append(struct.pack(NODE_FMT, first_edge, len(children), 0, 0, 0))
+
+    header_size = struct.calcsize(HEADER_FMT)
+    nodes_offset = align4(header_size)
+    edges_offset = align4(nodes_offset + struct.calcsize(NODE_FMT) * len(node_records))
+    outputs_offset = align4(edges_offset + 4 * len(edges))
+    image_size = align4(outputs_offset + 2 * len(outputs))
+
+    image = bytearray(image_size)
+    struct.pack_into(HEADER_FMT, image, 0, MAGIC, VERSION, 0, len(node_records), len(edges), len(outputs),
+                     nodes_offset, edges_offset, outputs_offset, image_size)
+    image[nodes_offset:nodes_offset + len(node_records) * struct.calcsize(NODE_FMT)] = b"".join(node_records)
+    if edges:
+        struct.pack_into(f"<{len(edges)}I", image, edges_offset, *edges)
+    for i, (mods, usage) in enumerate(outputs):
+        struct.pack_into("<BB", image, outputs_offset + 2 * i, mods, usage)
+    return bytes(image)
+
+
+def verify(table, trie):
+    for usages, output in table.items():
+        node = 0
+        for u in usages:
+            node = trie[node][0][u]
+        assert trie[node][1] == output, f"walk of {bytes(usages).hex()} ends on the wrong node"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="abbreviation list (JSON or tab-separated text)")
+    parser.add_argument("-o", "--output", required=True, help="partition image to write")
+    parser.add_argument("--partition-size", type=lambda v: int(v, 0), default=0x40000,
+                        help="size of the abbrev partition (default 0x40000)")
+    args = parser.parse_args()
+
+    table, skipped = encode(load_abbreviations(args.input))
+    if not table:
+        sys.exit("no usable abbreviations")
+    trie = build_trie(table)
+    verify(table, trie)
+    if len(trie) >= 1 << 24:
+        sys.exit(f"{len(trie)} trie nodes, at most {(1 << 24) - 1} can be addressed")
+    image = build_image(trie)
+    if len(image) > args.partition_size:
+        sys.exit(f"image is {len(image)} bytes, partition holds {args.partition_size}")
+
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print(f"{len(table)} abbreviations ({skipped} skipped), {len(trie)} nodes, {len(image)} bytes -> {args.output}")
+
+
+if __name__ == "__main__":
+    main()
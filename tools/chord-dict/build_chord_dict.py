@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""Build the local chord dictionary partition image (CONFIG_M4G_LOCAL_CHORDS).
+
+Reads a chord library export and writes the perfect-hashed image that
+components/m4g_bridge/m4g_chord_dict.c maps from flash. The layout and hash
+must match components/m4g_bridge/include/m4g_chord_dict.h.
+
+Accepted inputs (JSON):
+  - CharaChorder DeviceManager chord backup:
+      {"charaVersion": 1, "type": "chords", "chords": [[[input actions], [output actions]], ...]}
+    or a full backup list containing such an object. Actions 32-126 are ASCII
+    characters; chords using any other action are skipped and counted.
+  - A plain list: [{"input": "th", "output": "the "}, ...]
+
+Usage:
+  build_chord_dict.py chords.json -o chords.bin [--partition-size 0x80000]
+  parttool.py write_partition --partition-name chords --input chords.bin
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = 0x4443344D  # "M4CD"
+VERSION = 1
+MAX_KEYS = 10
+KEY_LEN = MAX_KEYS + 1
+HEADER_FMT = "<IHHIIIIIIIII"
+ENTRY_FMT = "<10sBBI"
+BUCKET_SIZE = 4  # Average keys per bucket
+LOAD_FACTOR = 0.9
+SHIFT = 0x02  # Left Shift modifier bit
+
+# US layout: character -> (modifiers, HID usage)
+_UNSHIFTED = "1234567890"
+_SYMBOLS = {
+    "\n": 0x28, "\t": 0x2B, " ": 0x2C, "-": 0x2D, "=": 0x2E, "[": 0x2F, "]": 0x30,
+    "\\": 0x31, ";": 0x33, "'": 0x34, "`": 0x35, ",": 0x36, ".": 0x37, "/": 0x38,
+}
+_SHIFTED = {
+    "!": "1", "@": "2", "#": "3", "$": "4", "%": "5", "^": "6", "&": "7", "*": "8", "(": "9", ")": "0",
+    "_": "-", "+": "=", "{": "[", "}": "]", "|": "\\", ":": ";", '"': "'", "~": "`", "<": ",", ">": ".", "?": "/",
+}
+
+
+def char_to_hid(ch):
+    if "a" <= ch <= "z":
+        return 0, 0x04 + ord(ch) - ord("a")
+    if "A" <= ch <= "Z":
+        return SHIFT, 0x04 + ord(ch) - ord("A")
+    if ch in _UNSHIFTED:
+        return 0, 0x1E + _UNSHIFTED.index(ch)
+    if ch in _SYMBOLS:
+        return 0, _SYMBOLS[ch]
+    if ch in _SHIFTED:
+        return SHIFT, char_to_hid(_SHIFTED[ch])[1]
+    raise KeyError(ch)
+
+
+def chord_hash(key, seed):
+    """Mirror of m4g_chord_dict_hash()."""
+    h = (2166136261 ^ seed) & 0xFFFFFFFF
+    for b in key:
+        h ^= b
+        h = (h * 16777619) & 0xFFFFFFFF
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+    h ^= h >> 16
+    return h
+
+
+def actions_to_text(actions):
+    if isinstance(actions, str):
+        return actions
+    if not all(isinstance(a, int) and 32 <= a <= 126 for a in actions):
+        raise KeyError(actions)
+    return "".join(chr(a) for a in actions)
+
+
+def load_chords(path):
+    with open(path, encoding="utf-8") as f:
+        data = json.load(f)
+    if isinstance(data, list) and data and isinstance(data[0], dict) and "input" in data[0]:
+        return [(c["input"], c["output"]) for c in data]
+    if isinstance(data, list):
+        data = next((d for d in data if isinstance(d, dict) and d.get("type") == "chords"), None)
+    if not isinstance(data, dict) or "chords" not in data:
+        sys.exit(f"{path}: no chord list found")
+    return [(c[0], c[1]) for c in data["chords"]]
+
+
+def encode(chords):
+    """Chord pairs -> {key bytes: [(modifiers, usage), ...]}, plus skip count."""
+    table = {}
+    skipped = 0
+    for raw_in, raw_out in chords:
+        try:
+            text_in = actions_to_text(raw_in)
+            text_out = actions_to_text(raw_out)
+            usages = sorted({char_to_hid(ch.lower())[1] for ch in text_in})
+            output = [char_to_hid(ch) for ch in text_out]
+        except KeyError:
+            skipped += 1
+            continue
+        if not usages or len(usages) > MAX_KEYS or not output or len(output) > 255:
+            skipped += 1
+            continue
+        key = bytes(usages) + bytes(MAX_KEYS - len(usages)) + bytes([0])
+        if key in table:
+            skipped += 1
+            continue
+        table[key] = output
+    return table, skipped
+
+
+def build_perfect_hash(keys, seed):
+    """Hash-and-displace: give every bucket the smallest displacement that sends
+    all its keys to free slots. Largest buckets are placed first."""
+    bucket_count = max(1, (len(keys) + BUCKET_SIZE - 1) // BUCKET_SIZE)
+    slot_count = max(1, int(len(keys) / LOAD_FACTOR) + 1)
+    buckets = [[] for _ in range(bucket_count)]
+    for key in keys:
+        buckets[chord_hash(key, seed) % bucket_count].append(key)
+
+    displacement = [0] * bucket_count
+    slots = [None] * slot_count
+    for b in sorted(range(bucket_count), key=lambda i: -len(buckets[i])):
+        if not buckets[b]:
+            continue
+        for d in range(0x10000):
+            placed = [chord_hash(k, (seed + d + 1) & 0xFFFFFFFF) % slot_count for k in buckets[b]]
+            if len(set(placed)) == len(placed) and all(slots[p] is None for p in placed):
+                break
+        else:
+            return None
+        displacement[b] = d
+        for k, p in zip(buckets[b], placed):
+            slots[p] = k
+    return bucket_count, displacement, slots
+
+
+def align4(n):
+    return (n + 3) & ~3
+
+
+def build_image(table, seed):
+    keys = sorted(table)
+    for attempt in range(16):
+        result = build_perfect_hash(keys, (seed + attempt) & 0xFFFFFFFF)
+        if result:
+            seed = (seed + attempt) & 0xFFFFFFFF
+            break
+    else:
+        sys.exit("could not build a perfect hash; try another --seed")
+    bucket_count, displacement, slots = result
+
+    outputs = []
+    entries = []
+    for key in slots:
+        if key is None:
+            entries.append(struct.pack(ENTRY_FMT, bytes(MAX_KEYS), 0, 0, 0))
+            continue
+        out = table[key]
+        entries.append(struct.pack(ENTRY_FMT, key[:MAX_KEYS], key[MAX_KEYS], len(out), len(outputs)))
+        outputs.extend(out)
+
+    header_size = struct.calcsize(HEADER_FMT)
+    buckets_offset = align4(header_size)
+    slots_offset = align4(buckets_offset + 2 * bucket_count)
+    outputs_offset = align4(slots_offset + struct.calcsize(ENTRY_FMT) * len(slots))
+    image_size = align4(outputs_offset + 2 * len(outputs))
+
+    image = bytearray(image_size)
+    struct.pack_into(HEADER_FMT, image, 0, MAGIC, VERSION, MAX_KEYS, len(keys), bucket_count, len(slots),
+                     len(outputs), seed, buckets_offset, slots_offset, outputs_offset, image_size)
+    struct.pack_into(f"<{bucket_count}H", image, buckets_offset, *displacement)
+    image[slots_offset:slots_offset + len(entries) * 16] = b"".join(entries)
+    for i, (mods, usage) in enumerate(outputs):
+        struct.pack_into("<BB", image, outputs_offset + 2 * i, mods, usage)
+    return bytes(image), seed, bucket_count, displacement, slots
+
+
+def verify(table, seed, bucket_count, displacement, slots):
+    for key in table:
+        b = chord_hash(key, seed) % bucket_count
+        s = chord_hash(key, (seed + displacement[b] + 1) & 0xFFFFFFFF) % len(slots)
+        assert slots[s] == key, f"lookup of {key.hex()} lands on the wrong slot"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="chord library export (JSON)")
+    parser.add_argument("-o", "--output", required=True, help="partition image to write")
+    parser.add_argument("--partition-size", type=lambda v: int(v, 0), default=0x80000,
+                        help="size of the chords partition (default 0x80000)")
+    parser.add_argument("--seed", type=lambda v: int(v, 0), default=0x4D344743)
+    args = parser.parse_args()
+
+    table, skipped = encode(load_chords(args.input))
+    if not table:
+        sys.exit("no usable chords")
+    image, seed, bucket_count, displacement, slots = build_image(table, args.seed)
+    verify(table, seed, bucket_count, displacement, slots)
+    if len(image) > args.partition_size:
+        sys.exit(f"image is {len(image)} bytes, partition holds {args.partition_size}")
+
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print(f"{len(table)} chords ({skipped} skipped), {len(slots)} slots, {len(image)} bytes -> {args.output}")
+
+
+if __name__ == "__main__":
+    main()